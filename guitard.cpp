@@ -19,6 +19,7 @@ GuitarD::GuitarD(const InstanceInfo& info) : iplug::Plugin(info, MakeConfig(GUIT
   path.Set(homeDir);
 #endif
   soundwoofer::setup::setHomeDirectory(path.Get());
+  guitard::NodePacks::discover(); // Needs the home directory
 
   mParamManager = new guitard::ParameterManager();
   mParamManager->setParamChangeCallback([&]() {
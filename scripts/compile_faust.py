@@ -1,15 +1,149 @@
 import os
+import re
 cwd = os.getcwd()
 outFolder = os.path.join(cwd, "src/main/faust/generated")
 rootFolder = "guitard"
-baseCommand = "faust -i -double -scn FaustHeadlessDsp -a "
+# -ec moves the terms only depending on parameters to control(), so they are only computed when a parameter changed
+baseCommand = "faust -i -ec -scn FaustHeadlessDsp -a "
 baseCommand += os.path.join(cwd, "src/main/faust/FaustArchitecture.cpp")
 
+# Every dsp gets compiled in all of these, the suffix has to match the ids in src/main/faust/FaustVariants.h
+# -omp and -sch are left out since they spin up threads inside of compute() which doesn't go well with
+# the small blocks on the audio thread
+variants = [
+    ("scalar_double", "-double"),
+    ("scalar_float", "-single"),
+    ("vec16_double", "-double -vec -vs 16"),
+    ("vec16_float", "-single -vec -vs 16"),
+    ("vec32_double", "-double -vec -vs 32"),
+    ("vec32_float", "-single -vec -vs 32"),
+]
+
+# Chains of dsp files which also get compiled into a single faust program each, in processing order
+# The graph runs that one instead when it finds these nodes chained with nothing else attached, see src/main/FusedRegion.h
+chains = [
+    ["ParametricEq", "BandSplit", "StereoTool"],
+    ["SimpleGate", "SimpleComressor", "ParametricEq"],
+]
+
+# Picks the variant for the current build from FaustVariants.h, so the nodes can keep using FaustGenerated::<name>
+def writeSelector(name):
+    macro = "GUITARD_FAUST_VARIANT_" + name
+    out = "#pragma once\n#include \"../FaustVariants.h\"\n\n"
+    out += "#ifndef " + macro + "\n"
+    out += "  #define " + macro + " GUITARD_FAUST_DEFAULT_VARIANT\n"
+    out += "#endif\n\n"
+    for i, (suffix, flags) in enumerate(variants):
+        out += "#if " if i == 0 else "#elif "
+        out += macro + " == GUITARD_FAUST_" + suffix.upper() + "\n"
+        out += "  #include \"./" + name + "_" + suffix + ".h\"\n"
+        out += "  namespace guitard { namespace FaustGenerated {\n"
+        out += "    class " + name + " : public " + name + "_" + suffix + " { };\n"
+        out += "  } }\n"
+    out += "#else\n  #error \"Unknown faust variant for " + name + "\"\n#endif\n"
+    with open(os.path.join(outFolder, name + ".h"), "w") as f:
+        f.write(out)
+
+# Includes every variant of every dsp and lists them for src/headless/faust_variant_benchmark.cpp
+def writeVariantList(names):
+    out = "#pragma once\n#include \"../FaustVariants.h\"\n\n"
+    for name in names:
+        for suffix, flags in variants:
+            out += "#include \"./" + name + "_" + suffix + ".h\"\n"
+    out += "\nnamespace guitard {\n  namespace FaustGenerated {\n"
+    out += "    const FaustVariant AllVariants[] = {\n"
+    for name in names:
+        for suffix, flags in variants:
+            out += "      { \"" + name + "\", GUITARD_FAUST_" + suffix.upper() + ", \"" + suffix + "\", "
+            out += "[]() -> FaustHeadlessDsp* { return new " + name + "_" + suffix + "(); } },\n"
+    out += "    };\n  }\n}\n"
+    with open(os.path.join(outFolder, "AllVariants.h"), "w") as f:
+        f.write(out)
+
+def compileVariants(name, path, superClass="FaustHeadlessDsp"):
+    for suffix, flags in variants:
+        command = baseCommand.replace("FaustHeadlessDsp", superClass) + " " + flags + " -cn " + name + "_" + suffix + " -o "
+        command += os.path.join(outFolder, name + "_" + suffix + ".h") + " "
+        command += path
+        os.system(command)
+    writeSelector(name)
+
+# Reads the channel counts from the generated code
+def getChannels(name):
+    with open(os.path.join(outFolder, name + "_scalar_double.h")) as f:
+        code = f.read()
+    inputs = re.search(r"getNumInputs\(\)[^{]*\{\s*return\s+(\d+);", code)
+    outputs = re.search(r"getNumOutputs\(\)[^{]*\{\s*return\s+(\d+);", code)
+    return int(inputs.group(1)), int(outputs.group(1))
+
+# The registered node type for each faust class, e.g. ParametricEq -> ParametricEqNode
+def findNodeTypes():
+    types = {}
+    pattern = re.compile(r"(?:class\s+(\w+)\s+final\s*:\s*public|using\s+(\w+)\s*=)\s*FaustGenerated::(\w+)\b")
+    for root, dirs, files in os.walk(os.path.join(cwd, "src/nodes")):
+        for file in files:
+            if file.endswith(".h"):
+                with open(os.path.join(root, file)) as f:
+                    for match in pattern.finditer(f.read()):
+                        types[match.group(3)] = match.group(1) or match.group(2)
+    return types
+
+# Each dsp sits in its own hgroup so the controls can be mapped back to the nodes, see FusedFaustDsp.h
+# Only the first stereo pair gets passed on like a connection between the first sockets of two nodes would,
+# additional inputs get silence and additional outputs are dropped
+# Every stage gets a Bypass checkbox which the graph binds to the Bypass of the node, so bypassing doesn't break up the chain
+def writeFusedDsp(name, chain, paths):
+    stages = []
+    for i, dsp in enumerate(chain):
+        inputs, outputs = getChannels(dsp)
+        if inputs < 2 or outputs < 2:
+            raise Exception(dsp + " needs at least a stereo input and output to be in a chain")
+        stage = "component(\"" + paths[dsp].replace("\\", "/") + "\")"
+        if inputs > 2:
+            stage = "(_, _, par(i, " + str(inputs - 2) + ", 0)) : " + stage
+        if outputs > 2:
+            stage = stage + " : (_, _, par(i, " + str(outputs - 2) + ", !))"
+        stage = "ba.bypass2(checkbox(\"Bypass\"), " + stage + ")"
+        stages.append("  hgroup(\"stage" + str(i) + "\", " + stage + ")")
+    out = "// Generated by scripts/compile_faust.py from " + " -> ".join(chain) + "\n"
+    out += "declare name \"" + name + "\";\n"
+    out += "import(\"stdfaust.lib\");\n\n"
+    out += "process =\n" + " :\n".join(stages) + ";\n"
+    path = os.path.join(outFolder, name + ".dsp")
+    with open(path, "w") as f:
+        f.write(out)
+    return path
+
+def writeChainList(fused):
+    out = "#pragma once\n#include \"../FusedFaustDsp.h\"\n\n"
+    for name, nodeTypes in fused:
+        out += "#include \"./" + name + ".h\"\n"
+    out += "\nnamespace guitard {\n"
+    for name, nodeTypes in fused:
+        out += "  GUITARD_REGISTER_FUSED_CHAIN(" + name + ", \"" + "\", \"".join(nodeTypes) + "\")\n"
+    out += "}\n"
+    with open(os.path.join(outFolder, "FusedChains.h"), "w") as f:
+        f.write(out)
+
+names = []
+paths = {}
 for root, dirs, files in os.walk(cwd):
+    if os.path.abspath(root) == outFolder:
+        continue # The fused programs are compiled below
     for file in files:
         if file.endswith(".dsp"):
             name = file[:-4]
-            command = baseCommand + " -cn " + name + " -o "
-            command +=  os.path.join(outFolder, name + ".h") + " "
-            command += os.path.join(root, file)
-            os.system(command)
\ No newline at end of file
+            names.append(name)
+            paths[name] = os.path.join(root, file)
+            compileVariants(name, paths[name])
+
+nodeTypes = findNodeTypes()
+fused = []
+for chain in chains:
+    name = "Fused" + "".join(chain)
+    compileVariants(name, writeFusedDsp(name, chain, paths), "FusedFaustDsp")
+    names.append(name)
+    fused.append((name, [nodeTypes[dsp] for dsp in chain]))
+
+writeChainList(fused)
+writeVariantList(sorted(names))
@@ -45,6 +45,12 @@
  */
 #define GUITARD_FLOAT_CONVOLUTION
 
+/**
+ * Compiles in the partition spectra of the internal IRs so creating a cab doesn't need any FFTs
+ * Adds about 1.5 MB to the binary, see src/headless/embed_irs.cpp
+ */
+#define GUITARD_EMBEDDED_SPECTRA
+
 #ifdef __arm__ // No sse for arm obviously
   #undef GUITARD_SSE
 #endif
\ No newline at end of file
@@ -1,13 +1,144 @@
 #pragma once
 
 #include "../../../thirdparty/soundwoofer/soundwoofer.h"
+#include "../../types/GConvolver.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+/**
+ * Without the precomputed spectra (see GConfig.h) the FFTs are still done when a cab is created
+ */
+#ifdef GUITARD_EMBEDDED_SPECTRA
+  #define GUITARD_INTERNAL_SPECTRA(spectra) spectra
+#else
+  #define GUITARD_INTERNAL_SPECTRA(spectra) nullptr
+#endif
+
+namespace guitard {
+  /**
+   * A internal IR normalized and resampled at build time
+   */
+  struct InternalIRRate {
+    size_t sampleRate;
+    size_t length;
+    float** samples;
+    /** One per channel for the WrappedConvolver or nullptr */
+    const PreparedSpectrum* spectra;
+  };
+
+  struct InternalIRSource {
+    const char* name;
+    size_t channels;
+    /** Samplerate of the original wave */
+    size_t sampleRate;
+    const InternalIRRate* rates;
+    size_t rateCount;
+  };
+}
+
+/**
+ * Run src/headless/embed_irs.cpp to regenerate these
+ */
 #include "./clean.ir"
 #include "./air.ir"
+
 namespace guitard {
+  const InternalIRSource* InternalIRSources[] = {
+    &InteralIR::cleanIRSource,
+    &InteralIR::airIRSource
+  };
+
+  /**
+   * The IR for a specific samplerate
+   */
+  struct InternalIRVersion {
+    soundwoofer::SWImpulseShared ir;
+    const PreparedSpectrum* spectra = nullptr;
+  };
+
+  InternalIRVersion createInternalIR(const InternalIRSource& source, const InternalIRRate& rate) {
+    InternalIRVersion version;
+    version.ir = soundwoofer::ir::createGeneric(
+      source.name, rate.samples, rate.length, source.channels, rate.sampleRate, soundwoofer::EMBEDDED_SRC
+    );
+    version.ir->normalized = true;
+    version.spectra = rate.spectra;
+    return version;
+  }
+
+  soundwoofer::SWImpulseShared createInternalIR(const InternalIRSource& source) {
+    for (size_t i = 0; i < source.rateCount; i++) {
+      if (source.rates[i].sampleRate == source.sampleRate) {
+        return createInternalIR(source, source.rates[i]).ir;
+      }
+    }
+    return createInternalIR(source, source.rates[0]).ir;
+  }
+
   soundwoofer::SWImpulseShared InternalIRs[] = {
-    soundwoofer::ir::createGeneric("Clean", InteralIR::cleanIR, InteralIR::cleanIRLength, 1, 48000, soundwoofer::EMBEDDED_SRC),
-    soundwoofer::ir::createGeneric("Air", InteralIR::airIR, InteralIR::airIRLength, 1, 48000, soundwoofer::EMBEDDED_SRC)
+    createInternalIR(InteralIR::cleanIRSource),
+    createInternalIR(InteralIR::airIRSource)
   };
 
   int InternalIRsCount = 2;
-}
\ No newline at end of file
+
+  namespace {
+    std::mutex internalIRMutex;
+    /** Index of the internal IR and samplerate to the version of it */
+    std::map<std::pair<int, size_t>, InternalIRVersion> internalIRVersions;
+  }
+
+  /**
+   * Returns the internal IR for the samplerate, the ir of the result is nullptr if it's not a internal IR
+   * The common rates come prepared, others get resampled once and are kept for everyone else
+   */
+  InternalIRVersion getInternalIR(const soundwoofer::SWImpulseShared& ir, const size_t sampleRate) {
+    int index = -1;
+    for (int i = 0; i < InternalIRsCount; i++) {
+      if (InternalIRs[i] == ir) { index = i; }
+    }
+    if (index < 0 || sampleRate == 0) { return InternalIRVersion(); }
+    std::lock_guard<std::mutex> lock(internalIRMutex);
+    InternalIRVersion& version = internalIRVersions[std::make_pair(index, sampleRate)];
+    if (version.ir != nullptr) { return version; }
+    const InternalIRSource& source = *InternalIRSources[index];
+    for (size_t i = 0; i < source.rateCount; i++) {
+      if (source.rates[i].sampleRate == sampleRate) {
+        version = createInternalIR(source, source.rates[i]);
+        return version;
+      }
+    }
+
+    // Odd samplerate, needs a copy of the samples since embedded IRs can't be resampled
+    float** samples = new float* [ir->channels];
+    for (size_t c = 0; c < ir->channels; c++) {
+      samples[c] = new float[ir->length];
+      std::copy(ir->samples[c], ir->samples[c] + ir->length, samples[c]);
+    }
+    version.ir = soundwoofer::ir::createGeneric(
+      ir->name, samples, ir->length, ir->channels, ir->sampleRate, soundwoofer::USER_SRC_ABSOLUTE
+    );
+    version.ir->normalized = true;
+    soundwoofer::wave::resampleIR(version.ir, sampleRate);
+    return version;
+  }
+
+  /**
+   * Loads the IR into the convolver, internal IRs don't need any resampling
+   * and also bring their spectra if they were compiled in
+   */
+  void loadCabIR(
+    WrappedConvolver& convolver, soundwoofer::SWImpulseShared ir, const size_t sampleRate, const size_t crossfade = 0
+  ) {
+    InternalIRVersion internal = getInternalIR(ir, sampleRate);
+    if (internal.ir != nullptr) {
+      ir = internal.ir;
+    }
+    else {
+      soundwoofer::ir::load(ir, sampleRate);
+    }
+    convolver.loadIR(ir->samples, ir->length, ir->channels, crossfade, internal.spectra);
+  }
+}
@@ -54,6 +54,7 @@ namespace guitard {
       printf("\n%s\n", homeDir.c_str());
       soundwoofer::setup::setPluginName("GuitarD");
       soundwoofer::setup::setHomeDirectory(homeDir.c_str());
+      NodePacks::discover(); // Needs the home directory
     }
 
     /**
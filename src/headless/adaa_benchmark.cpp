@@ -0,0 +1,134 @@
+/**
+ * Compares the aliasing and CPU cost of the ADAA drive nodes with the
+ * oversampled SimpleDriveNode. A sine at about 2.5 kHz is sent through each node,
+ * alias is the power of everything which isn't a harmonic of it relative to the harmonics.
+ * Since the tone falls exactly on a DFT bin, the harmonics can be measured without a window.
+ */
+
+#include "./GHeadless.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+
+using namespace guitard;
+
+const int Samplerate = 44100;
+const int Block = 128;
+const int Length = 65536; // Has to be a multiple of Block
+const int Bin = 3697; // About 2.49 kHz, prime so the harmonics don't line up with the aliases
+
+struct Setting {
+  const char* name;
+  sample value;
+};
+
+struct Config {
+  std::string label;
+  const char* node;
+  std::vector<Setting> settings;
+};
+
+bool setParameter(Node* node, const char* name, const sample value) {
+  for (int i = 0; i < node->mParameterCount; i++) {
+    if (strcmp(node->mParameters[i].name, name) == 0) {
+      node->mParameters[i].setValue(value);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Alias level in dB, DC and the harmonics below nyquist don't count
+ */
+double alias(const std::vector<sample>& out) {
+  double mean = 0, total = 0;
+  for (int i = 0; i < Length; i++) { mean += out[i]; }
+  mean /= Length;
+  for (int i = 0; i < Length; i++) { total += (out[i] - mean) * (out[i] - mean); }
+  total /= Length;
+  double harmonics = 0;
+  for (long long k = Bin; k < Length / 2; k += Bin) {
+    double re = 0, im = 0;
+    for (int i = 0; i < Length; i++) {
+      const double phase = 2 * shapes::Pi * static_cast<double>((k * i) % Length) / Length;
+      re += out[i] * std::cos(phase);
+      im += out[i] * std::sin(phase);
+    }
+    harmonics += 2 * (re * re + im * im) / (static_cast<double>(Length) * Length);
+  }
+  return 10 * std::log10((total - harmonics) / harmonics + 1e-30);
+}
+
+/**
+ * Runs the config in a graph of its own, returns the alias level and sets the cost in ns per sample
+ */
+double run(const Config& config, double& cost) {
+  Graph graph;
+  graph.OnReset(Samplerate, 2, 2);
+  Node* node = NodeList::createNode(config.node);
+  if (node == nullptr) {
+    cost = 0;
+    return 0;
+  }
+  graph.addNode(node);
+  graph.connectNodes(graph.getInputNode(), 0, node, 0);
+  graph.connectNodes(node, 0, graph.getOutputNode(), 0);
+  for (auto& s : config.settings) {
+    if (!setParameter(node, s.name, s.value)) {
+      std::cout << "Missing parameter " << s.name << " on " << config.node << "\n";
+    }
+  }
+
+  std::vector<sample> left(Length * 2), right(Length * 2), outLeft(Length * 2), outRight(Length * 2);
+  for (int i = 0; i < Length * 2; i++) {
+    left[i] = right[i] = static_cast<sample>(0.5 * std::sin(2 * shapes::Pi * ((static_cast<long long>(Bin) * i) % Length) / Length));
+  }
+
+  // First half warms up the filters, the second one gets measured
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < Length * 2; i += Block) {
+    sample* in[2] = { left.data() + i, right.data() + i };
+    sample* out[2] = { outLeft.data() + i, outRight.data() + i };
+    graph.ProcessBlock(in, out, Block);
+  }
+  const auto end = std::chrono::high_resolution_clock::now();
+  cost = std::chrono::duration<double, std::nano>(end - start).count() / (Length * 2);
+  graph.removeAllNodes();
+  return alias(std::vector<sample>(outLeft.begin() + Length, outLeft.end()));
+}
+
+int main() {
+  std::vector<Config> configs;
+  for (int factor : { 1, 2, 4 }) {
+    configs.push_back({ "SimpleDrive " + std::to_string(factor) + "x", "SimpleDriveNode", {
+      { "Drive", 1 }, { "OverSampling", static_cast<sample>(factor) }
+    } });
+  }
+  const char* shapeNames[] = { "tanh", "hard", "asym" };
+  for (int shape = 0; shape < 3; shape++) {
+    for (int order = 0; order <= 2; order++) {
+      configs.push_back({ std::string("ADAA Drive ") + shapeNames[shape] + " order " + std::to_string(order), "AdaaDriveNode", {
+        { "Drive", 0.5 }, { "Shape", static_cast<sample>(shape) }, { "ADAA Order", static_cast<sample>(order) }
+      } });
+    }
+  }
+  for (int order = 0; order <= 2; order++) {
+    configs.push_back({ "ADAA Fuzz order " + std::to_string(order), "AdaaFuzzNode", {
+      { "Drive", 0.5 }, { "Octave", 1 }, { "ADAA Order", static_cast<sample>(order) }
+    } });
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "\nConfig\tAlias dB\tns/sample\n";
+  for (auto& config : configs) {
+    double cost;
+    const double level = run(config, cost);
+    std::cout << config.label << "\t" << level << "\t" << cost << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * Compares the WrappedConvolver with a plain direct convolution for mono, stereo and true stereo IRs.
+ * The last case has inputs which only become the same after a while with a IR longer than
+ * the delay before the inputs share their transform, the part where they differed must still be heard.
+ * Prints the largest error for each case and returns 1 if one of them is off.
+ */
+
+// Same setup as GHeadless.h, but the graph isn't needed
+#define GUITARD_HEADLESS
+#define SAMPLE_TYPE_FLOAT
+#define GUITARD_SSE
+
+#include "../types/GConvolver.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+using namespace guitard;
+
+const int BlockSize = 128;
+const double Tolerance = 1e-3;
+
+/**
+ * Output of a single path at one position
+ */
+double direct(const std::vector<float>& ir, const std::vector<sample>& in, const size_t pos) {
+  double sum = 0;
+  for (size_t k = 0; k < ir.size() && k <= pos; k++) {
+    sum += double(ir[k]) * double(in[pos - k]);
+  }
+  return sum;
+}
+
+/**
+ * @param irs 1, 2 or 4 channels like WrappedConvolver::loadIR() takes them
+ * @return The largest difference to the direct convolution relative to the peak of the output
+ */
+double run(std::vector<std::vector<float>>& irs, std::vector<sample> in[2]) {
+  WrappedConvolver convolver(BlockSize);
+  convolver.mStereo = irs.size() > 1;
+  std::vector<float*> channels;
+  for (auto& ir : irs) { channels.push_back(ir.data()); }
+  convolver.loadIR(channels.data(), irs[0].size(), irs.size());
+
+  const size_t length = in[0].size() / BlockSize * BlockSize; // Only whole blocks get processed
+  std::vector<sample> out[2] = { std::vector<sample>(length), std::vector<sample>(length) };
+  for (size_t i = 0; i + BlockSize <= length; i += BlockSize) {
+    sample* blockIn[2] = { in[0].data() + i, in[1].data() + i };
+    sample* blockOut[2] = { out[0].data() + i, out[1].data() + i };
+    convolver.ProcessBlock(blockIn, blockOut, BlockSize);
+  }
+
+  double error = 0, peak = 0;
+  for (size_t i = 0; i < length; i += 7) { // Every few samples is enough and keeps it fast
+    for (int o = 0; o < 2; o++) {
+      double expected;
+      if (irs.size() == 4) {
+        expected = direct(irs[o], in[0], i) + direct(irs[2 + o], in[1], i);
+      }
+      else {
+        expected = direct(irs[std::min(size_t(o), irs.size() - 1)], in[irs.size() == 1 ? 0 : o], i);
+      }
+      error = std::max(error, std::abs(expected - double(out[o][i])));
+      peak = std::max(peak, std::abs(expected));
+    }
+  }
+  return error / std::max(peak, 1e-9);
+}
+
+int main() {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  auto makeIR = [&](const size_t length) {
+    std::vector<float> ir(length);
+    for (size_t i = 0; i < length; i++) {
+      ir[i] = dist(rng) * std::exp(-3.f * float(i) / float(length));
+    }
+    return ir;
+  };
+  auto makeInput = [&](const size_t length, std::vector<sample> in[2], const size_t differing) {
+    for (int c = 0; c < 2; c++) { in[c].resize(length); }
+    for (size_t i = 0; i < length; i++) {
+      in[0][i] = dist(rng);
+      in[1][i] = i < differing ? dist(rng) : in[0][i];
+    }
+  };
+
+  struct Case {
+    const char* name;
+    int channels;
+    size_t irLength;
+    size_t inputLength;
+    size_t differing; // Samples at the start where the inputs differ, the rest is the same on both
+  };
+  const Case cases[] = {
+    { "mono", 1, 3000, 20480, 20480 },
+    { "stereo", 2, 9000, 30720, 30720 },
+    { "true stereo", 4, 9000, 30720, 30720 },
+    { "stereo, same inputs", 2, 9000, 30720, 0 },
+    { "stereo, inputs become the same", 2, 40000, 80000, 10000 },
+  };
+
+  bool failed = false;
+  for (auto& c : cases) {
+    std::vector<std::vector<float>> irs;
+    for (int i = 0; i < c.channels; i++) { irs.push_back(makeIR(c.irLength)); }
+    std::vector<sample> in[2];
+    makeInput(c.inputLength, in, c.differing);
+    const double error = run(irs, in);
+    const bool ok = error < Tolerance;
+    failed = failed || !ok;
+    std::cout << c.name << "\t" << std::scientific << error << "\t" << (ok ? "ok" : "FAILED") << "\n";
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Generates the embedded IRs in src/content/ir from the waves next to them
+ * Each IR gets normalized and resampled to the common samplerates the same way soundwoofer does it,
+ * so cab nodes don't have to do that when they are created. The partition spectra for the block sizes
+ * of the WrappedConvolver are written too, they get compiled in with GUITARD_EMBEDDED_SPECTRA.
+ * Run it from the root of the repository after changing any of the waves, the resampler or the convolver.
+ */
+
+#define GUITARD_HEADLESS
+#define SAMPLE_TYPE_FLOAT
+#define SOUNDWOOFER_NO_API
+#define SOUNDWOOFER_IMPL
+
+#include "../types/GConvolver.h"
+#include "../../thirdparty/soundwoofer/soundwoofer.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace soundwoofer;
+
+struct EmbeddedWave {
+  std::string file; // Without extension
+  std::string name; // The name the IR shows up with
+};
+
+const EmbeddedWave waves[] = {
+  { "clean", "Clean" },
+  { "air", "Air" }
+};
+
+const size_t rates[] = { 44100, 48000, 88200, 96000 };
+
+/**
+ * The spectra are a lot bigger than the samples, so they are only done for the most common rates
+ */
+const size_t spectraRates[] = { 44100, 48000 };
+
+const std::string directory = "src/content/ir/";
+
+/**
+ * 9 digits are needed to get the exact float back, the spectra don't need to be that exact
+ */
+std::string number(const float value, const int digits) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+  return buffer;
+}
+
+void writeArray(std::stringstream& out, const std::string& declaration, const float* data, const size_t length,
+  const int digits = 9
+) {
+  out << "  " << declaration << "[] = {";
+  for (size_t i = 0; i < length; i++) {
+    if (i % 8 == 0) { out << "\n    "; }
+    out << number(data[i], digits) << (i + 1 < length ? "," : "");
+  }
+  out << "\n  };\n";
+}
+
+/**
+ * Writes the arrays of a partition set and returns its initializer
+ */
+std::string writePartitions(std::stringstream& out, const std::string& name, const guitard::IRPartitions& partitions) {
+  std::stringstream init;
+  init << "{ " << partitions.blockSize << ", " << partitions.first << ", " << partitions.count << ", " << partitions.stride << ", ";
+  if (partitions.empty()) {
+    init << "nullptr, nullptr }";
+    return init.str();
+  }
+  writeArray(out, "const float " + name + "Re", partitions.re.data(), partitions.count * partitions.stride, 8);
+  writeArray(out, "const float " + name + "Im", partitions.im.data(), partitions.count * partitions.stride, 8);
+  init << name << "Re, " << name << "Im }";
+  return init.str();
+}
+
+bool embed(const EmbeddedWave& wave) {
+  file::MappedFile mapped(directory + wave.file + ".wav");
+  if (!mapped.valid()) {
+    std::cout << "Can't open " << directory << wave.file << ".wav, run this from the repository root\n";
+    return false;
+  }
+
+  std::vector<size_t> targets(std::begin(rates), std::end(rates));
+  std::stringstream out;
+  out << "#pragma once\n";
+  out << "/**\n * Generated by src/headless/embed_irs.cpp from " << wave.file << ".wav, don't edit\n */\n";
+  out << "namespace InteralIR {\n";
+  std::stringstream table;
+  size_t sourceRate = 0;
+  size_t channels = 0;
+  guitard::WrappedConvolver convolver;
+  for (auto rate : targets) {
+    SWImpulseShared ir = std::make_shared<SWImpulse>();
+    ir->source = USER_SRC_ABSOLUTE;
+    if (wave::readWave(ir, mapped.data(), mapped.size()) != SUCCESS) {
+      std::cout << wave.file << ".wav uses a format which isn't supported\n";
+      return false;
+    }
+    sourceRate = ir->sampleRate;
+    channels = ir->channels;
+    wave::normalizeIR(ir);
+    wave::resampleIR(ir, rate);
+
+    const std::string name = wave.file + "IR" + std::to_string(rate);
+    std::stringstream pointers;
+    for (size_t c = 0; c < ir->channels; c++) {
+      const std::string channel = name + "C" + std::to_string(c);
+      writeArray(out, "float " + channel, ir->samples[c], ir->length);
+      pointers << channel << (c + 1 < ir->channels ? ", " : "");
+    }
+    out << "  float* " << name << "[] = { " << pointers.str() << " };\n";
+
+    const std::string spectraName = name + "Spectra";
+    if (std::find(std::begin(spectraRates), std::end(spectraRates), rate) == std::end(spectraRates)) {
+      table << "\n    { " << rate << ", " << ir->length << ", " << name << ", nullptr }" << (rate != targets.back() ? "," : "");
+      std::cout << wave.name << "\t" << rate << "\t" << ir->length << " samples\n";
+      continue;
+    }
+    out << "#ifdef GUITARD_EMBEDDED_SPECTRA\n";
+    std::stringstream spectra;
+    for (size_t c = 0; c < ir->channels; c++) {
+      const std::string channel = name + "C" + std::to_string(c);
+      guitard::IRSpectrumShared spectrum = convolver.prepare(ir->samples[c], ir->length);
+      const std::string head = writePartitions(out, channel + "Head", spectrum->head);
+      const std::string tail = writePartitions(out, channel + "Tail", spectrum->tail);
+      spectra << "\n    { " << spectrum->head.blockSize << ", " << spectrum->tail.blockSize << ", "
+        << GUITARD_FIR_CROSSOVER << ", " << spectrum->length << ", " << head << ", " << tail << " }"
+        << (c + 1 < ir->channels ? "," : "");
+    }
+    out << "  const guitard::PreparedSpectrum " << spectraName << "[] = {" << spectra.str() << "\n  };\n";
+    out << "#endif\n";
+
+    table << "\n    { " << rate << ", " << ir->length << ", " << name << ", GUITARD_INTERNAL_SPECTRA(" << spectraName << ") }"
+      << (rate != targets.back() ? "," : "");
+    std::cout << wave.name << "\t" << rate << "\t" << ir->length << " samples and spectra\n";
+  }
+  out << "  const guitard::InternalIRRate " << wave.file << "IRRates[] = {" << table.str() << "\n  };\n";
+  out << "  const guitard::InternalIRSource " << wave.file << "IRSource = { \"" << wave.name << "\", "
+    << channels << ", " << sourceRate << ", " << wave.file << "IRRates, " << targets.size() << " };\n";
+  out << "}\n";
+
+  std::ofstream header(directory + wave.file + ".ir", std::ios::binary);
+  header << out.str();
+  return header.good();
+}
+
+int main() {
+  for (auto& wave : waves) {
+    if (!embed(wave)) { return 1; }
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * Measures how long it takes to get a cab with one of the internal IRs going
+ * Runtime resamples the wave and does all the FFTs when the cab is created,
+ * prepared uses the samples from src/content/ir and prepared spectra also the precomputed spectra.
+ * Also makes sure the precomputed spectra sound the same as the ones done at runtime.
+ */
+
+// Same setup as GHeadless.h, but the graph isn't needed
+#define GUITARD_HEADLESS
+#define SAMPLE_TYPE_FLOAT
+#define GUITARD_SSE
+#define SOUNDWOOFER_NO_API
+#define SOUNDWOOFER_IMPL
+
+#include "../../thirdparty/soundwoofer/soundwoofer.h"
+#include "../content/ir/InternalIRs.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace guitard;
+
+template <class Func>
+double measure(Func func) {
+  const int runs = 20;
+  long long best = std::numeric_limits<long long>::max();
+  for (int run = 0; run < runs; run++) { // Take the fastest run to get rid of some noise
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, (long long) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+  return best / 1000.0;
+}
+
+/**
+ * The biggest difference between the outputs of the two convolvers for some noise
+ */
+float compare(WrappedConvolver& a, WrappedConvolver& b) {
+  const int blockSize = 128;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> noise(-1, 1);
+  std::vector<sample> in[2], outA[2], outB[2];
+  for (int c = 0; c < 2; c++) {
+    in[c].resize(blockSize);
+    outA[c].resize(blockSize);
+    outB[c].resize(blockSize);
+  }
+  sample* inP[2] = { in[0].data(), in[1].data() };
+  sample* outAP[2] = { outA[0].data(), outA[1].data() };
+  sample* outBP[2] = { outB[0].data(), outB[1].data() };
+  float error = 0;
+  for (int block = 0; block < 1000; block++) {
+    for (int i = 0; i < blockSize; i++) { in[0][i] = in[1][i] = noise(random); }
+    a.ProcessBlock(inP, outAP, blockSize);
+    b.ProcessBlock(inP, outBP, blockSize);
+    for (int i = 0; i < blockSize; i++) {
+      error = std::max(error, std::abs(static_cast<float>(outA[0][i] - outB[0][i])));
+    }
+  }
+  return error;
+}
+
+int main() {
+  const size_t rates[] = { 44100, 48000, 88200, 96000, 192000 };
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "\nIR\tRate\tRuntime us\tPrepared us\tPrepared spectra us\tMax difference\n";
+  for (int i = 0; i < InternalIRsCount; i++) {
+    const soundwoofer::SWImpulseShared source = InternalIRs[i];
+    for (auto rate : rates) {
+      // What it takes without anything prepared
+      const double runtime = measure([&]() {
+        float** samples = new float* [source->channels];
+        for (size_t c = 0; c < source->channels; c++) {
+          samples[c] = new float[source->length];
+          std::copy(source->samples[c], source->samples[c] + source->length, samples[c]);
+        }
+        soundwoofer::SWImpulseShared ir = soundwoofer::ir::createGeneric(
+          source->name, samples, source->length, source->channels, source->sampleRate, soundwoofer::USER_SRC_ABSOLUTE
+        );
+        soundwoofer::wave::resampleIR(ir, rate);
+        WrappedConvolver convolver;
+        convolver.loadIR(ir->samples, ir->length, ir->channels);
+      });
+
+      const InternalIRVersion version = getInternalIR(source, rate);
+      const soundwoofer::SWImpulseShared& ir = version.ir;
+      const double prepared = measure([&]() {
+        WrappedConvolver convolver;
+        convolver.loadIR(ir->samples, ir->length, ir->channels);
+      });
+
+      std::string spectra = "-", difference = "-";
+      if (version.spectra != nullptr) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << measure([&]() {
+          WrappedConvolver convolver;
+          convolver.loadIR(ir->samples, ir->length, ir->channels, 0, version.spectra);
+        });
+        spectra = ss.str();
+        WrappedConvolver a, b;
+        a.loadIR(ir->samples, ir->length, ir->channels);
+        b.loadIR(ir->samples, ir->length, ir->channels, 0, version.spectra);
+        ss.str("");
+        ss << std::scientific << std::setprecision(2) << compare(a, b);
+        difference = ss.str();
+      }
+
+      std::cout << source->name << "\t" << rate << "\t" << runtime << "\t\t" << prepared << "\t\t"
+        << spectra << "\t\t\t" << difference << "\n";
+    }
+  }
+  return 0;
+}
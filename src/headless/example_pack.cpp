@@ -0,0 +1,71 @@
+/**
+ * Minimal node pack with a single gain node, shows how GuitarDPack.h is used
+ * Build it as a shared library and copy it together with example_pack.json
+ * into the packs folder in the GuitarD home directory, e.g. on linux:
+ * g++ -O2 -shared -fPIC ./example_pack.cpp -o ~/GuitarD/packs/example_pack.so
+ * cp ./example_pack.json ~/GuitarD/packs/
+ * Define GUITARD_PACK_DOUBLE for packs used by the plugin, which runs in double precision,
+ * and set "double" to true in the json in that case.
+ */
+
+#include "../main/pack/GuitarDPack.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+  struct Gain {
+    int channels = 2;
+    double gain = 1;
+  };
+
+  const GuitarDPackParameter GainParameters[] = {
+    { "Gain", 0, -40, 12, 0.1 }
+  };
+
+  void* create(int, int, int channels) {
+    Gain* gain = new Gain();
+    gain->channels = channels;
+    return gain;
+  }
+
+  void destroy(void* instance) {
+    delete static_cast<Gain*>(instance);
+  }
+
+  void setChannels(void* instance, int channels) {
+    static_cast<Gain*>(instance)->channels = channels;
+  }
+
+  void setParameter(void* instance, int index, double value) {
+    if (index == 0) {
+      static_cast<Gain*>(instance)->gain = std::pow(10, value / 20.0);
+    }
+  }
+
+  void process(void* instance, GuitarDPackSample*** inputs, GuitarDPackSample*** outputs, int channels, int frames) {
+    const Gain* gain = static_cast<Gain*>(instance);
+    for (int c = 0; c < channels; c++) {
+      for (int i = 0; i < frames; i++) {
+        outputs[0][c][i] = static_cast<GuitarDPackSample>(inputs[0][c][i] * gain->gain);
+      }
+    }
+  }
+
+  const GuitarDPackNode Nodes[] = {
+    {
+      "ExamplePackGainNode", "Pack Gain", "Tools", "Gain node loaded from a node pack",
+      1, 1, 1, GainParameters,
+      create, destroy, nullptr, setChannels, nullptr, setParameter, process,
+      nullptr, nullptr, nullptr
+    }
+  };
+
+  const GuitarDPack Pack = {
+    GUITARD_PACK_ABI_VERSION, sizeof(GuitarDPackSample), "Example Pack",
+    sizeof(Nodes) / sizeof(GuitarDPackNode), Nodes
+  };
+}
+
+extern "C" GUITARD_PACK_EXPORT const GuitarDPack* guitard_pack_entry() {
+  return &Pack;
+}
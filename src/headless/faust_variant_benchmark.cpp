@@ -0,0 +1,123 @@
+/**
+ * Times every variant scripts/compile_faust.py generates for each faust node at a few blocksizes
+ * and prints the fastest ones in the format src/main/faust/FaustVariants.h expects.
+ * Build it the same way as the target (instruction set, remove SAMPLE_TYPE_FLOAT below for the plugin builds),
+ * since that's what the choice is for. The deviation column is the largest difference to the scalar double output,
+ * larger values mean the float variant changes the sound.
+ */
+
+// Same setup as GHeadless.h, but only the graph is needed
+#define GUITARD_HEADLESS
+#define SAMPLE_TYPE_FLOAT
+#define GUITARD_SSE
+#define SOUNDWOOFER_NO_API
+#define SOUNDWOOFER_IMPL
+
+#include "../../thirdparty/soundwoofer/soundwoofer.h"
+#include "../main/Graph.h"
+#include "../main/faust/generated/AllVariants.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace guitard;
+using FaustGenerated::FaustVariant;
+
+const int Samplerate = 48000;
+const int Length = Samplerate * 5;
+
+/**
+ * Runs noise through the variant and returns the fastest of a few runs in ns per sample
+ */
+double run(const FaustVariant& variant, const int block, const std::vector<sample>& noise, std::vector<sample>& result) {
+  NodeList::NodeInfo info;
+  info.name = String(variant.name) + "_" + variant.suffix;
+  Graph graph;
+  graph.OnReset(Samplerate, 2, 2);
+  Node* node = variant.create();
+  node->setNodeInfo(&info);
+  graph.addNode(node);
+  graph.connectNodes(graph.getInputNode(), 0, node, 0);
+  graph.connectNodes(node, 0, graph.getOutputNode(), 0);
+
+  std::vector<sample> left(block), right(block);
+  sample* out[2] = { left.data(), right.data() };
+  double best = std::numeric_limits<double>::max();
+  result.resize(Length);
+  for (int r = 0; r < 3; r++) {
+    graph.OnTransport();
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i + block <= Length; i += block) {
+      sample* in[2] = { const_cast<sample*>(noise.data()) + i, const_cast<sample*>(noise.data()) + i };
+      graph.ProcessBlock(in, out, block);
+      std::copy(left.begin(), left.end(), result.begin() + i);
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / Length);
+  }
+  graph.removeAllNodes();
+  return best;
+}
+
+int main() {
+  const int blocks[] = { 16, 64, 128, 512 };
+  std::vector<sample> noise(Length);
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  for (auto& s : noise) { s = dist(rng); }
+
+  std::vector<std::string> selection;
+  std::vector<sample> reference, result;
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "\nNode\tVariant";
+  for (int block : blocks) { std::cout << "\t" << block << " ns"; }
+  std::cout << "\tDeviation\n";
+
+  const size_t count = sizeof(FaustGenerated::AllVariants) / sizeof(FaustVariant);
+  for (size_t start = 0; start < count;) {
+    const std::string name = FaustGenerated::AllVariants[start].name;
+    size_t end = start;
+    while (end < count && name == FaustGenerated::AllVariants[end].name) { end++; }
+
+    double fastest = std::numeric_limits<double>::max();
+    const FaustVariant* best = nullptr;
+    for (size_t v = start; v < end; v++) {
+      const FaustVariant& variant = FaustGenerated::AllVariants[v];
+      std::cout << name << "\t" << variant.suffix;
+      double total = 0;
+      for (int block : blocks) {
+        const double cost = run(variant, block, noise, result);
+        total += cost;
+        std::cout << "\t" << cost;
+        if (block == 128 && variant.id == GUITARD_FAUST_SCALAR_DOUBLE) { reference = result; }
+      }
+      double deviation = 0;
+      if (!reference.empty()) {
+        run(variant, 128, noise, result);
+        for (int i = 0; i < Length; i++) {
+          deviation = std::max(deviation, static_cast<double>(std::abs(result[i] - reference[i])));
+        }
+      }
+      std::cout << "\t" << std::scientific << deviation << std::fixed << "\n";
+      if (total < fastest) {
+        fastest = total;
+        best = &variant;
+      }
+    }
+    std::string suffix = best->suffix;
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::toupper);
+    selection.push_back("  #define GUITARD_FAUST_VARIANT_" + name + " GUITARD_FAUST_" + suffix);
+    reference.clear();
+    start = end;
+  }
+
+  std::cout << "\nFastest variants summed over all blocksizes:\n";
+  for (auto& line : selection) { std::cout << line << "\n"; }
+  return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * Finds the IR length up to which the direct form FIR is faster than
+ * the partitioned convolution for different blocksizes.
+ * The suggested value can be used for GUITARD_FIR_CROSSOVER
+ */
+
+// Same setup as GHeadless.h, but the graph isn't needed
+#define GUITARD_HEADLESS
+#define SAMPLE_TYPE_FLOAT
+#define GUITARD_SSE
+
+#include "../types/GConvolver.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+using Sample = fftconvolver::Sample;
+
+/**
+ * Time in microseconds it takes to convolve a second of audio
+ */
+long long measure(const std::vector<Sample>& ir, const size_t crossover, const int blockSize) {
+  const int samplerate = 48000;
+  guitard::SpectralConvolver convolver;
+  convolver.init(128, 1024 * 4, crossover);
+  convolver.setIR(convolver.prepare(ir.data(), ir.size()));
+  std::vector<Sample> in(blockSize, 0.5), out(blockSize);
+  long long best = std::numeric_limits<long long>::max();
+  for (int run = 0; run < 3; run++) { // Take the fastest run to get rid of some noise
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < samplerate; i += blockSize) {
+      convolver.process(in.data(), out.data(), blockSize);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, (long long) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+  }
+  return best;
+}
+
+int main() {
+  const int sizes[] = { 512, 256, 128, 64, 32, 16 };
+  const size_t maxTaps = 2048;
+  const size_t fftOnly = 0;
+  const size_t firOnly = std::numeric_limits<size_t>::max();
+
+  std::mt19937 random(0);
+  std::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<Sample> longIr(1024 * 20);
+  for (auto& i : longIr) { i = dist(random); }
+
+  std::cout << "\nBlock\tCrossover\tLong IR FFT head us\tLong IR FIR head us\n";
+  std::vector<size_t> crossovers;
+  for (auto blockSize : sizes) {
+    size_t crossover = maxTaps;
+    for (size_t taps = 16; taps <= maxTaps; taps += 16) {
+      std::vector<Sample> ir(longIr.begin(), longIr.begin() + taps);
+      if (measure(ir, fftOnly, blockSize) < measure(ir, firOnly, blockSize)) {
+        crossover = taps - 16;
+        break;
+      }
+    }
+    crossovers.push_back(crossover);
+    std::cout << blockSize << "\t" << crossover << "\t\t"
+      << measure(longIr, fftOnly, blockSize) << "\t\t\t"
+      << measure(longIr, 128, blockSize) << "\n";
+  }
+
+  std::sort(crossovers.begin(), crossovers.end());
+  std::cout << "\nSuggested GUITARD_FIR_CROSSOVER " << crossovers[crossovers.size() / 2] << "\n";
+  return 0;
+}
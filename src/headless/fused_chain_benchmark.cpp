@@ -0,0 +1,103 @@
+/**
+ * Runs every chain listed in scripts/compile_faust.py once as separate nodes and once as the fused dsp
+ * the graph swaps in for them and prints the cost per sample for a few blocksizes.
+ * The deviation column is the largest difference between the two outputs, it should be close to 0
+ * since the fused code does the same math, only the order of the float operations might differ.
+ */
+
+#include "./GHeadless.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace guitard;
+
+const int Samplerate = 48000;
+const int Length = Samplerate * 5;
+
+/**
+ * Puts the nodes of the chain between in- and output and moves all the parameters away from their defaults
+ */
+bool buildChain(Graph& graph, const FusedChains::Chain& chain) {
+  Node* prev = graph.getInputNode();
+  for (auto& name : chain.nodes) {
+    Node* node = NodeList::createNode(name);
+    if (node == nullptr) { return false; }
+    graph.addNode(node);
+    graph.connectNodes(prev, 0, node, 0);
+    for (int i = 0; i < node->mParameterCount; i++) {
+      ParameterCoupling& p = node->mParameters[i];
+      if (i == node->mByPassedIndex || i == node->mOverSamplingIndex || i == node->mOverSamplingQualityIndex) { continue; }
+      p.setValue(p.min + (p.max - p.min) * 0.3);
+    }
+    prev = node;
+  }
+  graph.connectNodes(prev, 0, graph.getOutputNode(), 0);
+  return true;
+}
+
+/**
+ * Returns the fastest of a few runs in ns per sample
+ */
+double run(Graph& graph, const int block, const std::vector<sample>& noise, std::vector<sample>& result) {
+  std::vector<sample> left(block), right(block);
+  sample* out[2] = { left.data(), right.data() };
+  double best = std::numeric_limits<double>::max();
+  result.resize(Length);
+  for (int r = 0; r < 3; r++) {
+    graph.OnTransport();
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i + block <= Length; i += block) {
+      sample* in[2] = { const_cast<sample*>(noise.data()) + i, const_cast<sample*>(noise.data()) + i };
+      graph.ProcessBlock(in, out, block);
+      std::copy(left.begin(), left.end(), result.begin() + i);
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / Length);
+  }
+  return best;
+}
+
+int main() {
+  const int blocks[] = { 16, 64, 128, 512 };
+  std::vector<sample> noise(Length);
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  for (auto& s : noise) { s = dist(rng); }
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "\nChain\tMode";
+  for (int block : blocks) { std::cout << "\t" << block << " ns"; }
+  std::cout << "\tDeviation\n";
+
+  std::vector<sample> separate, fused;
+  for (auto chain : FusedChains::chains) {
+    Graph graph;
+    graph.OnReset(Samplerate, 2, 2);
+    if (!buildChain(graph, *chain)) {
+      std::cout << chain->info.name << "\tmissing nodes\n";
+      continue;
+    }
+    for (int mode = 0; mode < 2; mode++) {
+      graph.setFuseChains(mode == 1);
+      std::cout << chain->info.name << "\t" << (mode == 1 ? "fused" : "separate");
+      for (int block : blocks) {
+        std::cout << "\t" << run(graph, block, noise, mode == 1 ? fused : separate);
+      }
+      double deviation = 0;
+      if (mode == 1) {
+        for (int i = 0; i < Length; i++) {
+          deviation = std::max(deviation, static_cast<double>(std::abs(fused[i] - separate[i])));
+        }
+      }
+      std::cout << "\t" << std::scientific << deviation << std::fixed << "\n";
+    }
+    graph.removeAllNodes();
+  }
+  return 0;
+}
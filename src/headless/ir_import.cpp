@@ -0,0 +1,89 @@
+/**
+ * Imports a whole folder of IRs into the processed IR cache of the plugin using all cores
+ * The folders get listed in the IR index and every wave gets hashed, decoded, normalized, resampled to the given rates and trimmed,
+ * so the plugin can map the results right away instead of doing all of that the first time a IR is used.
+ *
+ * Usage: ir_import [folder] [--rates 44100,48000] [--threads n] [--home dir] [--no-normalize] [--no-trim]
+ * The folder defaults to the IR directory of the plugin, the home directory to the one of the user.
+ */
+
+#define SOUNDWOOFER_NO_API
+#define SOUNDWOOFER_IMPL
+
+#include "../../thirdparty/soundwoofer/soundwoofer.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace soundwoofer;
+
+std::string userHome() {
+  const char* home = getenv("HOME");
+#ifdef _WIN32
+  if (home == nullptr) { home = getenv("USERPROFILE"); }
+#endif
+  return home != nullptr ? home : ".";
+}
+
+int main(int argc, char** argv) {
+  std::string folder;
+  std::string home = userHome();
+  std::vector<size_t> rates = { 44100, 48000 };
+  size_t threads = 0;
+  bool normalize = true;
+  bool trim = true;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--rates" && hasValue) {
+      rates.clear();
+      std::stringstream list(argv[++i]);
+      std::string rate;
+      while (std::getline(list, rate, ',')) {
+        rates.push_back(std::strtoul(rate.c_str(), nullptr, 10));
+      }
+    }
+    else if (arg == "--threads" && hasValue) { threads = std::strtoul(argv[++i], nullptr, 10); }
+    else if (arg == "--home" && hasValue) { home = argv[++i]; }
+    else if (arg == "--no-normalize") { normalize = false; }
+    else if (arg == "--no-trim") { trim = false; }
+    else if (arg.compare(0, 2, "--") == 0) {
+      std::cout << "Unknown option " << arg << "\n";
+      return 1;
+    }
+    else { folder = arg; }
+  }
+
+  // Same setup as GHeadless.h so the plugin finds the blobs
+  setup::setPluginName("GuitarD");
+  if (setup::setHomeDirectory(home) != SUCCESS) {
+    std::cout << "Can't set up the home directory in " << home << "\n";
+    return 1;
+  }
+  setup::setIRProcessing(SWProcessing(), trim);
+  if (folder.empty()) { folder = state::irDirectory; }
+
+  std::cout << "Importing " << folder << " into " << state::processedCacheDirectory << "\n";
+  import::Report report;
+  const Status status = import::folder(folder, rates, normalize, report, threads, [](size_t done, size_t total) {
+    if (done % 100 == 0 || done == total) {
+      std::cout << "\r" << done << " / " << total << std::flush;
+    }
+  });
+
+  const double seconds = std::max(report.seconds, 1e-9);
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "\n\nFiles\t\t" << report.files << "\n";
+  std::cout << "Imported\t" << report.imported << " (" << report.blobs << " blobs)\n";
+  std::cout << "Cached already\t" << report.cached << "\n";
+  std::cout << "Duplicates\t" << report.duplicates << "\n";
+  std::cout << "Failed\t\t" << report.failed << "\n";
+  std::cout << "Time\t\t" << seconds << " s\n";
+  std::cout << "Throughput\t" << report.files / seconds << " files/s, "
+    << report.bytes / seconds / (1024 * 1024) << " MB/s\n";
+  return status == SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/**
+ * Checks the quality and speed of the polyphase resampler used for IR import
+ * against the old biquad + sinc resampler for the common samplerate ratios.
+ * Ripple is the worst gain error of tones in the passband, rejection is how far
+ * below the tone everything else (images, aliasing) ends up
+ * and how much of a tone above the new nyquist frequency makes it through.
+ */
+
+#define SOUNDWOOFER_IMPL
+#include "../../thirdparty/soundwoofer/soundwooferResampler.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace soundwoofer;
+
+std::vector<float> tone(const double frequency, const size_t rate, const size_t length) {
+  std::vector<float> result(length);
+  for (size_t i = 0; i < length; i++) {
+    result[i] = static_cast<float>(0.5 * std::sin(2 * PI * frequency * i / rate));
+  }
+  return result;
+}
+
+/**
+ * Least squares fit of a sine at the given frequency, ignores the edges
+ * Returns the gain relative to the 0.5 amplitude of the input and the residual in dB relative to the fit
+ */
+void fit(const float* signal, const size_t length, const double frequency, const size_t rate, double& gain, double& residual) {
+  const size_t edge = length / 8;
+  double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+  for (size_t i = edge; i < length - edge; i++) {
+    const double s = std::sin(2 * PI * frequency * i / rate);
+    const double c = std::cos(2 * PI * frequency * i / rate);
+    ss += s * s; cc += c * c; sc += s * c; ys += signal[i] * s; yc += signal[i] * c;
+  }
+  const double det = ss * cc - sc * sc;
+  const double a = (ys * cc - yc * sc) / det;
+  const double b = (yc * ss - ys * sc) / det;
+  double error = 0, power = 0;
+  for (size_t i = edge; i < length - edge; i++) {
+    const double s = std::sin(2 * PI * frequency * i / rate);
+    const double c = std::cos(2 * PI * frequency * i / rate);
+    const double e = signal[i] - (a * s + b * c);
+    error += e * e;
+    power += (a * s + b * c) * (a * s + b * c);
+  }
+  gain = std::sqrt(a * a + b * b) / 0.5;
+  residual = 10 * std::log10(error / power + 1e-30);
+}
+
+double rms(const float* signal, const size_t length) {
+  const size_t edge = length / 8;
+  double power = 0;
+  for (size_t i = edge; i < length - edge; i++) { power += signal[i] * signal[i]; }
+  return std::sqrt(power / (length - 2 * edge));
+}
+
+template <class Func>
+long long measure(Func func) {
+  long long best = std::numeric_limits<long long>::max();
+  for (int run = 0; run < 3; run++) { // Take the fastest run to get rid of some noise
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, (long long) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+  }
+  return best;
+}
+
+int main() {
+  const size_t rates[] = { 44100, 48000, 88200, 96000, 192000 };
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "\nIn\tOut\tTaps\tRipple dB\tRejection dB\tAlias dB\tOld ripple dB\tOld rejection dB\tNew us\tOld us\n";
+  for (auto in : rates) {
+    for (auto out : rates) {
+      if (in == out) { continue; }
+      const size_t length = in; // A second of audio
+      const double nyquist = std::min(in, out) * 0.5;
+      PolyphaseResampler polyphase(in, out);
+      if (!polyphase.valid()) { continue; }
+
+      // Passband, tones up to the start of the transition band
+      double ripple = 0, rejection = -std::numeric_limits<double>::max();
+      double oldRipple = 0, oldRejection = -std::numeric_limits<double>::max();
+      for (double f = 50; f < nyquist * 0.9; f *= 1.5) {
+        std::vector<float> signal = tone(f, in, length);
+        float* input = signal.data();
+        float* output = nullptr;
+        size_t outLength = polyphase.resample(&input, 1, length, &output);
+        double gain, residual;
+        fit(output, outLength, f, out, gain, residual);
+        ripple = std::max(ripple, std::abs(20 * std::log10(gain)));
+        rejection = std::max(rejection, residual);
+        delete[] output;
+
+        Resampler resampler(in, out);
+        outLength = resampler.resample(input, length, &output);
+        fit(output, outLength, f, out, gain, residual);
+        oldRipple = std::max(oldRipple, std::abs(20 * std::log10(gain)));
+        oldRejection = std::max(oldRejection, residual);
+        delete[] output;
+      }
+
+      // Tone between the nyquist frequencies, only exists when going down
+      std::string alias = "-";
+      if (out < in) {
+        const double f = (out * 0.5 + in * 0.5) * 0.5;
+        std::vector<float> signal = tone(f, in, length);
+        float* input = signal.data();
+        float* output = nullptr;
+        const size_t outLength = polyphase.resample(&input, 1, length, &output);
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << -20 * std::log10(rms(output, outLength) / (0.5 / std::sqrt(2)) + 1e-30);
+        alias = ss.str();
+        delete[] output;
+      }
+
+      // Speed for a stereo IR
+      std::vector<float> left = tone(1000, in, length), right = tone(1500, in, length);
+      float* stereo[2] = { left.data(), right.data() };
+      float* result[2] = { nullptr, nullptr };
+      const long long newTime = measure([&]() {
+        polyphase.resample(stereo, 2, length, result);
+        delete[] result[0];
+        delete[] result[1];
+      });
+      const long long oldTime = measure([&]() {
+        Resampler resampler(in, out);
+        for (int c = 0; c < 2; c++) {
+          resampler.resample(stereo[c], length, &result[c]);
+          delete[] result[c];
+        }
+      });
+
+      std::cout << in << "\t" << out << "\t" << polyphase.getTable()->taps << "\t"
+        << ripple << "\t\t" << -rejection << "\t\t" << alias << "\t\t"
+        << oldRipple << "\t\t" << -oldRejection << "\t\t\t"
+        << newTime << "\t" << oldTime << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../GConfig.h"
+#include "../types/GTypes.h"
+#include "../types/GPointerList.h"
+#include "./Node.h"
+#include "./faust/FusedFaustDsp.h"
+
+namespace guitard {
+  /**
+   * A chain of faust nodes there's a fused dsp for, e.g. ParametricEq -> BandSplit -> StereoTool
+   * The nodes stay in the graph as they are, so the gui, presets and automation don't notice anything,
+   * but instead of processing them one by one the fused dsp runs once with their parameters.
+   * The graph forms these when building the processing list, see Graph::buildFusedRegions().
+   * Bypassing a node only bypasses its stage in the fused dsp,
+   * but as soon as one of the nodes gets oversampled they process on their own again.
+   */
+  class FusedRegion {
+    PointerList<Node> mNodes;
+    FaustGenerated::FusedFaustDsp* mDsp = nullptr;
+    bool mFused = false;
+
+  public:
+    /**
+     * Allocates, don't call it from the audio thread
+     * @param nodes In processing order, each one only feeds the next one
+     * @param dsp Already bound to the nodes, the region takes ownership
+     */
+    FusedRegion(const PointerList<Node>& nodes, FaustGenerated::FusedFaustDsp* dsp) : mNodes(nodes), mDsp(dsp) {
+    }
+
+    ~FusedRegion() {
+      delete mDsp;
+    }
+
+    GUITARD_NO_COPY(FusedRegion)
+
+    Node* getEntry() const {
+      return mNodes[0];
+    }
+
+    /**
+     * The region processes when the graph gets to this node
+     */
+    Node* getExit() const {
+      return mNodes[mNodes.size() - 1];
+    }
+
+    bool contains(const Node* node) const {
+      return mNodes.find(node) != -1;
+    }
+
+    const PointerList<Node>& getNodes() const {
+      return mNodes;
+    }
+
+    void OnReset(const int pSampleRate, const int pChannels) {
+      mDsp->OnReset(pSampleRate, pChannels);
+    }
+
+    void OnTransport() {
+      mDsp->OnTransport();
+    }
+
+    void ProcessBlock(const int nFrames) {
+      bool fused = true;
+      for (size_t i = 0; i < mNodes.size(); i++) {
+        Node* node = mNodes[i];
+        node->updateOversampling(); // Bypass is left to the dsp or the node itself
+        fused = fused && node->getOversamplingFactor() == 1 && node->mChannelCount == 2;
+      }
+
+      if (fused != mFused) {
+        // Neither side knows the state of the other one, so it starts from scratch like on a transport
+        mFused = fused;
+        if (fused) {
+          mDsp->OnTransport();
+        }
+        else {
+          for (size_t i = 0; i < mNodes.size(); i++) {
+            mNodes[i]->OnTransport();
+          }
+        }
+      }
+
+      if (!fused) {
+        for (size_t i = 0; i < mNodes.size(); i++) {
+          mNodes[i]->ProcessBlock(nFrames);
+        }
+        return;
+      }
+      mDsp->processChain(getEntry()->mSocketsIn[0].mBuffer, getExit()->mSocketsOut[0].mBuffer, nFrames);
+    }
+  };
+}
@@ -5,9 +5,12 @@
 #include "../types/GMutex.h"
 #include "../types/GTypes.h"
 #include "../types/GPointerList.h"
+#include "../types/GScratchArena.h"
 #include "../nodes/io/InputNode.h"
 #include "../nodes/io/OutputNode.h"
 #include "./parameter/ParameterManager.h"
+#include "./OversampledRegion.h"
+#include "./FusedRegion.h"
 
 //#define GUITARD_GRAPH_MUTEX // A mutex seems the safest but also excessive
 #define GUITARD_GRAPH_ATOMIC
@@ -33,6 +36,36 @@ namespace guitard {
      */
     PointerList<Node> mProcessList;
 
+    /**
+     * Chains of nodes in the process list which share their oversampling
+     */
+    PointerList<OversampledRegion> mRegions;
+
+    /**
+     * The region of each node in mProcessList or nullptr, the region processes at the position of its last node
+     */
+    PointerList<OversampledRegion> mProcessRegions;
+
+    /**
+     * Chains of faust nodes which run as one fused dsp, see FusedRegion
+     */
+    PointerList<FusedRegion> mFusedRegions;
+
+    /**
+     * The fused region of each node in mProcessList or nullptr, processes at the position of its last node
+     */
+    PointerList<FusedRegion> mProcessFused;
+
+    /**
+     * Whether chains with a fused dsp get replaced by it
+     */
+    bool mFuseChains = true;
+
+    /**
+     * Scratch memory for the thread processing the graph, big enough for the hungriest node or region
+     */
+    ScratchArena* mScratch = new ScratchArena();
+
     /**
      * Acts as a semaphore since the mAudioMutex only needs to be locked once to stop the audio thread
      */
@@ -108,6 +141,7 @@ namespace guitard {
 
     ~Graph() {
       removeAllNodes();
+      delete mScratch;
       // TODOG get rid of all the things
     }
 
@@ -173,6 +207,9 @@ namespace guitard {
         for (int i = 0; i < mNodes.size(); i++) {
           mNodes[i]->OnReset(pSampleRate, pOutputChannels);
         }
+        for (int i = 0; i < mFusedRegions.size(); i++) {
+          mFusedRegions[i]->OnReset(pSampleRate, pOutputChannels);
+        }
         unlockAudioThread();
       }
       else {
@@ -193,6 +230,12 @@ namespace guitard {
       for (size_t i = 0; i < mNodes.size(); i++) {
         mNodes[i]->OnTransport();
       }
+      for (size_t i = 0; i < mRegions.size(); i++) {
+        mRegions[i]->OnTransport();
+      }
+      for (size_t i = 0; i < mFusedRegions.size(); i++) {
+        mFusedRegions[i]->OnTransport();
+      }
       unlockAudioThread();
     }
 
@@ -215,6 +258,15 @@ namespace guitard {
       unlockAudioThread();
     }
 
+    /**
+     * Turns the fused chains on or off, see FusedRegion
+     */
+    void setFuseChains(const bool fuse) {
+      if (fuse == mFuseChains) { return; }
+      mFuseChains = fuse;
+      buildProcessingList();
+    }
+
     /**
      * Main entry point for the DSP
      */
@@ -261,6 +313,7 @@ namespace guitard {
 #else
       mIsProcessing = true;
 #endif
+      ScratchArena::Scope scratch(*mScratch);
 
       mInputNode->CopyIn(in, nFrames);
 
@@ -269,7 +322,19 @@ namespace guitard {
       }
 
       for (int n = 0; n < mProcessList.size(); n++) {
-        mProcessList[n]->ProcessBlock(nFrames);
+        OversampledRegion* region = mProcessRegions[n];
+        FusedRegion* fused = mProcessFused[n];
+        if (fused != nullptr) {
+          if (fused->getExit() == mProcessList[n]) {
+            fused->ProcessBlock(nFrames);
+          }
+        }
+        else if (region == nullptr) {
+          mProcessList[n]->ProcessBlock(nFrames);
+        }
+        else if (region->getExit() == mProcessList[n]) {
+          region->ProcessBlock(nFrames);
+        }
       }
 
       mOutputNode->CopyOut(out, nFrames);
@@ -400,6 +465,8 @@ namespace guitard {
         assert(false);
       }
 
+      dropRegions(node);
+
       node->cleanUp();
 
       if (mPauseAudio == 1) {
@@ -787,6 +854,23 @@ namespace guitard {
         }
       }
 
+      // Allocates, so it's done before the audio thread gets paused
+      PointerList<FusedRegion> fusedRegions;
+      PointerList<Node> taken;
+      if (mFuseChains) {
+        buildFusedRegions(stack, fusedRegions, taken);
+      }
+      PointerList<OversampledRegion> regions;
+      buildRegions(stack, regions, taken);
+      size_t scratchSize = 0;
+      for (int i = 0; i < mNodes.size(); i++) {
+        scratchSize = std::max(scratchSize, mNodes[i]->getScratchSize());
+      }
+      for (int i = 0; i < regions.size(); i++) {
+        scratchSize = std::max(scratchSize, regions[i]->getScratchSize());
+      }
+      ScratchArena* scratch = scratchSize > mScratch->size() ? new ScratchArena(scratchSize) : nullptr;
+
 
       lockAudioThread();
       mProcessList.clear();
@@ -814,10 +898,201 @@ namespace guitard {
       for (int i = 0; i < feedback.size(); i++) {
         mProcessList.add(feedback[i]);
       }
+
+      ScratchArena* oldScratch = nullptr;
+      if (scratch != nullptr) {
+        oldScratch = mScratch;
+        mScratch = scratch;
+      }
+      PointerList<OversampledRegion> oldRegions = mRegions;
+      mRegions = regions;
+      mProcessRegions.clear();
+      for (int i = 0; i < mProcessList.size(); i++) {
+        OversampledRegion* region = nullptr;
+        for (int r = 0; r < mRegions.size(); r++) {
+          if (mRegions[r]->contains(mProcessList[i])) {
+            region = mRegions[r];
+          }
+        }
+        mProcessRegions.add(region);
+      }
+      PointerList<FusedRegion> oldFused = mFusedRegions;
+      mFusedRegions = fusedRegions;
+      mProcessFused.clear();
+      for (int i = 0; i < mProcessList.size(); i++) {
+        FusedRegion* region = nullptr;
+        for (int r = 0; r < mFusedRegions.size(); r++) {
+          if (mFusedRegions[r]->contains(mProcessList[i])) {
+            region = mFusedRegions[r];
+          }
+        }
+        mProcessFused.add(region);
+      }
       unlockAudioThread();
+
+      for (int i = 0; i < oldRegions.size(); i++) {
+        if (mRegions.find(oldRegions[i]) == -1) {
+          delete oldRegions[i];
+        }
+      }
+      for (int i = 0; i < oldFused.size(); i++) {
+        if (mFusedRegions.find(oldFused[i]) == -1) {
+          delete oldFused[i];
+        }
+      }
+      delete oldScratch;
     }
 
   private:
+    /**
+     * Finds chains of nodes which can oversample together, each node in a chain only feeds the next one
+     * so the ones in between never have to be at the samplerate of the graph
+     */
+    void buildRegions(const PointerList<Node>& stack, PointerList<OversampledRegion>& regions, PointerList<Node> taken) {
+      for (int i = 0; i < stack.size(); i++) {
+        Node* node = stack[i];
+        if (taken.find(node) != -1 || !node->canShareOversampling()) { continue; }
+        NodeSocket* in = node->mSocketsIn[0].mConnectedTo[0];
+        if (in != nullptr && getChainedNode(in->mParentNode) == node) { continue; } // Not the start of a chain
+
+        PointerList<Node> chain;
+        for (Node* n = node; n != nullptr && chain.find(n) == -1; n = getChainedNode(n)) {
+          chain.add(n);
+          taken.add(n);
+        }
+        if (chain.size() > 1) {
+          // Keep the region if the chain didn't change so the oversampler doesn't lose its state
+          OversampledRegion* region = findRegion(mRegions, chain);
+          if (region == nullptr || region->getChannels() != node->mChannelCount) {
+            region = new OversampledRegion(chain, node->mChannelCount);
+          }
+          regions.add(region);
+        }
+      }
+    }
+
+    /**
+     * Deletes the regions the node is part of, so a new node at the same address can't end up in them
+     * Only call this while the audio thread is locked, the nodes process on their own until the list gets rebuilt
+     */
+    void dropRegions(const Node* node) {
+      mProcessRegions.clear();
+      mProcessFused.clear();
+      for (int r = 0; r < mRegions.size(); r++) {
+        if (mRegions[r]->contains(node)) {
+          mRegions.remove(r--, true);
+        }
+      }
+      for (int r = 0; r < mFusedRegions.size(); r++) {
+        if (mFusedRegions[r]->contains(node)) {
+          mFusedRegions.remove(r--, true);
+        }
+      }
+    }
+
+    /**
+     * The current region made of exactly these nodes in the same order or nullptr
+     */
+    template <class Region>
+    static Region* findRegion(const PointerList<Region>& regions, const PointerList<Node>& nodes) {
+      for (int r = 0; r < regions.size(); r++) {
+        const PointerList<Node>& other = regions[r]->getNodes();
+        if (other.size() != nodes.size()) { continue; }
+        bool same = true;
+        for (int i = 0; i < nodes.size() && same; i++) {
+          same = other[i] == nodes[i];
+        }
+        if (same) { return regions[r]; }
+      }
+      return nullptr;
+    }
+
+    /**
+     * The node after this one in a oversampling chain or nullptr
+     */
+    static Node* getChainedNode(Node* node) {
+      if (!node->canShareOversampling()) { return nullptr; }
+      NodeSocket* out = &node->mSocketsOut[0];
+      NodeSocket* next = out->mConnectedTo[0];
+      if (next == nullptr || out->mConnectedTo[1] != nullptr) { return nullptr; } // Someone else needs the output
+      Node* nextNode = next->mParentNode;
+      if (nextNode == node || !nextNode->canShareOversampling()) { return nullptr; }
+      if (nextNode->mSocketsIn[0].mConnectedTo[0] != out) { return nullptr; }
+      return nextNode;
+    }
+
+    /**
+     * Finds chains of nodes there's a fused dsp for, see FusedFaustDsp
+     * The longest chain wins if several of them start at the same node
+     * @param taken Gets the nodes which are part of a chain
+     */
+    void buildFusedRegions(const PointerList<Node>& stack, PointerList<FusedRegion>& regions, PointerList<Node>& taken) {
+      for (int i = 0; i < stack.size(); i++) {
+        Node* node = stack[i];
+        if (taken.find(node) != -1) { continue; }
+        FusedChains::Chain* best = nullptr;
+        PointerList<Node> bestNodes;
+        for (size_t c = 0; c < FusedChains::chains.size(); c++) {
+          FusedChains::Chain* chain = FusedChains::chains[c];
+          if (best != nullptr && best->nodes.size() >= chain->nodes.size()) { continue; }
+          PointerList<Node> nodes;
+          Node* n = node;
+          for (size_t k = 0; k < chain->nodes.size() && n != nullptr; k++) {
+            if (n->mInfo->name != chain->nodes[k] || taken.find(n) != -1 || !usesFirstSocketsOnly(n)) { break; }
+            nodes.add(n);
+            n = k + 1 < chain->nodes.size() ? getFusableNode(n) : nullptr;
+          }
+          if (nodes.size() == chain->nodes.size()) {
+            best = chain;
+            bestNodes = nodes;
+          }
+        }
+        if (best == nullptr) { continue; }
+
+        // Keep the region if the chain didn't change so the fused dsp doesn't lose its state
+        FusedRegion* region = findRegion(mFusedRegions, bestNodes);
+        if (region == nullptr) {
+          FaustGenerated::FusedFaustDsp* dsp = FusedChains::createDsp(best);
+          dsp->setup(mSampleRate, mMaxBlockSize);
+          if (!dsp->bind(bestNodes)) {
+            WDBGMSG("Fused chain %s doesn't match its nodes\n", best->info.name.c_str());
+            delete dsp;
+            continue;
+          }
+          region = new FusedRegion(bestNodes, dsp);
+        }
+        for (int k = 0; k < bestNodes.size(); k++) {
+          taken.add(bestNodes[k]);
+        }
+        regions.add(region);
+      }
+    }
+
+    /**
+     * The fused dsp only passes the first input and output socket, so nothing may be connected to the others
+     */
+    static bool usesFirstSocketsOnly(Node* node) {
+      for (int i = 1; i < node->mInputCount; i++) {
+        if (node->mSocketsIn[i].mConnectedTo[0] != nullptr) { return false; }
+      }
+      for (int i = 1; i < node->mOutputCount; i++) {
+        if (node->mSocketsOut[i].mConnectedTo[0] != nullptr) { return false; }
+      }
+      return true;
+    }
+
+    /**
+     * The next node in a fused chain if it only gets its input from this one and nothing else uses the output
+     */
+    static Node* getFusableNode(Node* node) {
+      NodeSocket* out = &node->mSocketsOut[0];
+      NodeSocket* next = out->mConnectedTo[0];
+      if (next == nullptr || out->mConnectedTo[1] != nullptr || next->mIndex != 0) { return nullptr; }
+      Node* nextNode = next->mParentNode;
+      if (nextNode == node || nextNode->mSocketsIn[0].mConnectedTo[0] != out) { return nullptr; }
+      return nextNode;
+    }
+
     void topSort(Node* n, PointerList<Node>& visited, PointerList<Node>& stack) {
       visited.add(n);
       for (int i = 0; i < n->mDependencyCount; i++) {
@@ -24,6 +24,8 @@ namespace guitard {
   public: // Everything is public since it most of it needs to be accessible from the graph and the NodeUi
     sample mOverSamplingFactor = 1.0; // The oversampling factor bound to the control
     int mOverSamplingIndex = -1;
+    sample mOverSamplingQuality = 1.0; // Index into OversamplingQualities
+    int mOverSamplingQualityIndex = -1;
 
     int mSampleRate = 0;
     int mLastBlockSize = 0;
@@ -178,6 +180,19 @@ namespace guitard {
       return true;
     }
 
+    /**
+     * Pushes the parameters which changed to the dsp values, except bypass and oversampling which are handled elsewhere
+     * Returns true if any of them changed, so derived values only need to be recomputed then
+     */
+    bool updateParameters() const {
+      bool changed = false;
+      for (int i = 0; i < mParameterCount; i++) {
+        if (i == mByPassedIndex || i == mOverSamplingIndex || i == mOverSamplingQualityIndex) { continue; }
+        changed = mParameters[i].update() || changed;
+      }
+      return changed;
+    }
+
     /**
      * Main Processing, only takes a blocksize since the node knows its inputs
      */
@@ -204,15 +219,62 @@ namespace guitard {
     void updateOversampling() {
       if (mOverSampler != nullptr) {
         mParameters[mOverSamplingIndex].update();
-        int fac = std::floor(mOverSamplingFactor);
-        if (fac != mOverSampler->mFactor && mSampleRate > 0) {
-          float prevFac = mOverSampler->mFactor;
-          mOverSampler->mFactor = fac;
-          OnSamplerateChanged(mSampleRate / prevFac);
+        mParameters[mOverSamplingQualityIndex].update();
+        mOverSampler->setQuality(static_cast<int>(std::round(mOverSamplingQuality)));
+        const unsigned int fac = std::max(1, static_cast<int>(std::floor(mOverSamplingFactor)));
+        const unsigned int prevFac = mOverSampler->mFactor;
+        if (fac != prevFac && mSampleRate > 0) {
+          // Only powers of two are possible, the samplerate has to use what the oversampler ended up with
+          if (mOverSampler->setFactor(fac) != prevFac) {
+            OnSamplerateChanged(mSampleRate / prevFac);
+          }
         }
       }
     }
 
+    /**
+     * The factor the node processes at, 1 if it doesn't oversample
+     */
+    unsigned int getOversamplingFactor() const {
+      return mOverSampler != nullptr ? mOverSampler->mFactor : 1;
+    }
+
+    int getOversamplingQuality() const {
+      return mOverSampler != nullptr ? mOverSampler->getQuality() : 0;
+    }
+
+    /**
+     * True if the graph can put the node in a OversampledRegion
+     * Needs its own oversampling and a single input and output to chain it with others
+     */
+    virtual bool canShareOversampling() { return false; }
+
+    /**
+     * Processes a block which is already at the oversampled rate of the region the node is in
+     * in and out have mChannelCount channels of nFrames, see OversampledRegion
+     */
+    virtual void ProcessOversampled(sample** in, sample** out, const int nFrames) { }
+
+    /**
+     * Bytes of ScratchArena the node needs while processing a block
+     */
+    virtual size_t getScratchSize() const {
+      if (mOverSampler != nullptr) {
+        return mOverSampler->getScratchSize();
+      }
+      return 0;
+    }
+
+    /**
+     * The delay the node adds in samples at the samplerate of the graph, so it can be compensated
+     */
+    virtual double getLatency() const {
+      if (mOverSampler != nullptr) {
+        return mOverSampler->getLatency();
+      }
+      return 0;
+    }
+
     /**
      * Called once when the node is constructed to allow oversampling later on
      */
@@ -220,7 +282,10 @@ namespace guitard {
       if (mOverSampler == nullptr) {
         mOverSamplingFactor = 1.0;
         mOverSampler = new Oversampler();
-        mOverSamplingIndex = addParameter("OverSampling", &mOverSamplingFactor, 1.0, 1, 4, 1);
+        mOverSamplingIndex = addParameter("OverSampling", &mOverSamplingFactor, 1.0, 1, 16, 1);
+        mOverSamplingQualityIndex = addParameter(
+          "OverSampling Quality", &mOverSamplingQuality, 1.0, 0, OversamplingQualityCount - 1, 1
+        );
       }
     }
 
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../GConfig.h"
+#include "../types/GTypes.h"
+#include "../types/GPointerList.h"
+#include "../types/GOversampler.h"
+#include "./Node.h"
+
+namespace guitard {
+  /**
+   * A chain of nodes which would all oversample on their own, e.g. drive -> fuzz -> sag
+   * Instead of each of them going up and down again, the block gets upsampled once for the first node,
+   * all the nodes run back to back at the high rate and the last one gets downsampled once.
+   * The graph forms these when building the processing list, see Graph::buildRegions().
+   * The chain only gets shared if all nodes are set to the same factor, otherwise they oversample on their own.
+   */
+  class OversampledRegion {
+    PointerList<Node> mNodes;
+    Oversampler* mOverSampler = nullptr;
+    int mChannels = 0;
+    bool mShared = false;
+
+    /**
+     * The nodes in between write to these at the high rate, two of them so a node never works in place
+     * Only valid while processing, they come from the ScratchArena
+     */
+    sample** mHigh[2] = { nullptr };
+
+  public:
+    /**
+     * Allocates, don't call it from the audio thread
+     * @param nodes In processing order, each one only feeds the next one
+     */
+    OversampledRegion(const PointerList<Node>& nodes, const int channels) : mNodes(nodes), mChannels(channels) {
+      mOverSampler = new Oversampler(channels, channels);
+      mOverSampler->mProc = [&](sample** in, sample** out, const int nFrames) {
+        processNodes(in, out, nFrames);
+      };
+    }
+
+    ~OversampledRegion() {
+      delete mOverSampler;
+    }
+
+    GUITARD_NO_COPY(OversampledRegion)
+
+    Node* getEntry() const {
+      return mNodes[0];
+    }
+
+    /**
+     * The region processes when the graph gets to this node
+     */
+    Node* getExit() const {
+      return mNodes[mNodes.size() - 1];
+    }
+
+    bool contains(const Node* node) const {
+      return mNodes.find(node) != -1;
+    }
+
+    const PointerList<Node>& getNodes() const {
+      return mNodes;
+    }
+
+    int getChannels() const {
+      return mChannels;
+    }
+
+    /**
+     * Delay of the whole chain in samples at the samplerate of the graph
+     */
+    double getLatency() const {
+      if (mShared) { return mOverSampler->getLatency(); }
+      double latency = 0;
+      for (size_t i = 0; i < mNodes.size(); i++) {
+        latency += mNodes[i]->getLatency();
+      }
+      return latency;
+    }
+
+    /**
+     * Scratch memory needed for a block of frames at the given factor, defaults to the worst case
+     */
+    size_t getScratchSize(const int frames = GUITARD_MAX_BUFFER, const unsigned int factor = Oversampler::MaxFactor) const {
+      int stages = 0;
+      while ((2u << stages) <= factor) { stages++; }
+      return mOverSampler->getScratchSize(frames, stages)
+        + 2 * ScratchArena::channelBytes<sample>(mChannels, frames * factor);
+    }
+
+    void OnTransport() {
+      mOverSampler->setFactor(1); // Clears the filters once the region gets shared again
+      mShared = false;
+    }
+
+    void ProcessBlock(const int nFrames) {
+      unsigned int factor = 0;
+      int quality = 0;
+      bool shared = true;
+      for (size_t i = 0; i < mNodes.size(); i++) {
+        Node* node = mNodes[i];
+        node->updateOversampling();
+        const unsigned int f = node->getOversamplingFactor();
+        if (i == 0) { factor = f; }
+        shared = shared && f == factor && node->mChannelCount == mChannels;
+        quality = std::max(quality, node->getOversamplingQuality());
+      }
+      shared = shared && factor > 1;
+
+      if (!shared) {
+        if (mShared) { mOverSampler->setFactor(1); }
+        mShared = false;
+        for (size_t i = 0; i < mNodes.size(); i++) {
+          mNodes[i]->ProcessBlock(nFrames);
+        }
+        return;
+      }
+
+      mShared = true;
+      mOverSampler->setQuality(quality);
+      mOverSampler->setFactor(factor);
+      ScratchArena& arena = ScratchArena::current();
+      if (!arena.reserve(getScratchSize(nFrames, factor))) {
+        assert(false); // The graph didn't make enough space
+        silence(nFrames);
+        return;
+      }
+      ScratchArena::Frame frame(arena);
+      for (int b = 0; b < 2; b++) {
+        mHigh[b] = arena.takeChannels<sample>(mChannels, nFrames * factor);
+        if (mHigh[b] == nullptr) {
+          silence(nFrames);
+          return;
+        }
+      }
+      mOverSampler->process(getEntry()->mSocketsIn[0].mBuffer, getExit()->mSocketsOut[0].mBuffer, nFrames);
+    }
+
+  private:
+    /**
+     * Used when there's no scratch memory left, so the last block doesn't get repeated
+     */
+    void silence(const int nFrames) {
+      sample** out = getExit()->mSocketsOut[0].mBuffer;
+      for (int c = 0; c < mChannels; c++) {
+        for (int i = 0; i < nFrames; i++) { out[c][i] = 0; }
+      }
+    }
+
+    void processNodes(sample** in, sample** out, const int nFrames) {
+      const int last = static_cast<int>(mNodes.size()) - 1;
+      for (int i = 0; i <= last; i++) {
+        sample** target = i == last ? out : mHigh[i % 2];
+        mNodes[i]->ProcessOversampled(in, target, nFrames);
+        in = target;
+      }
+    }
+  };
+}
@@ -1,4 +1,5 @@
 #include "../FaustHeadlessDsp.h"
+#include "../FusedFaustDsp.h"
 
 
 #define min(a,b) (((a)<(b))?(a):(b))
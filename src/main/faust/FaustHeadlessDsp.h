@@ -1,7 +1,11 @@
 #pragma once
 
+#include <vector>
+#include <cstring>
+#include <cstdlib>
 #include "../Node.h"
 #define FAUSTFLOAT sample
+#define GUITARD_FAUST_STAGE_PREFIX "stage"
 
 namespace guitard {
   namespace FaustGenerated {
@@ -15,18 +19,41 @@ namespace guitard {
       };
     };
 
+    /**
+     * A control of faust code compiled from a chain of dsp files, see FusedFaustDsp
+     */
+    struct StageControl {
+      int stage; // Index of the dsp in the chain
+      const char* name;
+      FAUSTFLOAT* prop;
+      bool isMeter;
+      ParameterCoupling* parameter; // Set once the chain is bound to the nodes it replaces
+      MeterCoupling* meter;
+    };
+
     /**
      * This is a shim to collect pointers to all the properties/parameters from the faust DSP code
      */
     struct UI {
       const char* name;
       Node* node = nullptr;
+
+      /**
+       * Fused chains collect their controls here instead of turning them into parameters
+       * Each dsp of the chain sits in a hgroup labeled GUITARD_FAUST_STAGE_PREFIX + index
+       */
+      std::vector<StageControl>* stageControls = nullptr;
+      int stage = -1;
+      int depth = 0;
+      int stageDepth = -1;
+
       UI(Node* n) {
         node = n;
         name = GUITARD_DEFAULT_NODE_NAME;
       }
 
       void openVerticalBox(const char* key) {
+        depth++;
         // NOTE This only is the name of the module if it has one box!
         if (name != GUITARD_DEFAULT_NODE_NAME) {
           WDBGMSG("openVerticalBox called multiple times. The node Type might be wrong!");
@@ -35,14 +62,34 @@ namespace guitard {
         name = key;
       };
 
-      static void openHorizontalBox(const char* key) {};
-      static void closeBox() {};
+      void openHorizontalBox(const char* key) {
+        depth++;
+        const size_t prefix = strlen(GUITARD_FAUST_STAGE_PREFIX);
+        if (stage == -1 && strncmp(key, GUITARD_FAUST_STAGE_PREFIX, prefix) == 0) {
+          stage = atoi(key + prefix);
+          stageDepth = depth;
+        }
+      };
+
+      void closeBox() {
+        if (depth == stageDepth) {
+          stage = -1;
+          stageDepth = -1;
+        }
+        depth--;
+      };
+
       static void declare(FAUSTFLOAT*, const char*, const char*) {};
 
       void addHorizontalSlider(
           const char* name, FAUSTFLOAT* prop, FAUSTFLOAT pDefault,
           FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT stepSize
       ) const {
+        if (stageControls != nullptr) {
+          *prop = pDefault;
+          stageControls->push_back({ stage, name, prop, false, nullptr, nullptr });
+          return;
+        }
         node->addParameter(name, prop, pDefault, min, max, stepSize);
       }
 
@@ -58,6 +105,11 @@ namespace guitard {
       }
 
       void addVerticalBargraph(const char* name, FAUSTFLOAT* prop, FAUSTFLOAT min, FAUSTFLOAT max) const {
+        if (stageControls != nullptr) {
+          *prop = 0;
+          stageControls->push_back({ stage, name, prop, true, nullptr, nullptr });
+          return;
+        }
         node->addMeter(name, prop, min, max);
       };
 
@@ -77,6 +129,21 @@ namespace guitard {
       FAUSTFLOAT** mBuffersOutAligned = nullptr;
       FAUSTFLOAT** mBuffersInAligned = nullptr;
 
+      /**
+       * Set when the slow terms have to be computed again even though no parameter changed
+       */
+      bool mControlDirty = true;
+
+      /**
+       * Pushes the changed parameters to the faust code and only recomputes the control rate terms if needed
+       */
+      void updateControl() {
+        if (updateFaustParameters() || mControlDirty) {
+          mControlDirty = false;
+          control();
+        }
+      }
+
     public:
       // These three will be overridden by the generated faust code
       virtual void init(int samplingFreq) = 0;
@@ -88,6 +155,26 @@ namespace guitard {
       virtual void instanceClear() = 0;
       virtual void metadata(Meta* m) = 0;
 
+      /**
+       * Code generated with -ec computes all the terms only depending on parameters here instead of in every compute()
+       * Older generated code doesn't have it and does that on its own
+       */
+      virtual void control() { }
+
+      /**
+       * Pushes the changed parameters to the faust code and returns true if any of them changed
+       */
+      virtual bool updateFaustParameters() {
+        return updateParameters();
+      }
+
+      /**
+       * Only fused chains collect their controls instead of getting parameters, see FusedFaustDsp
+       */
+      virtual std::vector<StageControl>* getStageControls() {
+        return nullptr;
+      }
+
       void setup(
           const int pSamplerate, const int pMaxBuffer = GUITARD_MAX_BUFFER,
           int pInputs = 1, int pOutputs = 1, const int pChannels = 2
@@ -105,9 +192,11 @@ namespace guitard {
          * the right ones so the automation will affect the correct parameters
          */
         UI faustUi(this);
+        faustUi.stageControls = getStageControls();
 
         buildUserInterface(&faustUi);
         init(pSamplerate);
+        mControlDirty = true;
 
         if (mInfo->name == GUITARD_DEFAULT_NODE_NAME) { // If a name wasn't set from outside, use the from faust
           mInfo->name = faustUi.name;
@@ -141,10 +230,12 @@ namespace guitard {
       void OnSamplerateChanged(const int pSamplerate) override {
         Node::OnSamplerateChanged(pSamplerate);
         instanceConstants(mSampleRate);
+        mControlDirty = true;
       }
 
       void OnTransport() override {
         instanceClear();
+        mControlDirty = true;
       }
 
       /**
@@ -178,6 +269,7 @@ namespace guitard {
           mBuffersInAligned = new FAUSTFLOAT * [mInputCount * mChannelCount];
         }
         instanceClear();
+        mControlDirty = true;
       }
 
       void OnConnectionsChanged() override {
@@ -193,6 +285,8 @@ namespace guitard {
 
       void enableOversampling() override {
         Node::enableOversampling();
+        // All faust channels go through the lanes of the oversampler in one go
+        mOverSampler->setChannels(getNumInputs(), getNumOutputs());
         mOverSampler->mProc = [&](sample** inputs, sample** outputs, int nFrames) {
           this->compute(nFrames, inputs, outputs);
         };
@@ -204,18 +298,39 @@ namespace guitard {
        */
       void ProcessBlock(const int nFrames) override {
         if (byPass()) { return; }
-        for (int i = 1; i < mParameterCount; i++) {
-          mParameters[i].update();
-        }
         if (mOverSampler != nullptr) {
-          updateOversampling();
+          updateOversampling(); // Might change the samplerate, so this goes first
+          updateControl();
           mOverSampler->process(mBuffersInAligned, mBuffersOutAligned, nFrames);
         }
         else {
+          updateControl();
           compute(nFrames, mBuffersInAligned, mBuffersOutAligned);
         }
       }
 
+      bool canShareOversampling() override {
+        return mOverSampler != nullptr && mInputCount == 1 && mOutputCount == 1
+          && getNumInputs() == mChannelCount && getNumOutputs() == mChannelCount;
+      }
+
+      /**
+       * Same as ProcessBlock, but the region the node is in takes care of the oversampling
+       */
+      void ProcessOversampled(sample** in, sample** out, const int nFrames) override {
+        mParameters[mByPassedIndex].update();
+        if (mByPassed >= 0.5) {
+          for (int c = 0; c < mChannelCount; c++) {
+            for (int i = 0; i < nFrames; i++) {
+              out[c][i] = in[c][i];
+            }
+          }
+          return;
+        }
+        updateControl();
+        compute(nFrames, in, out);
+      }
+
       /**
        * Retrieve the copyright info from the faust generated code
        */
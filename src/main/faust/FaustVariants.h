@@ -0,0 +1,43 @@
+#pragma once
+
+#include "./FaustHeadlessDsp.h"
+
+/**
+ * scripts/compile_faust.py compiles each dsp file in all of these variants,
+ * generated/<name>.h then picks the one set here for the current build as FaustGenerated::<name>
+ * The ids have to match the suffixes in the script
+ */
+#define GUITARD_FAUST_SCALAR_DOUBLE 0
+#define GUITARD_FAUST_SCALAR_FLOAT 1
+#define GUITARD_FAUST_VEC16_DOUBLE 2
+#define GUITARD_FAUST_VEC16_FLOAT 3
+#define GUITARD_FAUST_VEC32_DOUBLE 4
+#define GUITARD_FAUST_VEC32_FLOAT 5
+
+/**
+ * Variant used by all nodes of a build, a single node can still be switched by defining
+ * GUITARD_FAUST_VARIANT_<name> with the output of src/headless/faust_variant_benchmark.cpp built like the target.
+ * Float builds like the headless ones run the float code, so there's no double math and conversion for every sample.
+ * The plugin keeps the double precision code the faust nodes always used, the filters with low cutoffs need it.
+ */
+#ifndef GUITARD_FAUST_DEFAULT_VARIANT
+  #ifdef SAMPLE_TYPE_FLOAT
+    #define GUITARD_FAUST_DEFAULT_VARIANT GUITARD_FAUST_SCALAR_FLOAT
+  #else
+    #define GUITARD_FAUST_DEFAULT_VARIANT GUITARD_FAUST_SCALAR_DOUBLE
+  #endif
+#endif
+
+namespace guitard {
+  namespace FaustGenerated {
+    /**
+     * One compiled variant of a dsp, see generated/AllVariants.h
+     */
+    struct FaustVariant {
+      const char* name;
+      int id;
+      const char* suffix;
+      FaustHeadlessDsp* (*create)();
+    };
+  }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include "./FaustHeadlessDsp.h"
+#include "../../types/GPointerList.h"
+
+namespace guitard {
+  namespace FaustGenerated {
+    /**
+     * Faust code compiled from a chain of dsp files, e.g. ParametricEq -> BandSplit -> StereoTool
+     * scripts/compile_faust.py generates these for the chains listed there.
+     * The whole chain runs in one compute() loop instead of each node going over the block and its buffers.
+     * It has no parameters of its own, the graph binds it to the nodes it stands in for
+     * and takes the values from their parameters, see FusedRegion.
+     */
+    class FusedFaustDsp : public FaustHeadlessDsp {
+      std::vector<StageControl> mControls;
+
+      /**
+       * Set when all values have to be taken from the nodes again, not only the changed ones
+       */
+      bool mPullAll = true;
+
+    public:
+      std::vector<StageControl>* getStageControls() override {
+        return &mControls;
+      }
+
+      /**
+       * Looks up the parameter or meter with the same name in the node of each stage
+       * Allocates nothing, but don't call it while processing
+       * @param nodes The nodes the chain replaces in the order of the stages
+       * @return False if the nodes don't fit the chain
+       */
+      bool bind(const PointerList<Node>& nodes) {
+        for (size_t i = 0; i < mControls.size(); i++) {
+          StageControl& c = mControls[i];
+          c.parameter = nullptr;
+          c.meter = nullptr;
+          if (c.stage < 0 || c.stage >= static_cast<int>(nodes.size())) { return false; }
+          Node* node = nodes[c.stage];
+          if (c.isMeter) {
+            for (int m = 0; m < node->mMeterCount; m++) {
+              if (strcmp(node->mMeters[m].name, c.name) == 0) {
+                c.meter = &node->mMeters[m];
+              }
+            }
+            if (c.meter == nullptr) { return false; }
+          }
+          else {
+            for (int p = 0; p < node->mParameterCount; p++) {
+              if (strcmp(node->mParameters[p].name, c.name) == 0) {
+                c.parameter = &node->mParameters[p];
+              }
+            }
+            if (c.parameter == nullptr) { return false; }
+          }
+        }
+        mPullAll = true;
+        return true;
+      }
+
+      bool updateFaustParameters() override {
+        bool changed = mPullAll;
+        for (size_t i = 0; i < mControls.size(); i++) {
+          const StageControl& c = mControls[i];
+          if (c.parameter != nullptr && (c.parameter->update() || mPullAll)) {
+            *c.prop = c.parameter->getDspValue();
+            changed = true;
+          }
+        }
+        mPullAll = false;
+        return changed;
+      }
+
+      void OnTransport() override {
+        FaustHeadlessDsp::OnTransport();
+        mPullAll = true;
+      }
+
+      /**
+       * Processes the whole chain and hands the meters back to the nodes
+       */
+      void processChain(sample** in, sample** out, const int nFrames) {
+        ProcessOversampled(in, out, nFrames); // Works on the buffers it's given, which is all that's needed here
+        for (size_t i = 0; i < mControls.size(); i++) {
+          const StageControl& c = mControls[i];
+          if (c.meter != nullptr) {
+            *c.meter->value = *c.prop;
+          }
+        }
+      }
+    };
+  }
+
+  /**
+   * Global list of the fused chains, filled by generated/FusedChains.h
+   */
+  namespace FusedChains {
+    struct Chain {
+      std::vector<String> nodes; // Node type names in processing order
+      NodeList::NodeInfo info;
+      FaustGenerated::FusedFaustDsp* (*create)();
+    };
+
+    std::vector<Chain*> chains;
+
+    /**
+     * Creates the fused dsp for the chain, allocates
+     */
+    inline FaustGenerated::FusedFaustDsp* createDsp(Chain* chain) {
+      FaustGenerated::FusedFaustDsp* dsp = chain->create();
+      dsp->setNodeInfo(&chain->info);
+      return dsp;
+    }
+
+    template <class T>
+    struct RegisterProxy {
+      RegisterProxy(const char* name, std::vector<String> nodes) {
+        Chain* chain = new Chain();
+        chain->nodes = nodes;
+        chain->info.name = name;
+        chain->info.hidden = true;
+        chain->create = []() -> FaustGenerated::FusedFaustDsp* { return new T(); };
+        chains.push_back(chain);
+      }
+    };
+  }
+}
+
+/**
+ * Used in generated/FusedChains.h, the first argument is the generated class followed by the node type names
+ */
+#define GUITARD_REGISTER_FUSED_CHAIN(type, ...) \
+namespace FusedChains { \
+  RegisterProxy<FaustGenerated::type> reg##type(GUITARD_STR(type), { __VA_ARGS__ });\
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * C interface between GuitarD and node packs, shared libraries in the packs folder next to the IRs and presets
+ * This is plain C on purpose, packs can be built with any compiler, optimization flags or language,
+ * the only thing they have to provide is guitard_pack_entry() which returns a GuitarDPack.
+ * A pack should also ship a <library name>.json listing its nodes, so the library only gets loaded
+ * once a preset actually uses one of them. It also has to say whether the pack was built with
+ * GUITARD_PACK_DOUBLE ("double": true), so packs for the wrong sample type don't show up at all.
+ * See src/headless/example_pack.cpp.
+ *
+ * Bump GUITARD_PACK_ABI_VERSION on every change to the structs below,
+ * GuitarD refuses packs built against another version.
+ */
+
+#define GUITARD_PACK_ABI_VERSION 1
+
+#ifdef _WIN32
+  #define GUITARD_PACK_EXPORT __declspec(dllexport)
+#else
+  #define GUITARD_PACK_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The sample type has to match the one GuitarD was built with, the headless version uses float
+ * GuitarD checks sampleSize when loading the pack
+ */
+#ifdef GUITARD_PACK_DOUBLE
+  typedef double GuitarDPackSample;
+#else
+  typedef float GuitarDPackSample;
+#endif
+
+typedef struct GuitarDPackParameter {
+  const char* name;
+  double defaultValue;
+  double min;
+  double max;
+  double stepSize;
+} GuitarDPackParameter;
+
+/**
+ * Everything GuitarD needs to know about a node type, all the functions get the instance returned by create
+ * Functions marked optional can be NULL
+ */
+typedef struct GuitarDPackNode {
+  const char* name; // Unique, used to serialize the node, so it shouldn't change
+  const char* displayName;
+  const char* category;
+  const char* description;
+  int inputs; // Sockets, each one has channels buffers
+  int outputs;
+  int parameterCount; // Bypass gets added by GuitarD
+  const GuitarDPackParameter* parameters;
+
+  void* (*create)(int sampleRate, int maxBlockSize, int channels);
+  void (*destroy)(void* instance);
+  void (*setSampleRate)(void* instance, int sampleRate); // Optional
+  void (*setChannels)(void* instance, int channels); // Optional
+  void (*reset)(void* instance); // Optional, called on transport to clear tails
+  void (*setParameter)(void* instance, int index, double value); // Only called when the value changed
+
+  /**
+   * Called from the audio thread, inputs[socket][channel][frame]
+   * Unconnected inputs contain silence, frames is never larger than maxBlockSize
+   */
+  void (*process)(void* instance, GuitarDPackSample*** inputs, GuitarDPackSample*** outputs, int channels, int frames);
+
+  /**
+   * Optional, additional state besides the parameters as a null terminated string, e.g. a json or base64 blob
+   * The string belongs to the instance and only has to be valid until the next call
+   */
+  const char* (*serialize)(void* instance);
+  void (*deserialize)(void* instance, const char* data); // Optional
+
+  double (*getLatency)(void* instance); // Optional, in samples
+} GuitarDPackNode;
+
+typedef struct GuitarDPack {
+  int abiVersion; // GUITARD_PACK_ABI_VERSION
+  int sampleSize; // sizeof(GuitarDPackSample)
+  const char* name;
+  int nodeCount;
+  const GuitarDPackNode* nodes;
+} GuitarDPack;
+
+typedef const GuitarDPack* (*GuitarDPackEntry)(void);
+
+#define GUITARD_PACK_ENTRY_NAME "guitard_pack_entry"
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <fstream>
+#include "../../../thirdparty/soundwoofer/soundwoofer.h"
+#include "../../types/GTypes.h"
+#include "../factory/NodeList.h"
+#include "./PackNode.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+#endif
+
+namespace guitard {
+  /**
+   * Finds node packs and registers their nodes in the NodeList, see GuitarDPack.h
+   * Only the json next to a library is read at startup, the library itself gets loaded
+   * the first time one of its nodes is created. Libraries stay loaded until the process ends
+   * since there's no telling whether some graph still holds a node from it.
+   */
+  namespace NodePacks {
+    struct Library {
+      String path;
+      void* handle = nullptr;
+      const GuitarDPack* pack = nullptr;
+      bool failed = false;
+      std::vector<String> nodes; // Names of the nodes registered for it
+    };
+
+    std::vector<Library*> libraries;
+
+#ifdef _WIN32
+    const String LIBRARY_EXTENSION = ".dll";
+#elif defined(__APPLE__)
+    const String LIBRARY_EXTENSION = ".dylib";
+#else
+    const String LIBRARY_EXTENSION = ".so";
+#endif
+
+    /**
+     * Opens the library and checks the pack is compatible, returns nullptr if it isn't
+     * Does nothing if it's already loaded or failed before
+     */
+    inline const GuitarDPack* load(Library* library) {
+      if (library->pack != nullptr || library->failed) { return library->pack; }
+      library->failed = true;
+#ifdef _WIN32
+      HMODULE handle = LoadLibraryA(library->path.c_str());
+      if (handle == nullptr) {
+        WDBGMSG("Failed to load node pack %s\n", library->path.c_str());
+        return nullptr;
+      }
+      auto entry = reinterpret_cast<GuitarDPackEntry>(GetProcAddress(handle, GUITARD_PACK_ENTRY_NAME));
+#else
+      void* handle = dlopen(library->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+      if (handle == nullptr) {
+        WDBGMSG("Failed to load node pack %s: %s\n", library->path.c_str(), dlerror());
+        return nullptr;
+      }
+      auto entry = reinterpret_cast<GuitarDPackEntry>(dlsym(handle, GUITARD_PACK_ENTRY_NAME));
+#endif
+      library->handle = handle;
+      const GuitarDPack* pack = entry != nullptr ? entry() : nullptr;
+      if (pack == nullptr) {
+        WDBGMSG("%s isn't a node pack\n", library->path.c_str());
+        return nullptr;
+      }
+      if (pack->abiVersion != GUITARD_PACK_ABI_VERSION) {
+        WDBGMSG("Node pack %s was built for another version\n", library->path.c_str());
+        return nullptr;
+      }
+      if (pack->sampleSize != sizeof(sample)) {
+        WDBGMSG("Node pack %s was built for another sample type\n", library->path.c_str());
+        return nullptr;
+      }
+      library->failed = false;
+      library->pack = pack;
+      return pack;
+    }
+
+    inline const GuitarDPackNode* findNode(const GuitarDPack* pack, const String& name) {
+      for (int i = 0; i < pack->nodeCount; i++) {
+        if (name == pack->nodes[i].name) {
+          return &pack->nodes[i];
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Hides the nodes of a library which can't be used from the node browser
+     */
+    inline void hideNodes(Library* library) {
+      for (auto& name : library->nodes) {
+        NodeList::NodeInfo* info = NodeList::getInfo(name);
+        if (info != nullptr) {
+          info->hidden = true;
+        }
+      }
+    }
+
+    /**
+     * Adds a node to the NodeList which will load the library once it's constructed
+     */
+    inline void registerPackNode(Library* library, const NodeList::NodeInfo& info) {
+      NodeList::NodeInfo packInfo = info;
+      packInfo.constructor = [library](NodeList::NodeInfo* nodeInfo) -> Node* {
+        const GuitarDPack* pack = load(library);
+        if (pack == nullptr) {
+          hideNodes(library);
+          return nullptr;
+        }
+        const GuitarDPackNode* packNode = findNode(pack, nodeInfo->name);
+        if (packNode == nullptr) {
+          WDBGMSG("Node pack %s doesn't contain %s\n", library->path.c_str(), nodeInfo->name.c_str());
+          nodeInfo->hidden = true;
+          return nullptr;
+        }
+        PackNode* node = new PackNode(packNode);
+        node->setNodeInfo(nodeInfo);
+        return node;
+      };
+      library->nodes.push_back(info.name);
+      NodeList::registerNode(packInfo);
+    }
+
+    /**
+     * Registers the nodes listed in the json next to the library
+     * Returns false if there's no usable json
+     */
+    inline bool registerFromManifest(Library* library, const String& manifestPath) {
+      std::ifstream file(manifestPath);
+      if (!file.is_open()) { return false; }
+      try {
+        nlohmann::json manifest = nlohmann::json::parse(file);
+        if (manifest.at("abi").get<int>() != GUITARD_PACK_ABI_VERSION) { return false; }
+        if (manifest.value("double", false) != (sizeof(sample) == sizeof(double))) {
+          // Nothing in it could be created, so it's left out of the node browser entirely
+          WDBGMSG("Node pack %s was built for another sample type\n", library->path.c_str());
+          library->failed = true;
+          return true;
+        }
+        for (auto& node : manifest.at("nodes")) {
+          NodeList::NodeInfo info;
+          info.name = node.at("name").get<String>();
+          info.displayName = node.value("displayName", info.name);
+          info.categoryName = node.value("category", String("Packs"));
+          info.description = node.value("description", String());
+          registerPackNode(library, info);
+        }
+        return true;
+      }
+      catch (...) {
+        WDBGMSG("Invalid node pack manifest %s\n", manifestPath.c_str());
+        return false;
+      }
+    }
+
+    /**
+     * Looks for packs in the folder and registers all their nodes
+     * Call this on startup after soundwoofer::setup::setHomeDirectory()
+     * @param folder Defaults to the packs folder in the soundwoofer home directory
+     * @return The number of packs found
+     */
+    inline int discover(String folder = "") {
+      if (folder.empty()) { folder = soundwoofer::state::packDirectory; }
+      if (folder.empty()) { return 0; }
+      if (folder.back() != soundwoofer::file::PATH_DELIMITER.back()) { folder += soundwoofer::file::PATH_DELIMITER; }
+      int found = 0;
+      for (auto& file : soundwoofer::file::scanDir(folder)) {
+        const String& name = file.name;
+        if (file.isFolder || name.size() <= LIBRARY_EXTENSION.size()) { continue; }
+        const size_t stem = name.size() - LIBRARY_EXTENSION.size();
+        if (name.compare(stem, LIBRARY_EXTENSION.size(), LIBRARY_EXTENSION) != 0) { continue; }
+        bool known = false;
+        for (auto library : libraries) {
+          known = known || library->path == file.absolute;
+        }
+        if (known) { continue; }
+
+        Library* library = new Library();
+        library->path = file.absolute;
+        libraries.push_back(library);
+        found++;
+        const String manifest = file.absolute.substr(0, file.absolute.size() - LIBRARY_EXTENSION.size()) + ".json";
+        if (registerFromManifest(library, manifest)) { continue; }
+
+        // Without a manifest the library has to be loaded right away to know what's inside
+        const GuitarDPack* pack = load(library);
+        if (pack == nullptr) { continue; }
+        for (int i = 0; i < pack->nodeCount; i++) {
+          const GuitarDPackNode& node = pack->nodes[i];
+          NodeList::NodeInfo info;
+          info.name = node.name;
+          info.displayName = node.displayName != nullptr ? node.displayName : node.name;
+          info.categoryName = node.category != nullptr ? node.category : "Packs";
+          info.description = node.description != nullptr ? node.description : "";
+          registerPackNode(library, info);
+        }
+      }
+      return found;
+    }
+  }
+}
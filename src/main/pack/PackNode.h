@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../Node.h"
+#include "./GuitarDPack.h"
+
+namespace guitard {
+  /**
+   * Wraps a node type from a node pack, see GuitarDPack.h
+   * Parameters, sockets and serialization are mapped onto the C interface
+   */
+  class PackNode final : public Node {
+    const GuitarDPackNode* mPack = nullptr;
+    void* mInstance = nullptr;
+    int mPackParameters = 0;
+    int mParameterIndex[GUITARD_MAX_NODE_PARAMETERS] = { 0 }; // Index in mParameters for each pack parameter
+    sample mValues[GUITARD_MAX_NODE_PARAMETERS] = { 0 };
+    sample** mIn[GUITARD_MAX_NODE_SOCKETS] = { nullptr };
+    sample** mOut[GUITARD_MAX_NODE_SOCKETS] = { nullptr };
+
+  public:
+    explicit PackNode(const GuitarDPackNode* pack) : mPack(pack) { }
+
+    ~PackNode() {
+      if (mInstance != nullptr) {
+        mPack->destroy(mInstance);
+      }
+    }
+
+    void setup(int pSamplerate, int pMaxBuffer, int, int, int) override {
+      const int inputs = std::min(mPack->inputs, GUITARD_MAX_NODE_SOCKETS);
+      const int outputs = std::min(mPack->outputs, GUITARD_MAX_NODE_SOCKETS);
+      Node::setup(pSamplerate, pMaxBuffer, inputs, outputs, 2);
+      mInstance = mPack->create(pSamplerate, pMaxBuffer, mChannelCount);
+      addByPassParam();
+      // One slot is taken by bypass
+      mPackParameters = std::min(mPack->parameterCount, GUITARD_MAX_NODE_PARAMETERS - 1);
+      for (int i = 0; i < mPackParameters; i++) {
+        const GuitarDPackParameter& p = mPack->parameters[i];
+        mParameterIndex[i] = addParameter(
+          p.name, &mValues[i], sample(p.defaultValue), sample(p.min), sample(p.max), sample(p.stepSize)
+        );
+        if (mInstance != nullptr) {
+          mPack->setParameter(mInstance, i, mValues[i]);
+        }
+      }
+    }
+
+    void OnSamplerateChanged(const int pSampleRate) override {
+      Node::OnSamplerateChanged(pSampleRate);
+      if (mInstance != nullptr && mPack->setSampleRate != nullptr) {
+        mPack->setSampleRate(mInstance, mSampleRate);
+      }
+    }
+
+    void OnChannelsChanged(const int pChannels) override {
+      Node::OnChannelsChanged(pChannels);
+      if (mInstance != nullptr && mPack->setChannels != nullptr) {
+        mPack->setChannels(mInstance, pChannels);
+      }
+    }
+
+    void OnTransport() override {
+      if (mInstance != nullptr && mPack->reset != nullptr) {
+        mPack->reset(mInstance);
+      }
+    }
+
+    double getLatency() const override {
+      if (mInstance != nullptr && mPack->getLatency != nullptr) {
+        return mPack->getLatency(mInstance);
+      }
+      return 0;
+    }
+
+    void ProcessBlock(const int nFrames) override {
+      if (byPass()) { return; }
+      if (mInstance == nullptr) {
+        outputSilence();
+        return;
+      }
+      for (int i = 0; i < mPackParameters; i++) {
+        if (mParameters[mParameterIndex[i]].update()) {
+          mPack->setParameter(mInstance, i, mValues[i]);
+        }
+      }
+      for (int i = 0; i < mInputCount; i++) {
+        mIn[i] = mSocketsIn[i].mBuffer;
+      }
+      for (int i = 0; i < mOutputCount; i++) {
+        mOut[i] = mSocketsOut[i].mBuffer;
+      }
+      // The loader made sure the sample types match
+      mPack->process(
+        mInstance, reinterpret_cast<GuitarDPackSample***>(mIn),
+        reinterpret_cast<GuitarDPackSample***>(mOut), mChannelCount, nFrames
+      );
+    }
+
+    void serializeAdditional(nlohmann::json& serialized) override {
+      if (mInstance != nullptr && mPack->serialize != nullptr) {
+        const char* state = mPack->serialize(mInstance);
+        if (state != nullptr) {
+          serialized["packState"] = state;
+        }
+      }
+    }
+
+    void deserializeAdditional(nlohmann::json& serialized) override {
+      if (mInstance == nullptr || mPack->deserialize == nullptr) { return; }
+      try {
+        if (!serialized.contains("packState")) { return; }
+        const std::string state = serialized.at("packState");
+        mPack->deserialize(mInstance, state.c_str());
+      }
+      catch (...) {
+        WDBGMSG("Failed to load the state of a pack node\n");
+      }
+    }
+  };
+}
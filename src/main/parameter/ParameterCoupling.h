@@ -14,6 +14,8 @@ namespace guitard {
     sample mAdd = 0;
     sample mMul = 0;
     sample* value = nullptr; // pointer to the value used in the dsp code
+    unsigned int mVersion = 1; // Bumped on every change made through this object
+    mutable unsigned int mPushedVersion = 0; // Version last written to the dsp value
     sample baseValue = 0; // This value is only used for params which couldn't claim a DAW parameter to act as the one provided by the IParam
 #ifndef GUITARD_HEADLESS
     IParam*
@@ -118,16 +120,47 @@ namespace guitard {
 
     /**
      * This should only be called from the audio thread since the value might tear on 32bit
+     * Returns true if the dsp value changed, so nodes can skip recomputing things derived from it
      */
-    void update() const {
+    bool update() const {
+      if (mPushedVersion == mVersion && parameter == nullptr && automationDependency == nullptr) {
+        return false; // Nothing touched it since the last time and there's no DAW which might have
+      }
+      mPushedVersion = mVersion;
+      sample v;
       if (automationDependency == nullptr) {
         // No automation will just use the plain value
-        *value = getValue();
+        v = getValue();
       }
       else {
         // Will add the automation and clip the value
-        *value = ::std::min(::std::max(getValue() + automation, min), max);
+        v = ::std::min(::std::max(getValue() + automation, min), max);
       }
+      if (*value == v) { return false; }
+      *value = v;
+      return true;
+    }
+
+    /**
+     * The value the dsp code saw on the last update(), automation included
+     */
+    sample getDspValue() const {
+      return *value;
+    }
+
+    /**
+     * Changes whenever the value is set through this object, DAW automation isn't counted
+     */
+    unsigned int getVersion() const {
+      return mVersion;
+    }
+
+    /**
+     * Used by the automation nodes, the value gets added in update()
+     */
+    void setAutomation(const sample v) {
+      automation = v;
+      mVersion++;
     }
 
     /**
@@ -152,6 +185,7 @@ namespace guitard {
       {
         baseValue = v;
       }
+      mVersion++;
     }
 
 #ifndef GUITARD_HEADLESS
@@ -225,6 +259,7 @@ namespace guitard {
       else {
         baseValue = normalizedToScaled(v);
       }
+      mVersion++;
     }
 
     /**
@@ -28,6 +28,8 @@
 #include "./fuzz/FuzzNode.h"
 #include "./overdrive/OverDriveNode.h"
 #include "./powersag/PowerSagNode.h"
+#include "./adaa_drive/AdaaDriveNode.h"
+#include "./adaa_fuzz/AdaaFuzzNode.h"
 
 
 /**
@@ -60,9 +62,20 @@
  */
 #include "./simple_cab/SimpleCabNode.h"
 #include "./cab_lib/CabLibNode.h"
+#include "./multi_cab/MultiCabNode.h"
 
 /**
  * Automation
  */
 #include "./envelope/EnvelopeNode.h"
 #include "./lfo/LfoNode.h"
+
+/**
+ * Nodes from the shared libraries in the packs folder, see NodePacks::discover()
+ */
+#include "../main/pack/NodePacks.h"
+
+/**
+ * Faust chains the graph runs as a single dsp, see scripts/compile_faust.py
+ */
+#include "../main/faust/generated/FusedChains.h"
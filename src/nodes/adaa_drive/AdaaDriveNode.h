@@ -0,0 +1,122 @@
+#pragma once
+#include "../../main/Node.h"
+#include "../../types/GWaveshaper.h"
+
+namespace guitard {
+  /**
+   * Drive with antiderivative anti-aliasing instead of oversampling
+   * Tanh, hard clip or an asymmetric clip which leaves even harmonics
+   */
+  class AdaaDriveNode final : public Node {
+    static const int MaxChannels = 2;
+
+    AdaaWaveshaper<shapes::Tanh> mTanh[MaxChannels];
+    AdaaWaveshaper<shapes::Clip> mHard[MaxChannels];
+    AdaaWaveshaper<shapes::Clip> mAsym[MaxChannels];
+
+    sample mDrive = 0.3;
+    sample mShape = 0;
+    sample mBias = 0;
+    sample mOrder = 1;
+    sample mPostGain = 0;
+
+    int mLastShape = 0;
+    double mGain = 1;
+    double mLastGain = 1; // Pregain of the last block so the drive gets ramped
+    double mPost = 1;
+    double mDcIn[MaxChannels] = { 0 };
+    double mDcOut[MaxChannels] = { 0 };
+    double mDcR = 0.995;
+
+  public:
+    AdaaDriveNode() {
+      for (int c = 0; c < MaxChannels; c++) {
+        mAsym[c].shape().low = 0.5;
+        mAsym[c].shape().high = 1;
+        mAsym[c].refresh();
+      }
+    }
+
+    void setup(int pSamplerate, int pMaxBuffer, int, int, int) override {
+      Node::setup(pSamplerate, pMaxBuffer, 1, 1, 2);
+      addByPassParam();
+      addParameter("Drive", &mDrive, 0.3, 0, 1, 0.01, { -50, -30 });
+      addParameter("Shape", &mShape, 0, 0, 2, 1, { 50, -30 });
+      addParameter("Bias", &mBias, 0, -0.5, 0.5, 0.01, { -50, 30 });
+      addParameter("ADAA Order", &mOrder, 1, 0, 2, 1, { 0, 30 });
+      addParameter("Post gain", &mPostGain, 0, -40, 12, 0.1, { 50, 30 });
+      updateGains();
+      mLastGain = mGain;
+    }
+
+    void OnSamplerateChanged(const int pSampleRate) override {
+      Node::OnSamplerateChanged(pSampleRate);
+      mDcR = 1 - 2 * shapes::Pi * 10 / mSampleRate;
+    }
+
+    void OnTransport() override {
+      for (int c = 0; c < MaxChannels; c++) {
+        mTanh[c].reset();
+        mHard[c].reset();
+        mAsym[c].reset();
+        mDcIn[c] = mDcOut[c] = 0;
+      }
+    }
+
+    double getLatency() const override {
+      return 0.5 * static_cast<int>(mOrder);
+    }
+
+    void ProcessBlock(int nFrames) override {
+      if (byPass()) { return; }
+      if (updateParameters()) { updateGains(); }
+      const int shape = static_cast<int>(mShape);
+      const int order = static_cast<int>(mOrder);
+      const double gain = mGain;
+      const int channels = std::min(mChannelCount, int(MaxChannels));
+      for (int c = 0; c < channels; c++) {
+        sample* in = mSocketsIn[0].mBuffer[c];
+        sample* out = mSocketsOut[0].mBuffer[c];
+        // Gain ramp and bias go to the output buffer first, the shapers work in place
+        const double step = (gain - mLastGain) / nFrames;
+        double g = mLastGain;
+        for (int i = 0; i < nFrames; i++, g += step) {
+          out[i] = static_cast<sample>(in[i] * g + mBias);
+        }
+        if (shape == 1) {
+          if (mLastShape != 1) { mHard[c].reset(); }
+          mHard[c].setOrder(order);
+          mHard[c].process(out, out, nFrames);
+        }
+        else if (shape == 2) {
+          if (mLastShape != 2) { mAsym[c].reset(); }
+          mAsym[c].setOrder(order);
+          mAsym[c].process(out, out, nFrames);
+        }
+        else {
+          if (mLastShape != 0) { mTanh[c].reset(); }
+          mTanh[c].setOrder(order);
+          mTanh[c].process(out, out, nFrames);
+        }
+        for (int i = 0; i < nFrames; i++) {
+          const double x = out[i];
+          mDcOut[c] = x - mDcIn[c] + mDcR * mDcOut[c];
+          mDcIn[c] = x;
+          out[i] = static_cast<sample>(mDcOut[c] * mPost);
+        }
+      }
+      mLastShape = shape;
+      mLastGain = gain;
+    }
+
+  private:
+    void updateGains() {
+      mGain = std::pow(10, 2 * mDrive);
+      mPost = std::pow(10, mPostGain / 20.0);
+    }
+  };
+
+  GUITARD_REGISTER_NODE(AdaaDriveNode,
+    "ADAA Drive", "Distortion", "Tanh, hard or asymmetric clipping, anti-aliased without oversampling"
+  )
+}
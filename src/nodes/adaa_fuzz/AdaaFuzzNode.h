@@ -0,0 +1,102 @@
+#pragma once
+#include "../../main/Node.h"
+#include "../../types/GWaveshaper.h"
+
+namespace guitard {
+  /**
+   * Rectifier for the octave up into an asymmetric clipper, both anti-aliased without oversampling
+   */
+  class AdaaFuzzNode final : public Node {
+    static const int MaxChannels = 2;
+
+    AdaaWaveshaper<shapes::Rectify> mRectify[MaxChannels];
+    AdaaWaveshaper<shapes::Clip> mClip[MaxChannels];
+
+    sample mDrive = 0.5;
+    sample mOctave = 0;
+    sample mBias = 0.2;
+    sample mOrder = 1;
+    sample mLevel = -6;
+
+    double mGain = 1;
+    double mLastGain = 1;
+    double mLevelGain = 1;
+    double mDcIn[MaxChannels] = { 0 };
+    double mDcOut[MaxChannels] = { 0 };
+    double mDcR = 0.995;
+
+  public:
+    void setup(int pSamplerate, int pMaxBuffer, int, int, int) override {
+      Node::setup(pSamplerate, pMaxBuffer, 1, 1, 2);
+      addByPassParam();
+      addParameter("Drive", &mDrive, 0.5, 0, 1, 0.01, { -50, -30 });
+      addParameter("Octave", &mOctave, 0, 0, 1, 0.01, { 50, -30 });
+      addParameter("Bias", &mBias, 0.2, 0, 0.9, 0.01, { -50, 30 });
+      addParameter("ADAA Order", &mOrder, 1, 0, 2, 1, { 0, 30 });
+      addParameter("Level", &mLevel, -6, -40, 12, 0.1, { 50, 30 });
+      updateGains();
+      mLastGain = mGain;
+    }
+
+    void OnSamplerateChanged(const int pSampleRate) override {
+      Node::OnSamplerateChanged(pSampleRate);
+      mDcR = 1 - 2 * shapes::Pi * 10 / mSampleRate;
+    }
+
+    void OnTransport() override {
+      for (int c = 0; c < MaxChannels; c++) {
+        mRectify[c].reset();
+        mClip[c].reset();
+        mDcIn[c] = mDcOut[c] = 0;
+      }
+    }
+
+    double getLatency() const override {
+      return static_cast<int>(mOrder); // Two stages with half a sample each per order
+    }
+
+    void ProcessBlock(int nFrames) override {
+      if (byPass()) { return; }
+      if (updateParameters()) { updateGains(); }
+      const int order = static_cast<int>(mOrder);
+      const double gain = mGain;
+      const double down = 1 - 2 * mOctave;
+      const double low = 1 - mBias;
+      const int channels = std::min(mChannelCount, int(MaxChannels));
+      for (int c = 0; c < channels; c++) {
+        sample* out = mSocketsOut[0].mBuffer[c];
+        AdaaWaveshaper<shapes::Rectify>& rectify = mRectify[c];
+        AdaaWaveshaper<shapes::Clip>& clip = mClip[c];
+        if (rectify.shape().down != down) {
+          rectify.shape().down = down;
+          rectify.refresh();
+        }
+        if (clip.shape().low != low) {
+          clip.shape().low = low;
+          clip.refresh();
+        }
+        rectify.setOrder(order);
+        clip.setOrder(order);
+        rectify.process(mSocketsIn[0].mBuffer[c], out, nFrames);
+        clip.process(out, out, nFrames, mLastGain, gain);
+        for (int i = 0; i < nFrames; i++) {
+          const double x = out[i];
+          mDcOut[c] = x - mDcIn[c] + mDcR * mDcOut[c];
+          mDcIn[c] = x;
+          out[i] = static_cast<sample>(mDcOut[c] * mLevelGain);
+        }
+      }
+      mLastGain = gain;
+    }
+
+  private:
+    void updateGains() {
+      mGain = std::pow(10, 2 * mDrive);
+      mLevelGain = std::pow(10, mLevel / 20.0);
+    }
+  };
+
+  GUITARD_REGISTER_NODE(AdaaFuzzNode,
+    "ADAA Fuzz", "Distortion", "Octave fuzz, anti-aliased without oversampling"
+  )
+}
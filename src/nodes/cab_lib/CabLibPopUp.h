@@ -6,6 +6,7 @@
 #include "../../ui/elements/scroll/ScrollViewControl.h"
 #include "../../ui/GUIConfig.h"
 #include <functional>
+#include <unordered_map>
 
 namespace guitard {
 
@@ -86,6 +87,7 @@ namespace guitard {
     RigCallback mCallback;
     soundwoofer::SWRigShared mRig;
     bool mSelected = false;
+    bool mBuilt = false; // Mics and IRs are only created once the rig gets selected
     String mName;
     PointerList<LibMic> mMics;
     PointerList<LibIr> mIrs;
@@ -133,9 +135,38 @@ namespace guitard {
     LibRig* mSelectedRig = nullptr;
     LibMic* mSelectedMic = nullptr;
     LibIr* mSelectedIr = nullptr;
+    std::unordered_map<std::string, LibMic*> mMicsById; // Mics are shared across rigs
     String mPath;
     bool mLoading = false;
 
+    /**
+     * Creates the mic and IR controls of a rig the first time it's needed
+     * so big libraries don't need a control for every IR up front
+     */
+    void buildRig(LibRig* rig) {
+      if (rig->mBuilt) { return; }
+      rig->mBuilt = true;
+      for (auto& j : rig->mRig->microphones) { // Build the mics
+        if (j->type != "Microphone") { continue; } // Only Mics
+        LibMic*& mic = mMicsById[j->id];
+        if (mic == nullptr) { // No dupes
+          mic = new LibMic(j, [&](LibMic* callbackMic) {
+            changeMic(callbackMic);
+          });
+          mMics.add(mic);
+        }
+        rig->mMics.add(mic);
+      }
+
+      for (auto& j : rig->mRig->impulses) {
+        LibIr* ir = new LibIr(j, [&](LibIr* callbackIr) {
+          changeIr(callbackIr);
+        });
+        mIrs.add(ir);
+        rig->mIrs.add(ir);
+      }
+    }
+
     void changeIr(LibIr* newIr) {
       LibIr* prevIr = mSelectedIr;
       mSelectedIr = nullptr;
@@ -231,6 +262,7 @@ namespace guitard {
       mSelectedRig = newRig;
       mScrollView[0]->SetDirty();
       if (mSelectedRig == nullptr) { return; }
+      buildRig(mSelectedRig);
       for (int i = 0; i < newRig->mMics.size(); i++) {
         // Add the new ones
         mScrollView[1]->appendChild(mSelectedRig->mMics[i]);
@@ -239,61 +271,37 @@ namespace guitard {
       changeMic(nullptr);
     }
 
+    /** The listing finishes on a worker, the callback builds controls so it's called on the UI thread */
+    soundwoofer::async::CallbackQueueShared mCallbackQueue = std::make_shared<soundwoofer::async::CallbackQueue>();
+
     soundwoofer::async::Callback mCallback = std::make_shared<soundwoofer::async::CallbackFunc>(
       [&](soundwoofer::Status status) {
         // if (status != soundwoofer::SUCCESS) { return; }
         auto rigs = soundwoofer::ir::getRig();
+        LibRig* loadedRig = nullptr;
+        soundwoofer::SWImpulseShared loadedIr = soundwoofer::ir::findIR(mNode->mLoadedIr->file);
         for (auto& i : rigs) { // Build the rigs
           LibRig* rig = new LibRig(i, [&](LibRig* callbackRig) {
             changeRig(callbackRig);
           });
           mScrollView[0]->appendChild(rig);
           mRigs.add(rig);
-
-          for (auto& j : i->microphones) { // Build the mics
-            if (j->type != "Microphone") { continue; } // Only Mics
-            LibMic* duplicate = nullptr;
-            for (int k = 0; k < mMics.size(); k++) {
-              if (mMics[k]->mMic->id == j->id) {
-                duplicate = mMics[k];
-                break;
-              }
-            }
-
-            if (duplicate != nullptr) {
-              rig->mMics.add(duplicate);
-              continue;
-            } // No dupes
-            LibMic* mic = new LibMic(j, [&](LibMic* callbackMic) {
-              changeMic(callbackMic);
-            });
-            mMics.add(mic);
-            rig->mMics.add(mic);
-          }
-
-          for (auto& j : i->impulses) {
-            LibIr* ir = new LibIr(j, [&](LibIr* callbackIr) {
-              changeIr(callbackIr);
-            });
-            mIrs.add(ir);
-            rig->mIrs.add(ir);
+          if (loadedIr != nullptr && loadedIr->rig == i->id) {
+            loadedRig = rig;
           }
         }
 
-        for (int r = 0; r < mRigs.size(); r++) {
-          LibRig* rig = mRigs[r];
-          for (int i = 0; i < rig->mIrs.size(); i++) {
-            LibIr* ir = rig->mIrs[i];
-            if (ir->mIr->file == mNode->mLoadedIr->file) { // Found the ir
-              for (int m = 0; m < rig->mMics.size(); m++) {
-                LibMic* mic = rig->mMics[m];
-                if (ir->mIr->micId == mic->mMic->id) { // Found the mic
-                  changeRig(rig);
-                  changeMic(mic);
-                  changeIr(ir);
-                }
-              }
-            }
+        if (loadedRig != nullptr) { // Select the ir which is loaded right now
+          buildRig(loadedRig);
+          for (int i = 0; i < loadedRig->mIrs.size(); i++) {
+            LibIr* ir = loadedRig->mIrs[i];
+            if (ir->mIr->file != loadedIr->file) { continue; }
+            auto found = mMicsById.find(ir->mIr->micId);
+            if (found == mMicsById.end()) { continue; }
+            changeRig(loadedRig);
+            changeMic(found->second);
+            changeIr(ir);
+            break;
           }
         }
         mPath = soundwoofer::state::irDirectory;
@@ -317,7 +325,14 @@ namespace guitard {
         GetUI()->AttachControl(mScrollView[i]);
       }
       mPath = "Loading...";
-      soundwoofer::async::ir::list(mCallback);
+      soundwoofer::async::ir::list(mCallback, soundwoofer::async::Options(
+        soundwoofer::async::PRIORITY_LOW, nullptr, mCallbackQueue
+      ));
+    }
+
+    bool IsDirty() override {
+      mCallbackQueue->dispatch(); // Called on every frame
+      return IControl::IsDirty();
     }
 
     void OnDetached() override {
@@ -327,6 +342,7 @@ namespace guitard {
       mRigs.clear(true);
       mMics.clear(true);
       mIrs.clear(true);
+      mMicsById.clear();
     }
 
     void OnResize() override {
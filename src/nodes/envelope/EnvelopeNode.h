@@ -61,7 +61,7 @@ namespace guitard {
         mAutomationTargets.remove(i);
         mAutomationTargetCount--;
         c->automationDependency = nullptr;
-        c->automation = 0;
+        c->setAutomation(0);
       }
     }
 
@@ -82,7 +82,7 @@ namespace guitard {
         ParameterCoupling* c = mAutomationTargets.get(i);
         // scale them according to each of the max vals
         // TODOG take into account the scaling type e.g. frequency
-        c->automation = current * c->max;
+        c->setAutomation(current * c->max);
       }
     }
   };
@@ -60,7 +60,7 @@ namespace guitard {
         mAutomationTargets.remove(i);
         mAutomationTargetCount--;
         c->automationDependency = nullptr;
-        c->automation = 0;
+        c->setAutomation(0);
       }
     }
 
@@ -69,7 +69,7 @@ namespace guitard {
       if (mByPassed > 0.5) {
         for (int i = 0; i < mAutomationTargetCount; i++) {
           ParameterCoupling* c = mAutomationTargets.get(i);
-          c->automation = 0.0;
+          c->setAutomation(0.0);
         }
         return;
       }
@@ -85,7 +85,7 @@ namespace guitard {
         ParameterCoupling* c = mAutomationTargets.get(i);
         // scale them according to each of the max vals
         // TODOG take into account the scaling type e.g. frequency
-        c->automation = mLfoVal * c->max;
+        c->setAutomation(mLfoVal * c->max);
       }
     }
   };
@@ -0,0 +1,536 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "../../main/Node.h"
+#include "../../../thirdparty/soundwoofer/soundwoofer.h"
+
+#ifndef GUITARD_HEADLESS
+  #include "filebrowse.h"
+#endif
+
+#include "../../types/GConvolver.h"
+#include "../../content/ir/InternalIRs.h"
+#include "../../types/GFile.h"
+
+#ifdef DrawText
+#undef DrawText
+#endif
+
+namespace guitard {
+  /**
+   * A single thread which redoes the mixes of all multi cab nodes
+   * The audio thread only flags a node as dirty since waking the thread from there could mean a syscall,
+   * so the worker looks for flagged nodes every few milliseconds. The ui wakes it right away.
+   * The thread only runs while there are nodes.
+   */
+  class MultiCabWorker {
+    /** Longest time a settings change on the audio thread waits for its mix */
+    static const int POLL_MS = 20;
+
+    struct Job {
+      const void* owner;
+      std::atomic<bool>* dirty;
+      std::function<void()> run;
+    };
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    /** Signaled when a job is done, so remove() can wait for it */
+    std::condition_variable mDone;
+    std::vector<Job> mJobs;
+    const void* mRunning = nullptr;
+    std::thread mThread;
+    /** Bumped to tell the current thread to leave, a new one might already be running by then */
+    unsigned int mGeneration = 0;
+
+  public:
+    static MultiCabWorker& instance() {
+      static MultiCabWorker worker;
+      return worker;
+    }
+
+    ~MultiCabWorker() {
+      stop(std::unique_lock<std::mutex>(mMutex));
+    }
+
+    /**
+     * Runs the function whenever the flag gets set, never call it from the audio thread
+     */
+    void add(const void* owner, std::atomic<bool>* dirty, std::function<void()> run) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mJobs.push_back({ owner, dirty, std::move(run) });
+      if (!mThread.joinable()) {
+        const unsigned int generation = mGeneration;
+        mThread = std::thread([this, generation]() { work(generation); });
+      }
+    }
+
+    /**
+     * Waits if the job of the owner is running right now, never call it from the audio thread
+     */
+    void remove(const void* owner) {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mDone.wait(lock, [&]() { return mRunning != owner; });
+      for (size_t i = 0; i < mJobs.size(); i++) {
+        if (mJobs[i].owner == owner) {
+          mJobs.erase(mJobs.begin() + i);
+          break;
+        }
+      }
+      if (mJobs.empty()) {
+        stop(std::move(lock));
+      }
+    }
+
+    /**
+     * Never call it from the audio thread
+     */
+    void wake() {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mWake.notify_one();
+    }
+
+  private:
+    /**
+     * Tells the thread to leave and joins it after releasing the lock
+     */
+    void stop(std::unique_lock<std::mutex> lock) {
+      mGeneration++;
+      std::thread thread = std::move(mThread);
+      lock.unlock();
+      mWake.notify_all();
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+
+    void work(const unsigned int generation) {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (generation == mGeneration) {
+        // Jobs might get removed while one is running, so the index is checked each time
+        for (size_t i = 0; i < mJobs.size() && generation == mGeneration; i++) {
+          if (!mJobs[i].dirty->exchange(false)) { continue; }
+          const Job job = mJobs[i];
+          mRunning = job.owner;
+          lock.unlock();
+          job.run();
+          lock.lock();
+          mRunning = nullptr;
+          mDone.notify_all();
+        }
+        mWake.wait_for(lock, std::chrono::milliseconds(int(POLL_MS)));
+      }
+    }
+  };
+
+  /**
+   * Blends multiple mic IRs with their own gain, pan and delay
+   * Since convolution is linear, the weighted IRs are summed up before they
+   * go to the convolver, so the blend costs as much as a single cabinet.
+   * The mix is redone on the MultiCabWorker whenever one of the settings changes
+   * and the convolver fades over to it.
+   */
+  class MultiCabNode final : public Node {
+  public:
+    static const int SLOT_COUNT = 4;
+  private:
+    /** Time in seconds to fade over to a new mix */
+    const sample mTransitionTime = 0.03;
+    sample mGain[SLOT_COUNT] = { 0 };
+    sample mPan[SLOT_COUNT] = { 0 };
+    sample mDelay[SLOT_COUNT] = { 0 };
+
+    /** The settings the worker will use for the next mix, written by the audio thread */
+    std::atomic<sample> mMixGain[SLOT_COUNT];
+    std::atomic<sample> mMixPan[SLOT_COUNT];
+    std::atomic<sample> mMixDelay[SLOT_COUNT];
+    /** Odd while the audio thread writes the settings above, so the worker can tell its copy is torn */
+    std::atomic<unsigned int> mMixVersion = { 0 };
+    /** Set when the mix needs to be redone, the worker clears it */
+    std::atomic<bool> mDirty = { false };
+
+    /**
+     * Private copies of slot IRs which were loaded at another samplerate, only touched by the worker
+     * The IRs in the slots may be shared with the IR list or other nodes, so they're never reloaded in place
+     */
+    soundwoofer::SWImpulseShared mResampled[SLOT_COUNT];
+    soundwoofer::SWImpulseShared mResampledFrom[SLOT_COUNT];
+    /** Guards the slots between the ui and the worker */
+    std::mutex mSlotMutex;
+    soundwoofer::SWImpulseShared mSlots[SLOT_COUNT];
+    WrappedConvolver* mConvolver = nullptr;
+
+  public:
+    MultiCabNode() {
+      mDimensions.x = 400;
+      mDimensions.y = 360;
+      mStereo = 0;
+      addByPassParam();
+      // Added row by row so the automatic layout puts the controls of a slot in a column
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        addParameter(GainNames[i], &mGain[i], 0, -60, 12, 0.1);
+      }
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        addParameter(PanNames[i], &mPan[i], 0, -1, 1, 0.01);
+      }
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        addParameter(ParameterCoupling(DelayNames[i], &mDelay[i], 0, 0, 10, 0.01, ParameterCoupling::Milliseconds));
+      }
+      addStereoParam();
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        mMixGain[i] = mMixPan[i] = mMixDelay[i] = 0;
+      }
+      mSlots[0] = InternalIRs[0];
+    }
+
+    ~MultiCabNode() {
+      MultiCabWorker::instance().remove(this);
+    }
+
+    /**
+     * Called from the UI, nullptr will clear the slot
+     */
+    void loadIr(const int slot, soundwoofer::SWImpulseShared ir) {
+      if (slot < 0 || slot >= SLOT_COUNT) { return; }
+      {
+        std::lock_guard<std::mutex> lock(mSlotMutex);
+        mSlots[slot] = ir;
+      }
+      mDirty = true;
+      MultiCabWorker::instance().wake();
+    }
+
+    soundwoofer::SWImpulseShared getIr(const int slot) {
+      std::lock_guard<std::mutex> lock(mSlotMutex);
+      return mSlots[slot];
+    }
+
+    void serializeAdditional(nlohmann::json& serialized) override {
+      std::lock_guard<std::mutex> lock(mSlotMutex);
+      serialized["slots"] = nlohmann::json::array();
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        nlohmann::json slot;
+        if (mSlots[i] != nullptr) {
+          slot["name"] = mSlots[i]->name;
+          slot["path"] = mSlots[i]->file;
+          slot["id"] = mSlots[i]->id;
+          slot["embedded"] = mSlots[i]->source == soundwoofer::EMBEDDED_SRC;
+        }
+        serialized["slots"].push_back(slot);
+      }
+    }
+
+    void deserializeAdditional(nlohmann::json& serialized) override {
+      try {
+        if (!serialized.contains("slots")) { return; }
+        nlohmann::json& slots = serialized.at("slots");
+        for (size_t i = 0; i < SLOT_COUNT && i < slots.size(); i++) {
+          nlohmann::json& slot = slots[i];
+          soundwoofer::SWImpulseShared ir = nullptr;
+          if (slot.contains("name")) {
+            if (slot.at("embedded").get<bool>()) {
+              for (int j = 0; j < InternalIRsCount; j++) {
+                if (InternalIRs[j]->name == slot.at("name").get<std::string>()) {
+                  ir = InternalIRs[j];
+                }
+              }
+            }
+            else { // The worker will figure out where the file is
+              ir = std::make_shared<soundwoofer::SWImpulse>();
+              ir->name = slot.at("name").get<std::string>();
+              ir->file = slot.at("path").get<std::string>();
+              ir->id = slot.at("id").get<std::string>();
+              ir->source = soundwoofer::USER_SRC_ABSOLUTE;
+            }
+          }
+          loadIr(i, ir);
+        }
+      }
+      catch (...) {
+        WDBGMSG("Failed to load Multi Cab node data!\n");
+      }
+    }
+
+    void createBuffers() override {
+      Node::createBuffers();
+      mConvolver = new WrappedConvolver(mMaxBlockSize);
+      mConvolver->mStereoIRs = true; // A stereo mix has to be heard in stereo
+      mix(); // Do the first mix right away so there's no silence
+      MultiCabWorker::instance().add(this, &mDirty, [this]() { mix(); });
+    }
+
+    void deleteBuffers() override {
+      Node::deleteBuffers();
+      MultiCabWorker::instance().remove(this);
+      delete mConvolver;
+      mConvolver = nullptr;
+    }
+
+    /**
+     * Take care of samplerate and channel changes directly since both will need the convolver to be reconstructed
+     * This prevents that from happening twice
+     */
+    void OnReset(const int pSampleRate, const int pChannels, const bool force = false) override {
+      if (pSampleRate != mSampleRate || pChannels != mChannelCount || force) {
+        deleteBuffers();
+        mSampleRate = pSampleRate;
+        mChannelCount = pChannels;
+        createBuffers();
+      }
+    }
+
+    void ProcessBlock(const int nFrames) override {
+      if (byPass()) { return; }
+      if (mConvolver == nullptr) {
+        outputSilence();
+        return;
+      }
+      for (int i = 1; i < mParameterCount; i++) {
+        mParameters[i].update();
+      }
+      bool changed = false;
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        changed = changed || mMixGain[i] != mGain[i] || mMixPan[i] != mPan[i] || mMixDelay[i] != mDelay[i];
+      }
+      if (changed) {
+        mMixVersion++;
+        for (int i = 0; i < SLOT_COUNT; i++) {
+          mMixGain[i] = mGain[i];
+          mMixPan[i] = mPan[i];
+          mMixDelay[i] = mDelay[i];
+        }
+        mMixVersion++;
+        mDirty = true; // The worker will find it on its next round
+      }
+      mConvolver->mStereo = mStereo > 0.5;
+      mConvolver->ProcessBlock(
+        mSocketsIn[0].mBuffer, mSocketsOut[0].mBuffer, nFrames
+      );
+    }
+
+    String getLicense() override {
+      return WrappedConvolver::getLicense();
+    }
+
+  private:
+    /**
+     * Loads the IRs if needed, sums them up and hands the result to the convolver
+     * Never call this from the audio thread
+     */
+    void mix() {
+      soundwoofer::SWImpulseShared slots[SLOT_COUNT];
+      {
+        std::lock_guard<std::mutex> lock(mSlotMutex);
+        for (int i = 0; i < SLOT_COUNT; i++) {
+          slots[i] = mSlots[i];
+        }
+      }
+
+      // Retries if the audio thread was writing the settings at the same time
+      sample gains[SLOT_COUNT], pans[SLOT_COUNT], delays[SLOT_COUNT];
+      unsigned int version;
+      do {
+        version = mMixVersion;
+        for (int i = 0; i < SLOT_COUNT; i++) {
+          gains[i] = mMixGain[i];
+          pans[i] = mMixPan[i];
+          delays[i] = mMixDelay[i];
+        }
+      } while (version % 2 != 0 || version != mMixVersion);
+
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        soundwoofer::SWImpulseShared& ir = slots[i];
+        if (ir == nullptr) { continue; }
+        InternalIRVersion internal = getInternalIR(ir, mSampleRate);
+        if (internal.ir != nullptr) {
+          ir = internal.ir; // Already at the right samplerate
+          continue;
+        }
+        if (ir->samples != nullptr && ir->source != soundwoofer::EMBEDDED_SRC && ir->sampleRate != static_cast<size_t>(mSampleRate)) {
+          ir = getResampled(i, ir); // Was loaded for a different samplerate
+        }
+        if (ir->samples == nullptr) {
+          soundwoofer::ir::loadUnknown(&ir, mSampleRate);
+        }
+      }
+
+      size_t offsets[SLOT_COUNT] = { 0 };
+      size_t length = 0;
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        if (slots[i] == nullptr || slots[i]->samples == nullptr) { continue; }
+        offsets[i] = static_cast<size_t>(delays[i] * 0.001 * mSampleRate);
+        length = std::max(length, offsets[i] + slots[i]->length);
+      }
+      if (length == 0) { return; }
+
+      std::vector<float> left(length, 0), right(length, 0);
+      for (int i = 0; i < SLOT_COUNT; i++) {
+        const soundwoofer::SWImpulseShared& ir = slots[i];
+        if (ir == nullptr || ir->samples == nullptr) { continue; }
+        const sample gain = std::pow(10, gains[i] / 20.0);
+        const sample pan = pans[i];
+        // Same panning as the CombineNode
+        const float gainLeft = gain * std::min<sample>(1, 1 - pan);
+        const float gainRight = gain * std::min<sample>(1, 1 + pan);
+        const float* irLeft = ir->samples[0];
+        const float* irRight = ir->samples[ir->channels > 1 ? 1 : 0];
+        float* outLeft = left.data() + offsets[i];
+        float* outRight = right.data() + offsets[i];
+        for (size_t s = 0; s < ir->length; s++) {
+          outLeft[s] += irLeft[s] * gainLeft;
+          outRight[s] += irRight[s] * gainRight;
+        }
+      }
+
+      // The convolver switches to stereo on its own once it uses a stereo mix, see WrappedConvolver::mStereoIRs
+      const bool stereo = left != right;
+      float* buffers[2] = { left.data(), right.data() };
+      mConvolver->loadIR(buffers, length, stereo ? 2 : 1, static_cast<size_t>(mSampleRate * mTransitionTime));
+    }
+
+    /**
+     * Loads a copy of the IR at the samplerate of the node, keeps it around until the slot changes
+     */
+    soundwoofer::SWImpulseShared getResampled(const int slot, const soundwoofer::SWImpulseShared& ir) {
+      if (mResampledFrom[slot] == ir && mResampled[slot]->sampleRate == static_cast<size_t>(mSampleRate)) {
+        return mResampled[slot];
+      }
+      soundwoofer::SWImpulseShared copy = std::make_shared<soundwoofer::SWImpulse>();
+      copy->id = ir->id;
+      copy->name = ir->name;
+      copy->file = ir->file;
+      copy->source = ir->source;
+      soundwoofer::ir::load(copy, mSampleRate);
+      mResampled[slot] = copy;
+      mResampledFrom[slot] = ir;
+      return copy;
+    }
+
+    static constexpr const char* GainNames[SLOT_COUNT] = { "Gain 1", "Gain 2", "Gain 3", "Gain 4" };
+    static constexpr const char* PanNames[SLOT_COUNT] = { "Pan 1", "Pan 2", "Pan 3", "Pan 4" };
+    static constexpr const char* DelayNames[SLOT_COUNT] = { "Delay 1", "Delay 2", "Delay 3", "Delay 4" };
+  };
+
+  constexpr const char* MultiCabNode::GainNames[];
+  constexpr const char* MultiCabNode::PanNames[];
+  constexpr const char* MultiCabNode::DelayNames[];
+
+  GUITARD_REGISTER_NODE(
+    MultiCabNode, "Multi Cabinet", "Cabinets", "Blends up to 4 IRs at the cost of a single one"
+  )
+}
+
+#ifndef GUITARD_HEADLESS
+#include "../../ui/elements/NodeUi.h"
+namespace guitard {
+  class MultiCabNodeUi : public NodeUi {
+    MultiCabNode* mCab = nullptr; // This is just a cast of the node itself
+    IText mNameText;
+    IVButtonControl* mSlotButtons[MultiCabNode::SLOT_COUNT] = { nullptr };
+    /** The slot the popup menu was opened for */
+    int mActiveSlot = 0;
+    IPopupMenu mMenu{ "Choose IR", {"Clean", "Air", "From File", "Empty"}, [&](IPopupMenu* pMenu) {
+      IPopupMenu::Item* itemChosen = pMenu->GetChosenItem();
+      if (itemChosen) {
+        const String text = itemChosen->GetText();
+        if (text == "From File") {
+          this->openFileDialog();
+        }
+        else if (text == "Empty") {
+          mCab->loadIr(mActiveSlot, nullptr);
+        }
+        else {
+          for (int i = 0; i < InternalIRsCount; i++) {
+            if (InternalIRs[i]->name == text) {
+              mCab->loadIr(mActiveSlot, InternalIRs[i]);
+              break;
+            }
+          }
+        }
+      }
+    } };
+
+  public:
+    MultiCabNodeUi(Node* node, MessageBus::Bus* bus) : NodeUi(node, bus) {
+      mCab = dynamic_cast<MultiCabNode*>(node);
+      if (mCab == nullptr) {
+        assert(false); // Shouldn't really happen
+      }
+      mNameText = DEBUG_FONT;
+    }
+
+    void setUpControls() override {
+      NodeUi::setUpControls();
+      const float width = (mTargetRECT.W() - 40) / MultiCabNode::SLOT_COUNT;
+      for (int i = 0; i < MultiCabNode::SLOT_COUNT; i++) {
+        const float left = mTargetRECT.L + 20 + i * width;
+        const IRECT button{ left + 5, mTargetRECT.B - 50, left + width - 5, mTargetRECT.B - 20 };
+        mSlotButtons[i] = new IVButtonControl(button, [&, i](IControl* pCaller) {
+          SplashClickActionFunc(pCaller);
+          mActiveSlot = i;
+          float x, y;
+          GetUI()->GetMouseDownPoint(x, y);
+          GetUI()->CreatePopupMenu(*pCaller, mMenu, x, y);
+        }, SlotNames[i], DEFAULT_STYLE, true, false);
+        mElements.add(mSlotButtons[i]);
+        GetUI()->AttachControl(mSlotButtons[i]);
+      }
+    }
+
+    void openFileDialog() {
+      const HWND handle = reinterpret_cast<HWND>(GetUI()->GetWindow());
+      char* path = nullptr;
+
+#ifndef OS_LINUX
+      path = WDL_ChooseFileForOpen(
+        handle, "Open IR", nullptr, nullptr,
+        "Wave Files\0*.wav;*.WAV\0", "*.wav",
+        true, false
+      );
+#endif
+      if (path != nullptr) {
+        const String result = path;
+        free(path);
+        soundwoofer::SWImpulseShared load(new soundwoofer::SWImpulse());
+        load->file = result;
+        load->name = File::getFilePart(result);
+        load->source = soundwoofer::USER_SRC_ABSOLUTE;
+        mCab->loadIr(mActiveSlot, load);
+      }
+      // This is needed so the button which opened the pop up doesn't trigger the dialog again
+      GetUI()->ReleaseMouseCapture();
+    }
+
+    void Draw(IGraphics& g) override {
+      NodeUi::Draw(g);
+      const float width = (mRECT.W() - 40) / MultiCabNode::SLOT_COUNT;
+      for (int i = 0; i < MultiCabNode::SLOT_COUNT; i++) {
+        soundwoofer::SWImpulseShared ir = mCab->getIr(i);
+        const float left = mRECT.L + 20 + i * width;
+        const IRECT label{ left, mRECT.B - 80, left + width, mRECT.B - 55 };
+        g.DrawText(mNameText, ir == nullptr ? "-" : ir->name.c_str(), label);
+      }
+    }
+
+    void OnDetached() override {
+      for (int i = 0; i < MultiCabNode::SLOT_COUNT; i++) {
+        GetUI()->RemoveControl(mSlotButtons[i]);
+      }
+      NodeUi::OnDetached();
+    }
+
+  private:
+    static constexpr const char* SlotNames[MultiCabNode::SLOT_COUNT] = { "Mic 1", "Mic 2", "Mic 3", "Mic 4" };
+  };
+
+  constexpr const char* MultiCabNodeUi::SlotNames[];
+
+  GUITARD_REGISTER_NODE_UI(MultiCabNode, MultiCabNodeUi)
+}
+#endif
@@ -33,8 +33,7 @@ namespace guitard {
 
     void loadIr(soundwoofer::SWImpulseShared ir) {
       // This will be called from the gui when the IR changes
-      soundwoofer::ir::load(ir, mSampleRate);
-      mConvolver->loadIR(ir->samples, ir->length, ir->channels);
+      loadCabIR(*mConvolver, ir, mSampleRate);
       mLoadedIr = ir;
     }
 
@@ -74,10 +73,8 @@ namespace guitard {
     void createBuffers() override {
       Node::createBuffers();
       mConvolver = new WrappedConvolver(mMaxBlockSize);
-      soundwoofer::SWImpulseShared ir = mLoadedIr;
-      soundwoofer::ir::load(ir, mSampleRate);
       if (mConvolver != nullptr) { // Since the lambda could return at a point were samplerate has changed we check for null
-        mConvolver->loadIR(ir->samples, ir->length, ir->channels);
+        loadCabIR(*mConvolver, mLoadedIr, mSampleRate);
       }
       //soundwoofer::async::loadIR(ir, [&, ir](soundwoofer::Status status) {
       //  if (status == soundwoofer::SUCCESS) {
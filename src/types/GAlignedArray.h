@@ -0,0 +1,51 @@
+#pragma once
+
+#include "./GTypes.h"
+
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+  #include <malloc.h>
+#endif
+
+namespace guitard {
+  /**
+   * Array aligned to at least a cache line
+   * The hiir SIMD classes keep their state in vector registers sized members,
+   * plain new doesn't align them to more than 16 bytes before C++17
+   */
+  template <class T>
+  class AlignedArray {
+    static constexpr size_t Alignment = alignof(T) < 64 ? 64 : alignof(T);
+    T* mData = nullptr;
+    int mSize = 0;
+  public:
+    explicit AlignedArray(const int size) : mSize(size) {
+      if (size <= 0) { mSize = 0; return; }
+      void* memory = nullptr;
+#ifdef _MSC_VER
+      memory = _aligned_malloc(sizeof(T) * size, Alignment);
+#else
+      if (posix_memalign(&memory, Alignment, sizeof(T) * size) != 0) { memory = nullptr; }
+#endif
+      if (memory == nullptr) { throw std::bad_alloc(); }
+      mData = static_cast<T*>(memory);
+      for (int i = 0; i < mSize; i++) { new (mData + i) T(); }
+    }
+
+    ~AlignedArray() {
+      for (int i = 0; i < mSize; i++) { mData[i].~T(); }
+#ifdef _MSC_VER
+      _aligned_free(mData);
+#else
+      free(mData);
+#endif
+    }
+
+    T& operator[](const int index) { return mData[index]; }
+    T* data() { return mData; }
+    int size() const { return mSize; }
+
+    GUITARD_NO_COPY(AlignedArray)
+  };
+}
@@ -1,10 +1,4 @@
 #pragma once
-//#define GUITARD_CONV_THREAD_POOL
-//#define GUITARD_CONV_OPENMP
-
-#ifdef GUITARD_CONV_OPENMP
-  #include <omp.h>
-#endif
 
 #include "../GConfig.h"
 #include "./GTypes.h"
@@ -32,29 +26,37 @@
   #define GUITARD_CONV_SAME_TYPE
 #endif
 
-#include "../../thirdparty/convolver/twoStageConvolver.h"
-
-#ifdef GUITARD_CONV_THREAD_POOL
-  #include "../../thirdparty/threadpool.h"
-#endif
+#include <vector>
+#include "./GSpectralConvolver.h"
+#include "./GMailbox.h"
+#include "./GMutex.h"
 
 namespace guitard {
   /**
-   * Wraps up the FttConvolver to do easy stereo convolution
+   * Wraps up the SpectralConvolver to do easy stereo convolution
    * and also deal with the buffers
+   * Mono, stereo and true stereo IRs (left to left, left to right, right to left, right to right) are supported.
+   * If both inputs carry the same signal, e.g. a mono guitar, they share the forward transform,
+   * so a stereo cab costs about as much as a mono one.
+   * New IRs are prepared completely on the loading thread and posted to a mailbox,
+   * the audio thread picks them up at the start of a block and hands the old state
+   * back through a reclaim queue, so it never has to wait, allocate or free.
    */
   class WrappedConvolver {
     const int CONV_BLOCK_SIZE = 128;
     const int CONV_TAIL_BLOCK_SIZE = 1024 * 4;
     static const int CHANNEL_COUNT = 2;
+    /** The loading side clears it before each post, so there's at most one update in there */
+    static const int RECLAIM_SIZE = 4;
+    /**
+     * Inputs need to be identical for at least this many samples before they share the transform
+     * Going back to separate inputs means copying the whole history, so don't flip for short silences
+     * Longer IRs need the inputs to match for the whole history, see SpectralConvolver::getHistoryLength()
+     */
+    static const int SHARED_INPUT_DELAY = 1 << 14;
     int mMaxBuffer = 0;
 
-#ifdef GUITARD_CONV_THREAD_POOL
-    ctpl::thread_pool mPool;
-#endif
-
-    /** We'll only do stereo convolution at most */
-    fftconvolver::TwoStageFFTConvolver mConvolvers[CHANNEL_COUNT];
+    SpectralConvolver mConvolver;
 
 #ifndef GUITARD_CONV_SAME_TYPE
     /** Buffers need to be converted from double to float */
@@ -62,41 +64,90 @@ namespace guitard {
     FFTCONVOLVER_TYPE mConversionBufferOut[CHANNEL_COUNT][GUITARD_MAX_BUFFER];
 #endif
 
+    /** Only touched by the audio thread */
     bool mIRLoaded = false;
+    size_t mIdenticalSamples = 0;
     const int maxBuffer;
-    bool mIsProcessing = false;
+    Mailbox<SpectralConvolver::Update> mMailbox;
+    ReclaimQueue<SpectralConvolver::Update, RECLAIM_SIZE> mReclaim;
+    /** Only held by loading threads, so they don't prepare updates at the same time */
+    Mutex mLoadMutex;
   public:
 
     bool mStereo = false;
+    /**
+     * Processes in stereo while the IR is different for both sides even if mStereo is off
+     * Decided with the IR the audio thread actually uses, so the switch can't happen a block too early or late
+     */
+    bool mStereoIRs = false;
 
     GUITARD_NO_COPY(WrappedConvolver)
 
     explicit WrappedConvolver(const int maxBuffer = 512): maxBuffer(maxBuffer) {
-#ifdef GUITARD_CONV_THREAD_POOL
-      mPool.resize(1);
-#endif
       mMaxBuffer = maxBuffer;
+      mConvolver.init(CONV_BLOCK_SIZE, CONV_TAIL_BLOCK_SIZE);
     }
 
-    void loadIR(float** samples, const size_t sampleCount, const size_t channelCount) {
+    /**
+     * Loads a new IR, the spectra are computed on the calling thread
+     * Takes 1 (mono), 2 (stereo) or 4 (true stereo) channels, the true stereo
+     * order is left to left, left to right, right to left, right to right.
+     * If a crossfade length in samples is provided and there's already a IR loaded,
+     * the convolver will fade over to the new one instead of switching right away.
+     * The fade happens in the frequency domain, so it doesn't need a second convolver
+     * Precomputed spectra for each channel can be passed along, they are used if they match the block sizes
+     * Never call this from the audio thread
+     */
+    void loadIR(float** samples, const size_t sampleCount, const size_t channelCount, const size_t crossfade = 0,
+      const PreparedSpectrum* prepared = nullptr
+    ) {
       if (samples == nullptr || sampleCount == 0 || channelCount == 0) { return; }
-      mIRLoaded = false;
-      while (mIsProcessing) {}
+      if (channelCount != 1 && channelCount != 2 && channelCount != ConvPaths::COUNT) { return; }
 
+      IRSpectrumShared spectra[ConvPaths::COUNT];
       for (int c = 0; c < channelCount; c++) {
-        if (channelCount == 1) {
-          for (int ch = 0; ch < CHANNEL_COUNT; ch++) {
-            mConvolvers[ch].init(CONV_BLOCK_SIZE, CONV_TAIL_BLOCK_SIZE, samples[0], sampleCount);
-          }
-        }
-        else if (channelCount == CHANNEL_COUNT) {
-          mConvolvers[c].init(CONV_BLOCK_SIZE, CONV_TAIL_BLOCK_SIZE, samples[c], sampleCount);
-        }
+        spectra[c] = prepare(samples[c], sampleCount, prepared != nullptr ? prepared + c : nullptr);
       }
-      mIRLoaded = true;
+
+      IRSpectrumSetShared set = std::make_shared<IRSpectrumSet>();
+      if (channelCount == ConvPaths::COUNT) {
+        set->set(0, 0, spectra[0]);
+        set->set(0, 1, spectra[1]);
+        set->set(1, 0, spectra[2]);
+        set->set(1, 1, spectra[3]);
+      }
+      else { // Mono IRs use the same spectrum on both sides
+        set->set(0, 0, spectra[0]);
+        set->set(1, 1, spectra[channelCount - 1]);
+      }
+
+      LockGuard guard(mLoadMutex);
+      mReclaim.clear();
+      SpectralConvolver::Update* update = new SpectralConvolver::Update();
+      mConvolver.prepareUpdate(*update, set, crossfade);
+      SpectralConvolver::Update* superseded = mMailbox.take();
+      if (superseded != nullptr) {
+        // The audio thread never saw it, but the new update might rely on its bigger histories
+        update->inherit(*superseded);
+        delete superseded;
+      }
+      delete mMailbox.post(update); // Only the loading side posts, so this will be empty
+    }
+
+    /**
+     * Creates the spectrum of a single channel for the block sizes used here
+     */
+    IRSpectrumShared prepare(const float* samples, const size_t sampleCount, const PreparedSpectrum* prepared = nullptr) const {
+#ifdef GUITARD_FLOAT_CONVOLUTION
+      return mConvolver.prepare(samples, sampleCount, prepared); // No need to convert the IR
+#else
+      std::vector<fftconvolver::Sample> converted(samples, samples + sampleCount);
+      return mConvolver.prepare(converted.data(), sampleCount, prepared);
+#endif
     }
 
     void ProcessBlock(sample** in, sample** out, const int nFrames) {
+      receiveUpdate();
 
       if (!mIRLoaded) { // kust pass the signal through
         for (int c = 0; c < CHANNEL_COUNT; c++) {
@@ -106,54 +157,33 @@ namespace guitard {
         }
         return;
       }
-      
-      mIsProcessing = true;
-
-#ifdef GUITARD_CONV_THREAD_POOL
-      /**                          THREADPOOL TEST                       */
-      std::future<void> right;
-      if (mStereo) { // do the conv on the second channel
-        right = mPool.push([&](int id) {
-          processChannel(in, out, nFrames, 1);
-        });
-      }
 
-      processChannel(in, out, nFrames, 0);
+      // Mono only convolves the left input to the left output
+      const bool stereo = mStereo || (mStereoIRs && !mConvolver.isMirrored());
+      const int inputs = stereo ? countInputs(in, nFrames) : 1;
+      const int outputs = stereo ? CHANNEL_COUNT : 1;
 
-      if (mStereo) {
-        right.wait(); // wait for the second channel result
-      }
-      else {
-        ::memcpy(out[1], out[0], nFrames * sizeof(sample));
-      }
+#ifdef GUITARD_CONV_SAME_TYPE
+      mConvolver.process(in, out, nFrames, inputs, outputs); // no conversion needed
 #else
-#ifdef GUITARD_CONV_OPENMP
-      /**                             OPENMP TEST                        */
-      if (mStereo) {
-#pragma omp parallel num_threads(2)
-#pragma omp for
-        for (int n = 0; n < 2; ++n) {
-          processChannel(in, out, nFrames, n);
+      FFTCONVOLVER_TYPE* convIn[CHANNEL_COUNT] = { mConversionBufferIn[0], mConversionBufferIn[1] };
+      FFTCONVOLVER_TYPE* convOut[CHANNEL_COUNT] = { mConversionBufferOut[0], mConversionBufferOut[1] };
+      for (int c = 0; c < inputs; c++) {
+        for (int i = 0; i < nFrames; i++) {
+          convIn[c][i] = static_cast<float>(in[c][i]);
         }
       }
-      else {
-        processChannel(in, out, nFrames, 0);
-        ::memcpy(out[1], out[0], nFrames * sizeof(sample));
+      mConvolver.process(convIn, convOut, nFrames, inputs, outputs);
+      for (int c = 0; c < outputs; c++) {
+        for (int i = 0; i < nFrames; i++) {
+          out[c][i] = convOut[c][i];
+        }
       }
-#else
-      /**                           REFERENCE                           */
-      processChannel(in, out, nFrames, 0);
+#endif
 
-      if (!mStereo) { // mono needs the other channel filled too
+      if (outputs == 1) { // mono needs the other channel filled too
         ::memcpy(out[1], out[0], nFrames * sizeof(sample));
-    }
-      else { // else do the second channel as well
-        processChannel(in, out, nFrames, 1);
       }
-#endif
-#endif
-
-      mIsProcessing = false;
     }
 
     static String getLicense() {
@@ -169,19 +199,32 @@ namespace guitard {
     }
 
   private:
+    /**
+     * Applies the most recent IR if there is one, the old state goes to the reclaim queue
+     * An update stays in the mailbox if the queue happens to be full
+     */
+    void receiveUpdate() {
+      if (mReclaim.full()) { return; }
+      SpectralConvolver::Update* update = mMailbox.take();
+      if (update == nullptr) { return; }
+      mConvolver.apply(*update);
+      mIRLoaded = true;
+      mReclaim.push(update);
+    }
 
-    inline void processChannel(sample** in, sample** out, const int nFrames, int channel) {
-#ifdef GUITARD_CONV_SAME_TYPE
-      mConvolvers[channel].process(in[channel], out[channel], nFrames); // no conversion needed
-#else
-      for (int i = 0; i < nFrames; i++) {
-        mConversionBufferIn[channel][i] = static_cast<float>(in[channel][i]);
+    /**
+     * Returns 1 if both inputs have been the same for long enough that the histories
+     * of the convolver don't hold anything where they differ anymore
+     */
+    int countInputs(sample** in, const int nFrames) {
+      if (::memcmp(in[0], in[1], nFrames * sizeof(sample)) != 0) {
+        mIdenticalSamples = 0;
+        return 2;
       }
-      mConvolvers[channel].process(mConversionBufferIn[channel], mConversionBufferOut[channel], nFrames);
-      for (int i = 0; i < nFrames; i++) {
-        out[channel][i] = mConversionBufferOut[channel][i];
-      }
-#endif
+      // A longer IR grows the history, the inputs are split again until they matched for all of it
+      const size_t needed = std::max(size_t(SHARED_INPUT_DELAY), mConvolver.getHistoryLength());
+      mIdenticalSamples = std::min(mIdenticalSamples + size_t(nFrames), needed);
+      return mIdenticalSamples < needed ? 2 : 1;
     }
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define GUITARD_X86
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+  #define GUITARD_NEON
+#endif
+
+namespace guitard {
+  /**
+   * The instruction sets the DSP code knows about, ordered by vector width
+   */
+  enum class Simd {
+    FPU = 0,
+    SSE,
+    NEON,
+    AVX,
+    AVX512
+  };
+
+  namespace cpu {
+    inline const char* name(const Simd simd) {
+      switch (simd) {
+        case Simd::SSE: return "SSE";
+        case Simd::NEON: return "NEON";
+        case Simd::AVX: return "AVX";
+        case Simd::AVX512: return "AVX-512";
+        default: return "FPU";
+      }
+    }
+
+#ifdef GUITARD_X86
+    inline void cpuid(const unsigned int leaf, unsigned int regs[4]) {
+  #ifdef _MSC_VER
+      int info[4];
+      __cpuidex(info, static_cast<int>(leaf), 0);
+      for (int i = 0; i < 4; i++) { regs[i] = static_cast<unsigned int>(info[i]); }
+  #else
+      __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+  #endif
+    }
+
+    /**
+     * The register state the OS saves on context switches, no point in using AVX if it doesn't save the ymm registers
+     */
+    inline unsigned long long xgetbv() {
+  #ifdef _MSC_VER
+      return _xgetbv(0);
+  #else
+      unsigned int eax, edx;
+      __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return (static_cast<unsigned long long>(edx) << 32) | eax;
+  #endif
+    }
+
+    inline Simd detect() {
+      unsigned int regs[4];
+      cpuid(0, regs);
+      const unsigned int maxLeaf = regs[0];
+      cpuid(1, regs);
+      if ((regs[3] & (1u << 26)) == 0) { return Simd::FPU; } // SSE2 is needed for the double versions too
+      const bool osxsave = (regs[2] & (1u << 27)) != 0;
+      const bool avx = (regs[2] & (1u << 28)) != 0;
+      if (!osxsave || !avx) { return Simd::SSE; }
+      const unsigned long long xcr0 = xgetbv();
+      if ((xcr0 & 0x6) != 0x6) { return Simd::SSE; }
+      if (maxLeaf >= 7) {
+        cpuid(7, regs);
+        const bool avx512f = (regs[1] & (1u << 16)) != 0;
+        if (avx512f && (xcr0 & 0xE6) == 0xE6) { return Simd::AVX512; }
+      }
+      return Simd::AVX;
+    }
+#else
+    inline Simd detect() {
+  #ifdef GUITARD_NEON
+      return Simd::NEON;
+  #else
+      return Simd::FPU;
+  #endif
+    }
+#endif
+
+    /**
+     * The widest instruction set this machine can run, only detected once
+     */
+    inline Simd widest() {
+      static const Simd simd = detect();
+      return simd;
+    }
+
+    inline bool supports(const Simd simd) {
+      if (simd == Simd::FPU) { return true; }
+      const Simd available = widest();
+      if (simd == Simd::NEON || available == Simd::NEON) { return simd == available; }
+      return available != Simd::NEON && simd <= available;
+    }
+  }
+}
@@ -0,0 +1,352 @@
+#pragma once
+/**
+ * Direct form convolution for short IRs or the first few taps of long ones
+ * Include GConvolver.h instead of this file, so the sample type is set up correctly.
+ */
+
+#include <algorithm>
+
+#if defined(__AVX__) && defined(__FMA__)
+  #include <immintrin.h>
+  #define GUITARD_FIR_AVX
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define GUITARD_FIR_NEON
+#elif defined(GUITARD_SSE)
+  #include <xmmintrin.h>
+  #include <emmintrin.h>
+  #define GUITARD_FIR_SSE
+#endif
+
+#include "../../thirdparty/convolver/util.h"
+
+namespace guitard {
+  namespace fir {
+    /**
+     * Taps are padded to a multiple of this so the dot product doesn't need a tail loop
+     */
+    const size_t PADDING = 8;
+
+    inline float dot(const float* a, const float* b, const size_t len) {
+#if defined(GUITARD_FIR_AVX)
+      __m256 sum0 = _mm256_setzero_ps();
+      __m256 sum1 = _mm256_setzero_ps();
+      size_t i = 0;
+      for (; i + 16 <= len; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+      }
+      if (i < len) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+      }
+      sum0 = _mm256_add_ps(sum0, sum1);
+      __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+      return _mm_cvtss_f32(sum);
+#elif defined(GUITARD_FIR_NEON)
+      float32x4_t sum0 = vdupq_n_f32(0);
+      float32x4_t sum1 = vdupq_n_f32(0);
+      for (size_t i = 0; i < len; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+      }
+      sum0 = vaddq_f32(sum0, sum1);
+      float32x2_t sum = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+      return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#elif defined(GUITARD_FIR_SSE)
+      __m128 sum0 = _mm_setzero_ps();
+      __m128 sum1 = _mm_setzero_ps();
+      for (size_t i = 0; i < len; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+      }
+      sum0 = _mm_add_ps(sum0, sum1);
+      sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+      sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+      return _mm_cvtss_f32(sum0);
+#else
+      float sum[4] = { 0, 0, 0, 0 };
+      for (size_t i = 0; i < len; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+      }
+      return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+    }
+
+    inline double dot(const double* a, const double* b, const size_t len) {
+#if defined(GUITARD_FIR_AVX)
+      __m256d sum0 = _mm256_setzero_pd();
+      __m256d sum1 = _mm256_setzero_pd();
+      for (size_t i = 0; i < len; i += 8) {
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), sum0);
+        sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), sum1);
+      }
+      sum0 = _mm256_add_pd(sum0, sum1);
+      __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#else
+      double sum[4] = { 0, 0, 0, 0 };
+      for (size_t i = 0; i < len; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+      }
+      return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+    }
+  }
+
+  /**
+   * The convolution runs from up to two inputs to up to two outputs
+   * Each combination is a path with its own IR, like left to right in a true stereo IR
+   */
+  struct ConvPaths {
+    static const int CHANNELS = 2;
+    static const int COUNT = CHANNELS * CHANNELS;
+
+    static int index(const int input, const int output) {
+      return output * CHANNELS + input;
+    }
+  };
+
+  /**
+   * The IRs for all paths, unused ones are nullptr
+   */
+  template <class IR>
+  struct PathSet {
+    const IR* paths[ConvPaths::COUNT] = { nullptr };
+
+    const IR* get(const int input, const int output) const {
+      return paths[ConvPaths::index(input, output)];
+    }
+
+    bool empty() const {
+      for (auto path : paths) {
+        if (path != nullptr && !path->empty()) { return false; }
+      }
+      return true;
+    }
+  };
+
+  /**
+   * The taps of a IR stored in reverse and padded with zeros at the front
+   * so the dot product can run straight over the input history
+   */
+  struct FirTaps {
+    typedef fftconvolver::Sample T;
+    /** Padded length */
+    size_t length = 0;
+    fftconvolver::SampleBuffer taps;
+
+    void init(const T* ir, const size_t irLength) {
+      length = (irLength + fir::PADDING - 1) / fir::PADDING * fir::PADDING;
+      taps.resize(length);
+      for (size_t i = 0; i < irLength; i++) {
+        taps[length - 1 - i] = ir[i];
+      }
+    }
+
+    bool empty() const {
+      return length == 0;
+    }
+  };
+
+  /**
+   * Time domain convolution which adds its result to the outputs
+   * Can fade between two sets of taps like the SpectralStage, the gain is
+   * interpolated per sample though.
+   */
+  class FirStage {
+    typedef fftconvolver::Sample T;
+    static const int CHANNELS = ConvPaths::CHANNELS;
+    /** Input gets processed in chunks of this size so the history stays small */
+    static const size_t CHUNK_SIZE = 256;
+    /** Longest padded tap count the history can deal with */
+    size_t mCapacity = 0;
+    fftconvolver::SampleBuffer mHistory[CHANNELS];
+
+    PathSet<FirTaps> mTaps[2];
+    size_t mFadeLength = 0;
+    size_t mFadePos = 0;
+    bool mFading = false;
+    /** Set when there was nothing to process, means the history is out of date */
+    bool mIdle = false;
+    /** Both inputs use the first history when they are the same */
+    bool mSharedInput = true;
+
+  public:
+    /**
+     * Input history which can be allocated outside of the audio thread and handed over with adopt()
+     */
+    struct History {
+      size_t capacity = 0;
+      fftconvolver::SampleBuffer buffer[CHANNELS];
+
+      void allocate(const size_t taps) {
+        capacity = taps;
+        for (auto& b : buffer) {
+          b.resize(taps + CHUNK_SIZE);
+        }
+      }
+
+      /**
+       * Keeps the bigger of the two histories, the other one ends up in other
+       */
+      void takeLarger(History& other) {
+        if (other.capacity <= capacity) { return; }
+        for (int c = 0; c < CHANNELS; c++) {
+          fftconvolver::SampleBuffer::Swap(buffer[c], other.buffer[c]);
+        }
+        std::swap(capacity, other.capacity);
+      }
+    };
+
+    FirStage() = default;
+    GUITARD_NO_COPY(FirStage)
+
+    /**
+     * Makes sure taps of the given length can be used, keeps the history
+     * Allocates so keep it away from the audio thread
+     */
+    void reserve(const size_t taps) {
+      if (taps <= mCapacity) { return; }
+      History history;
+      history.allocate(taps);
+      adopt(history);
+    }
+
+    /**
+     * Switches to a bigger history and copies over the most recent input
+     * Realtime safe, the old buffer is left in history so it can be freed elsewhere
+     */
+    void adopt(History& history) {
+      if (history.capacity <= mCapacity) { return; }
+      for (int c = 0; c < CHANNELS; c++) {
+        if (mCapacity > 0) { // The most recent samples are at the end
+          ::memcpy(history.buffer[c].data() + history.capacity - mCapacity, mHistory[c].data(), mCapacity * sizeof(T));
+        }
+        fftconvolver::SampleBuffer::Swap(history.buffer[c], mHistory[c]);
+      }
+      std::swap(history.capacity, mCapacity);
+    }
+
+    size_t getCapacity() const {
+      return mCapacity;
+    }
+
+    void reset() {
+      for (auto& history : mHistory) {
+        history.setZero();
+      }
+    }
+
+    void setIR(const PathSet<FirTaps>& taps) {
+      wake();
+      mTaps[0] = taps;
+      mTaps[1] = PathSet<FirTaps>();
+      mFading = false;
+    }
+
+    void fadeTo(const PathSet<FirTaps>& taps, const size_t samples) {
+      if (samples == 0 || mCapacity == 0 || (mTaps[0].empty() && taps.empty())) {
+        setIR(taps);
+        return;
+      }
+      wake();
+      mTaps[1] = taps;
+      mFadeLength = samples;
+      mFadePos = 0;
+      mFading = true;
+    }
+
+    bool isFading() const {
+      return mFading;
+    }
+
+    /**
+     * @param inputs 1 if both inputs are the same, only the first one will be read then
+     * @param outputs How many outputs to add the result to
+     */
+    void process(const T* const* input, T* const* output, const size_t len, const int inputs, const int outputs) {
+      if (mCapacity == 0 || (!mFading && mTaps[0].empty())) {
+        mIdle = true;
+        return;
+      }
+      shareInput(inputs == 1);
+      size_t processed = 0;
+      while (processed < len) {
+        const size_t processing = std::min(len - processed, size_t(CHUNK_SIZE));
+        for (int i = 0; i < inputs; i++) {
+          ::memcpy(mHistory[i].data() + mCapacity, input[i] + processed, processing * sizeof(T));
+        }
+        for (int o = 0; o < outputs; o++) {
+          T* out = output[o] + processed;
+          if (mFading) {
+            const T step = T(1) / static_cast<T>(mFadeLength);
+            for (size_t s = 0; s < processing; s++) {
+              const T gain = std::min(T(1), static_cast<T>(mFadePos + s) * step);
+              out[s] += (1 - gain) * apply(mTaps[0], o, s) + gain * apply(mTaps[1], o, s);
+            }
+          }
+          else {
+            for (int i = 0; i < CHANNELS; i++) {
+              const FirTaps* taps = mTaps[0].get(i, o);
+              if (taps == nullptr || taps->empty()) { continue; }
+              const T* window = history(i) + mCapacity + 1 - taps->length;
+              for (size_t s = 0; s < processing; s++) {
+                out[s] += fir::dot(taps->taps.data(), window + s, taps->length);
+              }
+            }
+          }
+        }
+        if (mFading) {
+          mFadePos += processing;
+          if (mFadePos >= mFadeLength) {
+            setIR(mTaps[1]);
+          }
+        }
+        for (int i = 0; i < inputs; i++) {
+          ::memmove(mHistory[i].data(), mHistory[i].data() + processing, mCapacity * sizeof(T));
+        }
+        processed += processing;
+      }
+    }
+
+  private:
+    void wake() {
+      if (mIdle) {
+        reset();
+        mIdle = false;
+      }
+    }
+
+    /**
+     * The second history wasn't updated while the inputs were the same, so it gets a copy of the first one
+     */
+    void shareInput(const bool shared) {
+      if (!shared && mSharedInput) {
+        mHistory[1].copyFrom(mHistory[0]);
+      }
+      mSharedInput = shared;
+    }
+
+    const T* history(const int input) const {
+      return mHistory[mSharedInput ? 0 : input].data();
+    }
+
+    T apply(const PathSet<FirTaps>& set, const int output, const size_t i) const {
+      T sum = 0;
+      for (int input = 0; input < CHANNELS; input++) {
+        const FirTaps* taps = set.get(input, output);
+        if (taps == nullptr || taps->empty()) { continue; }
+        sum += fir::dot(taps->taps.data(), history(input) + mCapacity + 1 - taps->length + i, taps->length);
+      }
+      return sum;
+    }
+  };
+}
@@ -0,0 +1,91 @@
+#pragma once
+/**
+ * Lock free hand over of heap objects between a loading thread and the audio thread
+ * The audio thread never allocates or frees, it only passes pointers around.
+ */
+#include <atomic>
+#include "./GTypes.h"
+
+namespace guitard {
+  /**
+   * Single slot which holds the most recent object for the audio thread
+   * Posting replaces whatever wasn't picked up yet, the caller gets that one back to free it
+   */
+  template <class T>
+  class Mailbox {
+    std::atomic<T*> mSlot = { nullptr };
+  public:
+    Mailbox() = default;
+
+    ~Mailbox() {
+      delete mSlot.exchange(nullptr);
+    }
+
+    GUITARD_NO_COPY(Mailbox)
+
+    /**
+     * Returns the object which got replaced or nullptr
+     */
+    T* post(T* item) {
+      return mSlot.exchange(item, std::memory_order_acq_rel);
+    }
+
+    /**
+     * Realtime safe, returns nullptr if there's nothing new
+     */
+    T* take() {
+      if (mSlot.load(std::memory_order_relaxed) == nullptr) { return nullptr; }
+      return mSlot.exchange(nullptr, std::memory_order_acq_rel);
+    }
+  };
+
+  /**
+   * Single producer single consumer queue of pointers
+   * The audio thread pushes objects it's done with, another thread deletes them
+   */
+  template <class T, int Size>
+  class ReclaimQueue {
+    /** One slot stays empty to tell a full queue from an empty one */
+    T* mItems[Size + 1] = { nullptr };
+    std::atomic<int> mRead = { 0 };
+    std::atomic<int> mWrite = { 0 };
+  public:
+    ReclaimQueue() = default;
+
+    ~ReclaimQueue() {
+      clear();
+    }
+
+    GUITARD_NO_COPY(ReclaimQueue)
+
+    bool full() const {
+      const int write = mWrite.load(std::memory_order_relaxed);
+      return (write + 1) % (Size + 1) == mRead.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Realtime safe, returns false if the queue is full
+     */
+    bool push(T* item) {
+      const int write = mWrite.load(std::memory_order_relaxed);
+      const int next = (write + 1) % (Size + 1);
+      if (next == mRead.load(std::memory_order_acquire)) { return false; }
+      mItems[write] = item;
+      mWrite.store(next, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Frees everything handed back so far, never call this from the audio thread
+     */
+    void clear() {
+      int read = mRead.load(std::memory_order_relaxed);
+      while (read != mWrite.load(std::memory_order_acquire)) {
+        delete mItems[read];
+        mItems[read] = nullptr;
+        read = (read + 1) % (Size + 1);
+        mRead.store(read, std::memory_order_release);
+      }
+    }
+  };
+}
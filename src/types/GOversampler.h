@@ -2,120 +2,245 @@
 
 #include "../GConfig.h"
 #include "./GTypes.h"
+#include "./GOversamplerStages.h"
+#include "./GScratchArena.h"
 
-#include <functional>
-
-#ifdef GUITARD_SSE
-  #ifdef SAMPLE_TYPE_FLOAT
-    #include "../../thirdparty/HIIR/Downsampler2xSse.h"
-    #include "../../thirdparty/HIIR/Upsampler2xSse.h"
-  #else
-    #include "../../thirdparty/HIIR/Upsampler2xF64Sse2.h"
-    #include "../../thirdparty/HIIR/Downsampler2xF64Sse2.h"
-  #endif
-  
-#else
-  #include "../../thirdparty/HIIR/Upsampler2xFpu.h"
-  #include "../../thirdparty/HIIR/Downsampler2xFpu.h"
+#include "../../thirdparty/HIIR/PolyphaseIIR2Designer.h"
+#ifndef GUITARD_HIIR_DESIGNER_LINKED // The hiir test project compiles the designer on its own
+  #include "../../thirdparty/HIIR/PolyphaseIIR2Designer.cpp"
 #endif
 
+#include <functional>
 
 namespace guitard {
+  /**
+   * Stopband attenuation in dB and transition band of the first 2x stage relative to its samplerate
+   * The later stages only have to keep the images of the previous ones out, so they get away with
+   * a wider transition band and a lot less coefficients
+   */
+  struct OversamplingQuality {
+    const char* name;
+    double attenuation;
+    double transition;
+  };
+
+  const OversamplingQuality OversamplingQualities[] = {
+    { "Eco", 70, 0.05 },
+    { "Normal", 100, 0.025 },
+    { "High", 130, 0.01 }
+  };
+
+  const int OversamplingQualityCount = 3;
+
   /**
    * Super simple wrapper for the hiir up and down samplers
-   * It only goes up to 4x oversampling 
+   * Goes up to 16x oversampling by cascading 2x stages, the coefficients are designed
+   * for each quality when the channels are set.
+   * The hiir implementation gets picked at runtime for the CPU it's running on,
+   * all channels are filtered in a single pass using the lanes of the SIMD versions
+   * The oversampled signal only lives in the ScratchArena of the thread while processing
    */
   class Oversampler {
-    static constexpr int mChannels = 2;
     using T = sample;
+    static const int MaxStages = 4;
+    static const int MaxCoefficients = 16;
 
-#ifdef GUITARD_SSE
-  #ifdef SAMPLE_TYPE_FLOAT
-    hiir::Upsampler2xSse<12> mUp2x[mChannels];
-    hiir::Downsampler2xSse<12> mDown2x[mChannels];
-    hiir::Upsampler2xSse<4> mUp4x[mChannels];
-    hiir::Downsampler2xSse<4> mDown4x[mChannels];
-  #else
-    hiir::Upsampler2xF64Sse2<12> mUp2x[mChannels];
-    hiir::Downsampler2xF64Sse2<12> mDown2x[mChannels];
-    hiir::Upsampler2xF64Sse2<4> mUp4x[mChannels];
-    hiir::Downsampler2xF64Sse2<4> mDown4x[mChannels];
-  #endif
-#else
-    hiir::Upsampler2xFpuTpl<12, T> mUp2x[mChannels];
-    hiir::Downsampler2xFpuTpl<12, T> mDown2x[mChannels];
-    hiir::Upsampler2xFpuTpl<4, T> mUp4x[mChannels];
-    hiir::Downsampler2xFpuTpl<4, T> mDown4x[mChannels];
-#endif
-
-    // Stack buffers are more convenient
-    T mBufs2x[mChannels * 2][GUITARD_MAX_BUFFER * 2];
-    T* mBuf2xUp[mChannels] = { mBufs2x[0], mBufs2x[1] };
-    T* mBuf2xDown[mChannels] = { mBufs2x[2], mBufs2x[3] };
-
-    T mBufs4x[mChannels * 2][GUITARD_MAX_BUFFER * 4];
-    T* mBuf4xUp[mChannels] = { mBufs4x[0], mBufs4x[1] };
-    T* mBuf4xDown[mChannels] = { mBufs4x[2], mBufs4x[3] };
+    int mInputs = 0;
+    int mOutputs = 0;
+    Simd mSimd;
+    int mQuality = 1;
+    int mStageCount = 0;
 
     /**
-     * Straight up stolen from the hiir oversampler wrapper from iPlug2
-     * https://github.com/iPlug2/iPlug2/blob/master/IPlug/Extras/Oversampler.h
+     * Every quality has its own stages so switching doesn't allocate
+     */
+    OversamplingStage* mStages[OversamplingQualityCount][MaxStages] = { };
+    /**
+     * Delay of going up and down again through each stage in samples at the base samplerate
      */
-    const double coeffs2x[12] = { 0.036681502163648017, 0.13654762463195794, 0.27463175937945444, 0.42313861743656711, 0.56109869787919531, 0.67754004997416184, 0.76974183386322703, 0.83988962484963892, 0.89226081800387902, 0.9315419599631839, 0.96209454837808417, 0.98781637073289585 };
-    const double coeffs4x[4] = { 0.041893991997656171, 0.16890348243995201, 0.39056077292116603, 0.74389574826847926 };
+    double mDelay[OversamplingQualityCount][MaxStages] = { };
+
+    void deleteBuffers() {
+      for (int q = 0; q < OversamplingQualityCount; q++) {
+        for (int s = 0; s < MaxStages; s++) {
+          delete mStages[q][s];
+          mStages[q][s] = nullptr;
+        }
+      }
+    }
+
+    void clearStages() {
+      for (int s = 0; s < MaxStages; s++) {
+        mStages[mQuality][s]->clear();
+      }
+    }
+
   public:
+    static const unsigned int MaxFactor = 1u << MaxStages;
     unsigned int mFactor = 1;
     using ProcessFunction = std::function<void(T**, T**, int)>;
     ProcessFunction mProc;
 
-    Oversampler() {
-      for (int c = 0; c < mChannels; c++) {
-        mUp2x[c].set_coefs(coeffs2x);
-        mDown2x[c].set_coefs(coeffs2x);
-        mUp4x[c].set_coefs(coeffs4x);
-        mDown4x[c].set_coefs(coeffs4x);
+    /**
+     * The instruction set can be limited to compare the implementations
+     */
+    explicit Oversampler(const int inputs = 2, const int outputs = 2, const Simd simd = cpu::widest()) : mSimd(simd) {
+      setChannels(inputs, outputs);
+    }
+
+    ~Oversampler() {
+      deleteBuffers();
+    }
+
+    GUITARD_NO_COPY(Oversampler)
+
+    /**
+     * Sets the amount of channels going in and out of mProc, allocates so don't call it while processing
+     */
+    void setChannels(const int inputs, const int outputs) {
+      if (inputs == mInputs && outputs == mOutputs && mStages[0][0] != nullptr) { return; }
+      deleteBuffers();
+      mInputs = inputs;
+      mOutputs = outputs;
+
+      double coefficients[MaxCoefficients];
+      for (int q = 0; q < OversamplingQualityCount; q++) {
+        const OversamplingQuality& quality = OversamplingQualities[q];
+        for (int s = 0; s < MaxStages; s++) {
+          // Everything above the passband of the first stage is already gone
+          const double transition = 0.25 - (0.25 - quality.transition) / (1 << s);
+          int count = hiir::PolyphaseIir2Designer::compute_nbr_coefs_from_proto(quality.attenuation, transition);
+          count = std::min(int(MaxCoefficients), count + count % 2); // Only even counts get compiled
+          hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefficients, count, transition);
+          mStages[q][s] = createOversamplingStage(count, inputs, outputs, mSimd);
+          mStages[q][s]->setCoefficients(coefficients);
+          mStages[q][s]->clear();
+          // The designer adds up both paths, which is what going up and down again costs at the oversampled rate
+          const double delay = hiir::PolyphaseIir2Designer::compute_group_delay(coefficients, count, 0, false);
+          mDelay[q][s] = delay / (2 << s);
+        }
+      }
+    }
+
+    /**
+     * Scratch memory needed to process a block of frames with the given amount of stages
+     * Defaults to the worst case the graph has to prepare for
+     */
+    size_t getScratchSize(const int frames = GUITARD_MAX_BUFFER, const int stages = MaxStages) const {
+      size_t size = 0;
+      for (int s = 0; s < stages; s++) {
+        size += ScratchArena::channelBytes<T>(mInputs, frames << (s + 1));
+        size += ScratchArena::channelBytes<T>(mOutputs, frames << (s + 1));
+      }
+      return size;
+    }
+
+    /**
+     * Snaps the factor down to the next power of two up to 16 and returns it
+     */
+    unsigned int setFactor(const unsigned int factor) {
+      int stages = 0;
+      while (stages < MaxStages && (2u << stages) <= factor) { stages++; }
+      if (stages != mStageCount) {
+        mStageCount = stages;
+        mFactor = 1u << stages;
+        clearStages();
       }
+      return mFactor;
+    }
+
+    /**
+     * Index into OversamplingQualities
+     */
+    void setQuality(const int quality) {
+      const int q = std::max(0, std::min(OversamplingQualityCount - 1, quality));
+      if (q != mQuality) {
+        mQuality = q;
+        clearStages();
+      }
+    }
+
+    int getQuality() const {
+      return mQuality;
+    }
+
+    /**
+     * The delay added by the current factor and quality in samples at the base samplerate
+     * This is the group delay at DC, the filters aren't linear phase so it goes up towards the transition band
+     */
+    double getLatency() const {
+      double latency = 0;
+      for (int s = 0; s < mStageCount; s++) { latency += mDelay[mQuality][s]; }
+      return latency;
+    }
+
+    /**
+     * The instruction set the first stage ended up with
+     */
+    Simd simd() const {
+      return mStages[mQuality][0]->simd();
+    }
+
+    /**
+     * How many channels the first stage filters at once
+     */
+    int lanes() const {
+      return mStages[mQuality][0]->lanes();
     }
 
     void process(T** in, T** out, const int frames) {
       /**
        * No OverSampling at all
        */
-      if (mFactor == 1) {
+      if (mStageCount == 0) {
         mProc(in, out, frames);
         return;
       }
 
-      /**
-       * 2x OverSampling
-       */
-      if (mFactor == 2 || mFactor == 3) {
-        for (int c = 0; c < mChannels; c++) {
-          mUp2x[c].process_block(mBuf2xUp[c], in[c], frames);
-        }
-
-        mProc(mBuf2xUp, mBuf2xDown, frames * 2);
-        
-        for (int c = 0; c < mChannels; c++) {
-          mDown2x[c].process_block(out[c], mBuf2xDown[c], frames);
-        }
+      ScratchArena& arena = ScratchArena::current();
+      if (!arena.reserve(getScratchSize(frames, mStageCount))) {
+        assert(false); // The graph didn't make enough space
+        silence(out, frames);
         return;
       }
+      ScratchArena::Frame frame(arena);
+      T** bufUp[MaxStages];
+      T** bufDown[MaxStages];
+      for (int s = 0; s < mStageCount; s++) {
+        bufUp[s] = arena.takeChannels<T>(mInputs, frames << (s + 1));
+        bufDown[s] = arena.takeChannels<T>(mOutputs, frames << (s + 1));
+        if (bufUp[s] == nullptr || bufDown[s] == nullptr) {
+          silence(out, frames);
+          return;
+        }
+      }
 
       /**
-       * 4x OverSampling
+       * Up through all the stages, process at the highest rate and back down again
        */
-      for (int c = 0; c < mChannels; c++) {
-        mUp2x[c].process_block(mBuf2xUp[c], in[c], frames);
-        mUp4x[c].process_block(mBuf4xUp[c], mBuf2xUp[c], frames * 2);
+      OversamplingStage** stages = mStages[mQuality];
+      T** up = in;
+      for (int s = 0; s < mStageCount; s++) {
+        stages[s]->up(bufUp[s], up, frames << s);
+        up = bufUp[s];
       }
 
-      mProc(mBuf4xUp, mBuf4xDown, frames * 4);
+      mProc(up, bufDown[mStageCount - 1], frames << mStageCount);
 
-      for (int c = 0; c < mChannels; c++) {
-        mDown4x[c].process_block(mBuf2xDown[c], mBuf4xDown[c], frames * 2);
-        mDown2x[c].process_block(out[c], mBuf2xDown[c], frames);
+      for (int s = mStageCount - 1; s > 0; s--) {
+        stages[s]->down(bufDown[s - 1], bufDown[s], frames << s);
+      }
+      stages[0]->down(out, bufDown[0], frames);
+    }
+
+  private:
+    /**
+     * Used when there's no scratch memory left to oversample with
+     */
+    void silence(T** out, const int frames) const {
+      for (int c = 0; c < mOutputs; c++) {
+        for (int i = 0; i < frames; i++) { out[c][i] = 0; }
       }
     }
   };
-}
\ No newline at end of file
+}
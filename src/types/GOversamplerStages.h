@@ -0,0 +1,420 @@
+#pragma once
+
+#include "../GConfig.h"
+#include "./GTypes.h"
+#include "./GCpu.h"
+
+#include "./GAlignedArray.h"
+
+#include <type_traits>
+#include <algorithm>
+
+#include "../../thirdparty/HIIR/Upsampler2xFpuTpl.h"
+#include "../../thirdparty/HIIR/Downsampler2xFpuTpl.h"
+
+#if defined(GUITARD_SSE) && defined(GUITARD_X86)
+  #define GUITARD_OVERSAMPLER_X86
+  #include <array>
+  #include <cassert>
+  #include <immintrin.h>
+  #include "../../thirdparty/HIIR/def.h"
+  #include "../../thirdparty/HIIR/fnc.h"
+  #include "../../thirdparty/HIIR/Upsampler2xSse.h"
+  #include "../../thirdparty/HIIR/Downsampler2xSse.h"
+  #include "../../thirdparty/HIIR/Upsampler2x4Sse.h"
+  #include "../../thirdparty/HIIR/Downsampler2x4Sse.h"
+  #include "../../thirdparty/HIIR/Upsampler2xF64Sse2.h"
+  #include "../../thirdparty/HIIR/Downsampler2xF64Sse2.h"
+  #include "../../thirdparty/HIIR/Upsampler2x2F64Sse2.h"
+  #include "../../thirdparty/HIIR/Downsampler2x2F64Sse2.h"
+
+  /**
+   * The AVX versions get compiled for AVX no matter what the rest of the plugin is compiled for,
+   * they are only used when the CPU supports it. MSVC doesn't need any of this.
+   * Everything they include has to be included above so it doesn't end up in here.
+   */
+  #if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx"))), apply_to = function)
+  #elif defined(__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target("avx")
+  #endif
+  #include "../../thirdparty/HIIR/Upsampler2x8Avx.h"
+  #include "../../thirdparty/HIIR/Downsampler2x8Avx.h"
+  #include "../../thirdparty/HIIR/Upsampler2x4F64Avx.h"
+  #include "../../thirdparty/HIIR/Downsampler2x4F64Avx.h"
+  #if defined(__clang__)
+    #pragma clang attribute pop
+  #elif defined(__GNUC__)
+    #pragma GCC pop_options
+  #endif
+
+  #if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+  #elif defined(__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target("avx512f")
+  #endif
+  #include "../../thirdparty/HIIR/Upsampler2x16Avx512.h"
+  #include "../../thirdparty/HIIR/Downsampler2x16Avx512.h"
+  #include "../../thirdparty/HIIR/Upsampler2x8F64Avx512.h"
+  #include "../../thirdparty/HIIR/Downsampler2x8F64Avx512.h"
+  #if defined(__clang__)
+    #pragma clang attribute pop
+  #elif defined(__GNUC__)
+    #pragma GCC pop_options
+  #endif
+#endif
+
+#if defined(GUITARD_NEON) && defined(SAMPLE_TYPE_FLOAT)
+  #define GUITARD_OVERSAMPLER_NEON
+  #include "../../thirdparty/HIIR/Upsampler2xNeon.h"
+  #include "../../thirdparty/HIIR/Downsampler2xNeon.h"
+  #include "../../thirdparty/HIIR/Upsampler2x4Neon.h"
+  #include "../../thirdparty/HIIR/Downsampler2x4Neon.h"
+#endif
+
+namespace guitard {
+  /**
+   * Common interface for a single 2x step of the hiir up and down samplers
+   * covering all the channels of the oversampler
+   */
+  class OversamplingStage {
+  public:
+    virtual ~OversamplingStage() = default;
+    virtual void setCoefficients(const double* coefficients) = 0;
+    /**
+     * Doubles the samplerate, out needs space for frames * 2
+     */
+    virtual void up(sample** out, sample** in, int frames) = 0;
+    /**
+     * Halves the samplerate, frames is the amount written to out
+     */
+    virtual void down(sample** out, sample** in, int frames) = 0;
+    virtual void clear() = 0;
+    virtual Simd simd() const = 0;
+    /**
+     * How many channels get processed at once
+     */
+    virtual int lanes() const = 0;
+  };
+
+  /**
+   * Copies frames of the channels into a buffer with one frame after another, frame i of channel c ends up at
+   * out[i * lanes + c]. Lanes without a channel aren't touched.
+   */
+  template <typename T>
+  void interleaveLanes(T* out, T** in, const int channels, const int lanes, const int offset, const int frames) {
+    for (int i = 0; i < frames; i++) {
+      T* frame = out + i * lanes;
+      for (int c = 0; c < channels; c++) { frame[c] = in[c][offset + i]; }
+    }
+  }
+
+  template <typename T>
+  void deinterleaveLanes(T** out, const T* in, const int channels, const int lanes, const int offset, const int frames) {
+    for (int i = 0; i < frames; i++) {
+      const T* frame = in + i * lanes;
+      for (int c = 0; c < channels; c++) { out[c][offset + i] = frame[c]; }
+    }
+  }
+
+#ifdef GUITARD_OVERSAMPLER_X86
+  /**
+   * The scalar versions take longer than the filters themselves, these transpose 4x4 floats
+   * or 2x2 doubles at once and only need SSE2. The lanes have to be a multiple of 4 or 2.
+   */
+  inline void interleaveLanes(float* out, float** in, const int channels, const int lanes, const int offset, const int frames) {
+    const int aligned = frames & ~3;
+    const __m128 zero = _mm_setzero_ps();
+    for (int c = 0; c < channels; c += 4) {
+      const int group = channels - c;
+      if (group == 2) { // The stereo pair only needs a unpack
+        const float* c0 = in[c] + offset;
+        const float* c1 = in[c + 1] + offset;
+        for (int i = 0; i < aligned; i += 4) {
+          const __m128 a = _mm_loadu_ps(c0 + i);
+          const __m128 b = _mm_loadu_ps(c1 + i);
+          const __m128 low = _mm_unpacklo_ps(a, b);
+          const __m128 high = _mm_unpackhi_ps(a, b);
+          float* frame = out + i * lanes + c;
+          _mm_storel_pi(reinterpret_cast<__m64*>(frame), low);
+          _mm_storeh_pi(reinterpret_cast<__m64*>(frame + lanes), low);
+          _mm_storel_pi(reinterpret_cast<__m64*>(frame + lanes * 2), high);
+          _mm_storeh_pi(reinterpret_cast<__m64*>(frame + lanes * 3), high);
+        }
+        continue;
+      }
+      const float* c0 = in[c] + offset;
+      const float* c1 = group > 1 ? in[c + 1] + offset : nullptr;
+      const float* c2 = group > 2 ? in[c + 2] + offset : nullptr;
+      const float* c3 = group > 3 ? in[c + 3] + offset : nullptr;
+      for (int i = 0; i < aligned; i += 4) {
+        __m128 r0 = _mm_loadu_ps(c0 + i);
+        __m128 r1 = c1 != nullptr ? _mm_loadu_ps(c1 + i) : zero;
+        __m128 r2 = c2 != nullptr ? _mm_loadu_ps(c2 + i) : zero;
+        __m128 r3 = c3 != nullptr ? _mm_loadu_ps(c3 + i) : zero;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        float* frame = out + i * lanes + c;
+        _mm_storeu_ps(frame, r0);
+        _mm_storeu_ps(frame + lanes, r1);
+        _mm_storeu_ps(frame + lanes * 2, r2);
+        _mm_storeu_ps(frame + lanes * 3, r3);
+      }
+    }
+    if (aligned < frames) {
+      interleaveLanes<float>(out + aligned * lanes, in, channels, lanes, offset + aligned, frames - aligned);
+    }
+  }
+
+  inline void deinterleaveLanes(float** out, const float* in, const int channels, const int lanes, const int offset, const int frames) {
+    const int aligned = frames & ~3;
+    for (int c = 0; c < channels; c += 4) {
+      const int group = channels - c;
+      if (group == 2) {
+        float* c0 = out[c] + offset;
+        float* c1 = out[c + 1] + offset;
+        for (int i = 0; i < aligned; i += 4) {
+          const float* frame = in + i * lanes + c;
+          __m128 low = _mm_setzero_ps();
+          __m128 high = _mm_setzero_ps();
+          low = _mm_loadl_pi(low, reinterpret_cast<const __m64*>(frame));
+          low = _mm_loadh_pi(low, reinterpret_cast<const __m64*>(frame + lanes));
+          high = _mm_loadl_pi(high, reinterpret_cast<const __m64*>(frame + lanes * 2));
+          high = _mm_loadh_pi(high, reinterpret_cast<const __m64*>(frame + lanes * 3));
+          _mm_storeu_ps(c0 + i, _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+          _mm_storeu_ps(c1 + i, _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+        continue;
+      }
+      for (int i = 0; i < aligned; i += 4) {
+        const float* frame = in + i * lanes + c;
+        __m128 r0 = _mm_loadu_ps(frame);
+        __m128 r1 = _mm_loadu_ps(frame + lanes);
+        __m128 r2 = _mm_loadu_ps(frame + lanes * 2);
+        __m128 r3 = _mm_loadu_ps(frame + lanes * 3);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out[c] + offset + i, r0);
+        if (group > 1) { _mm_storeu_ps(out[c + 1] + offset + i, r1); }
+        if (group > 2) { _mm_storeu_ps(out[c + 2] + offset + i, r2); }
+        if (group > 3) { _mm_storeu_ps(out[c + 3] + offset + i, r3); }
+      }
+    }
+    if (aligned < frames) {
+      deinterleaveLanes<float>(out, in + aligned * lanes, channels, lanes, offset + aligned, frames - aligned);
+    }
+  }
+
+  inline void interleaveLanes(double* out, double** in, const int channels, const int lanes, const int offset, const int frames) {
+    const int aligned = frames & ~1;
+    const __m128d zero = _mm_setzero_pd();
+    for (int c = 0; c < channels; c += 2) {
+      const double* c0 = in[c] + offset;
+      const double* c1 = c + 1 < channels ? in[c + 1] + offset : nullptr;
+      for (int i = 0; i < aligned; i += 2) {
+        const __m128d a = _mm_loadu_pd(c0 + i);
+        const __m128d b = c1 != nullptr ? _mm_loadu_pd(c1 + i) : zero;
+        _mm_storeu_pd(out + i * lanes + c, _mm_unpacklo_pd(a, b));
+        _mm_storeu_pd(out + (i + 1) * lanes + c, _mm_unpackhi_pd(a, b));
+      }
+    }
+    if (aligned < frames) {
+      interleaveLanes<double>(out + aligned * lanes, in, channels, lanes, offset + aligned, frames - aligned);
+    }
+  }
+
+  inline void deinterleaveLanes(double** out, const double* in, const int channels, const int lanes, const int offset, const int frames) {
+    const int aligned = frames & ~1;
+    for (int c = 0; c < channels; c += 2) {
+      for (int i = 0; i < aligned; i += 2) {
+        const __m128d a = _mm_loadu_pd(in + i * lanes + c);
+        const __m128d b = _mm_loadu_pd(in + (i + 1) * lanes + c);
+        _mm_storeu_pd(out[c] + offset + i, _mm_unpacklo_pd(a, b));
+        if (c + 1 < channels) { _mm_storeu_pd(out[c + 1] + offset + i, _mm_unpackhi_pd(a, b)); }
+      }
+    }
+    if (aligned < frames) {
+      deinterleaveLanes<double>(out, in + aligned * lanes, channels, lanes, offset + aligned, frames - aligned);
+    }
+  }
+#endif
+
+  /**
+   * One hiir object for each channel, they do the filter stages in parallel
+   */
+  template <class Up, class Down>
+  class MonoOversamplingStage : public OversamplingStage {
+    static_assert(std::is_same<typename Up::DataType, sample>::value, "The hiir class has to use the sample type");
+    AlignedArray<Up> mUp;
+    AlignedArray<Down> mDown;
+    const Simd mSimd;
+  public:
+    MonoOversamplingStage(const int inputs, const int outputs, const Simd simd) :
+      mUp(inputs), mDown(outputs), mSimd(simd) { }
+
+    void setCoefficients(const double* coefficients) override {
+      for (int c = 0; c < mUp.size(); c++) { mUp[c].set_coefs(coefficients); }
+      for (int c = 0; c < mDown.size(); c++) { mDown[c].set_coefs(coefficients); }
+    }
+
+    void up(sample** out, sample** in, const int frames) override {
+      for (int c = 0; c < mUp.size(); c++) {
+        mUp[c].process_block(out[c], in[c], frames);
+      }
+    }
+
+    void down(sample** out, sample** in, const int frames) override {
+      for (int c = 0; c < mDown.size(); c++) {
+        mDown[c].process_block(out[c], in[c], frames);
+      }
+    }
+
+    void clear() override {
+      for (int c = 0; c < mUp.size(); c++) { mUp[c].clear_buffers(); }
+      for (int c = 0; c < mDown.size(); c++) { mDown[c].clear_buffers(); }
+    }
+
+    Simd simd() const override { return mSimd; }
+    int lanes() const override { return 1; }
+  };
+
+  /**
+   * Each vector lane of the hiir object is a channel, so a single pass filters all of them
+   * The channels get interleaved in small chunks, the results of lanes without a channel are ignored
+   */
+  template <class Up, class Down>
+  class LaneOversamplingStage : public OversamplingStage {
+    static_assert(std::is_same<typename Up::DataType, sample>::value, "The hiir class has to use the sample type");
+    static constexpr int Lanes = Up::_nbr_chn;
+    static constexpr int Chunk = 64;
+    const int mInputs;
+    const int mOutputs;
+    const Simd mSimd;
+    /** One for every group of Lanes channels */
+    AlignedArray<Up> mUp;
+    AlignedArray<Down> mDown;
+    /** Starts out zeroed so unused lanes never see garbage */
+    sample mInterleaved[Chunk * 2 * Lanes] = { 0 };
+    sample mResult[Chunk * 2 * Lanes];
+
+  public:
+    LaneOversamplingStage(const int inputs, const int outputs, const Simd simd) :
+      mInputs(inputs), mOutputs(outputs), mSimd(simd),
+      mUp((inputs + Lanes - 1) / Lanes), mDown((outputs + Lanes - 1) / Lanes) { }
+
+    void setCoefficients(const double* coefficients) override {
+      for (int g = 0; g < mUp.size(); g++) { mUp[g].set_coefs(coefficients); }
+      for (int g = 0; g < mDown.size(); g++) { mDown[g].set_coefs(coefficients); }
+    }
+
+    void up(sample** out, sample** in, const int frames) override {
+      for (int g = 0; g < mUp.size(); g++) {
+        const int first = g * Lanes;
+        const int channels = std::min(int(Lanes), mInputs - first);
+        for (int offset = 0; offset < frames; offset += Chunk) {
+          const int length = std::min(int(Chunk), frames - offset);
+          interleaveLanes(mInterleaved, in + first, channels, Lanes, offset, length);
+          mUp[g].process_block(mResult, mInterleaved, length);
+          deinterleaveLanes(out + first, mResult, channels, Lanes, offset * 2, length * 2);
+        }
+      }
+    }
+
+    void down(sample** out, sample** in, const int frames) override {
+      for (int g = 0; g < mDown.size(); g++) {
+        const int first = g * Lanes;
+        const int channels = std::min(int(Lanes), mOutputs - first);
+        for (int offset = 0; offset < frames; offset += Chunk) {
+          const int length = std::min(int(Chunk), frames - offset);
+          interleaveLanes(mInterleaved, in + first, channels, Lanes, offset * 2, length * 2);
+          mDown[g].process_block(mResult, mInterleaved, length);
+          deinterleaveLanes(out + first, mResult, channels, Lanes, offset, length);
+        }
+      }
+    }
+
+    void clear() override {
+      for (int g = 0; g < mUp.size(); g++) { mUp[g].clear_buffers(); }
+      for (int g = 0; g < mDown.size(); g++) { mDown[g].clear_buffers(); }
+    }
+
+    Simd simd() const override { return mSimd; }
+    int lanes() const override { return Lanes; }
+  };
+  /**
+   * If the instruction set is supported and not above the limit
+   */
+  inline bool canUse(const Simd simd, const Simd limit) {
+    if (!cpu::supports(simd)) { return false; }
+    if (simd == Simd::NEON || limit == Simd::NEON) { return simd == limit; }
+    return simd <= limit;
+  }
+
+  /**
+   * Picks the widest hiir implementation the CPU supports for the channels
+   * Once the channels are interleaved the lane versions beat the mono ones even for a stereo pair,
+   * but lanes without a channel cost as much as used ones, so AVX and AVX-512 need all their lanes filled.
+   */
+  template <int NC>
+  OversamplingStage* createOversamplingStage(const int inputs, const int outputs, const Simd limit = cpu::widest()) {
+    const int channels = std::max(inputs, outputs);
+#ifdef GUITARD_OVERSAMPLER_X86
+  #ifdef SAMPLE_TYPE_FLOAT
+    if (channels >= 16 && canUse(Simd::AVX512, limit)) {
+      return new LaneOversamplingStage<hiir::Upsampler2x16Avx512<NC>, hiir::Downsampler2x16Avx512<NC>>(inputs, outputs, Simd::AVX512);
+    }
+    if (channels >= 8 && canUse(Simd::AVX, limit)) {
+      return new LaneOversamplingStage<hiir::Upsampler2x8Avx<NC>, hiir::Downsampler2x8Avx<NC>>(inputs, outputs, Simd::AVX);
+    }
+    if (canUse(Simd::SSE, limit)) {
+      if (channels >= 2) {
+        return new LaneOversamplingStage<hiir::Upsampler2x4Sse<NC>, hiir::Downsampler2x4Sse<NC>>(inputs, outputs, Simd::SSE);
+      }
+      return new MonoOversamplingStage<hiir::Upsampler2xSse<NC>, hiir::Downsampler2xSse<NC>>(inputs, outputs, Simd::SSE);
+    }
+  #else
+    if (channels >= 8 && canUse(Simd::AVX512, limit)) {
+      return new LaneOversamplingStage<hiir::Upsampler2x8F64Avx512<NC>, hiir::Downsampler2x8F64Avx512<NC>>(inputs, outputs, Simd::AVX512);
+    }
+    if (channels >= 4 && canUse(Simd::AVX, limit)) {
+      return new LaneOversamplingStage<hiir::Upsampler2x4F64Avx<NC>, hiir::Downsampler2x4F64Avx<NC>>(inputs, outputs, Simd::AVX);
+    }
+    if (canUse(Simd::SSE, limit)) {
+      if (channels >= 2) {
+        return new LaneOversamplingStage<hiir::Upsampler2x2F64Sse2<NC>, hiir::Downsampler2x2F64Sse2<NC>>(inputs, outputs, Simd::SSE);
+      }
+      return new MonoOversamplingStage<hiir::Upsampler2xF64Sse2<NC>, hiir::Downsampler2xF64Sse2<NC>>(inputs, outputs, Simd::SSE);
+    }
+  #endif
+#endif
+#ifdef GUITARD_OVERSAMPLER_NEON
+    if (canUse(Simd::NEON, limit)) {
+      if (channels >= 4) { // The interleaving isn't vectorized for NEON
+        return new LaneOversamplingStage<hiir::Upsampler2x4Neon<NC>, hiir::Downsampler2x4Neon<NC>>(inputs, outputs, Simd::NEON);
+      }
+      return new MonoOversamplingStage<hiir::Upsampler2xNeon<NC>, hiir::Downsampler2xNeon<NC>>(inputs, outputs, Simd::NEON);
+    }
+#endif
+    return new MonoOversamplingStage<hiir::Upsampler2xFpuTpl<NC, sample>, hiir::Downsampler2xFpuTpl<NC, sample>>(inputs, outputs, Simd::FPU);
+  }
+
+  /**
+   * Same as above for a coefficient count only known at runtime
+   * Odd counts get rounded up, so the coefficients have to be designed for the returned count
+   */
+  inline OversamplingStage* createOversamplingStage(
+    const int coefficients, const int inputs, const int outputs, const Simd limit = cpu::widest()
+  ) {
+    switch ((coefficients + 1) / 2) {
+      case 0:
+      case 1: return createOversamplingStage<2>(inputs, outputs, limit);
+      case 2: return createOversamplingStage<4>(inputs, outputs, limit);
+      case 3: return createOversamplingStage<6>(inputs, outputs, limit);
+      case 4: return createOversamplingStage<8>(inputs, outputs, limit);
+      case 5: return createOversamplingStage<10>(inputs, outputs, limit);
+      case 6: return createOversamplingStage<12>(inputs, outputs, limit);
+      case 7: return createOversamplingStage<14>(inputs, outputs, limit);
+      default: return createOversamplingStage<16>(inputs, outputs, limit);
+    }
+  }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "../GConfig.h"
+#include "./GTypes.h"
+#include "./GAlignedArray.h"
+
+#include <cassert>
+
+namespace guitard {
+  /**
+   * Scratch memory for things only needed while a node processes a block, like the oversampled signal
+   * Pieces get handed out front to back and are all cache line aligned, every node reuses the same
+   * memory so it stays in the cache. The graph owns one for the thread processing it and binds it with
+   * a Scope, so the memory scales with the threads instead of the nodes.
+   */
+  class ScratchArena {
+    static const size_t Alignment = 64;
+
+    AlignedArray<unsigned char>* mMemory = nullptr;
+    size_t mSize = 0;
+    size_t mUsed = 0;
+
+    static ScratchArena*& bound() {
+      thread_local ScratchArena* arena = nullptr;
+      return arena;
+    }
+
+  public:
+    /**
+     * Size of a piece for count Ts including the padding to the next one
+     */
+    template <class T>
+    static size_t bytes(const size_t count) {
+      return (sizeof(T) * count + Alignment - 1) / Alignment * Alignment;
+    }
+
+    /**
+     * Size of count channels with frames each and the array pointing to them, see takeChannels()
+     */
+    template <class T>
+    static size_t channelBytes(const size_t count, const size_t frames) {
+      return bytes<T*>(count) + count * bytes<T>(frames);
+    }
+
+    explicit ScratchArena(const size_t size = 0) {
+      reserve(size);
+    }
+
+    ~ScratchArena() {
+      delete mMemory;
+    }
+
+    GUITARD_NO_COPY(ScratchArena)
+
+    /**
+     * Makes sure size more bytes fit on top of what's already taken,
+     * this will allocate so the graph does it before processing
+     * Only grows while nothing is taken, returns false if there's still not enough space
+     */
+    bool reserve(const size_t size) {
+      if (mUsed + size <= mSize) { return true; }
+      if (mUsed != 0) { return false; }
+      delete mMemory;
+      mMemory = new AlignedArray<unsigned char>(static_cast<int>(size));
+      mSize = size;
+      return true;
+    }
+
+    size_t size() const {
+      return mSize;
+    }
+
+    /**
+     * Returns count Ts or nullptr if they don't fit, the memory isn't cleared
+     */
+    template <class T>
+    T* take(const size_t count) {
+      const size_t size = bytes<T>(count);
+      if (mUsed + size > mSize) {
+        assert(false);
+        return nullptr;
+      }
+      T* result = reinterpret_cast<T*>(mMemory->data() + mUsed);
+      mUsed += size;
+      return result;
+    }
+
+    /**
+     * Takes count channels with frames each, the usual layout for the DSP code
+     */
+    template <class T>
+    T** takeChannels(const size_t count, const size_t frames) {
+      if (mUsed + channelBytes<T>(count, frames) > mSize) {
+        assert(false);
+        return nullptr;
+      }
+      T** channels = take<T*>(count);
+      for (size_t c = 0; c < count; c++) {
+        channels[c] = take<T>(frames);
+      }
+      return channels;
+    }
+
+    /**
+     * Gives back everything taken since the frame was created once it goes out of scope
+     */
+    class Frame {
+      ScratchArena& mArena;
+      const size_t mUsed;
+    public:
+      explicit Frame(ScratchArena& arena) : mArena(arena), mUsed(arena.mUsed) { }
+      ~Frame() { mArena.mUsed = mUsed; }
+      GUITARD_NO_COPY(Frame)
+    };
+
+    /**
+     * Binds the arena to the current thread while in scope
+     */
+    class Scope {
+      ScratchArena* mPrevious;
+    public:
+      explicit Scope(ScratchArena& arena) : mPrevious(bound()) { bound() = &arena; }
+      ~Scope() { bound() = mPrevious; }
+      GUITARD_NO_COPY(Scope)
+    };
+
+    /**
+     * The arena bound to this thread, DSP code running outside of a graph gets one for its thread
+     * which grows on first use
+     */
+    static ScratchArena& current() {
+      ScratchArena* arena = bound();
+      if (arena != nullptr) { return *arena; }
+      thread_local ScratchArena fallback;
+      return fallback;
+    }
+  };
+}
@@ -0,0 +1,908 @@
+#pragma once
+/**
+ * Partitioned convolution engine which keeps the impulse response spectra
+ * apart from the processing state. This allows running several IRs
+ * against a single forward transform of the input, e.g. to crossfade them.
+ * Include GConvolver.h instead of this file, so the sample type is set up correctly.
+ */
+
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "./GFirConvolver.h"
+#include "../../thirdparty/convolver/fft.h"
+#include "../../thirdparty/convolver/util.h"
+
+/**
+ * IRs up to this many taps are convolved in the time domain
+ * If the head block size is below it, the first partition of longer IRs will also be done that way.
+ * Run src/headless/fir_benchmark.cpp to measure it for a specific machine
+ */
+#ifndef GUITARD_FIR_CROSSOVER
+  #define GUITARD_FIR_CROSSOVER 256
+#endif
+
+namespace guitard {
+  /**
+   * Partitions computed ahead of time, e.g. for the embedded IRs
+   * Uses the same layout as IRPartitions, so the stride is included
+   */
+  struct PreparedPartitions {
+    size_t blockSize;
+    size_t first;
+    size_t count;
+    size_t stride;
+    const float* re;
+    const float* im;
+  };
+
+  /**
+   * A IRSpectrum computed ahead of time, only usable with the same block sizes and FIR crossover
+   * See src/headless/embed_irs.cpp
+   */
+  struct PreparedSpectrum {
+    size_t headBlock;
+    size_t tailBlock;
+    size_t firCrossover;
+    /** Length without the zeros at the end */
+    size_t length;
+    PreparedPartitions head;
+    PreparedPartitions tail;
+  };
+
+  /**
+   * Frequency domain partitions of a slice of an impulse response
+   * All partitions live in one flat buffer, the stride is rounded up
+   * so every partition stays aligned for the SSE multiply accumulate
+   */
+  struct IRPartitions {
+    typedef fftconvolver::Sample T;
+    size_t blockSize = 0;
+    size_t stride = 0;
+    /** Index of the first partition relative to the start of the IR */
+    size_t first = 0;
+    size_t count = 0;
+    fftconvolver::SampleBuffer re;
+    fftconvolver::SampleBuffer im;
+
+    static size_t strideFor(const size_t blockSize) {
+      return (audiofft::AudioFFT::ComplexSize(blockSize * 2) + 3) & ~size_t(3);
+    }
+
+    /**
+     * Transforms the samples in [begin, end) of the IR
+     * begin has to be a multiple of the block size
+     * Allocates, so never call this from the audio thread
+     */
+    void init(const size_t pBlockSize, const T* ir, const size_t begin, const size_t end) {
+      blockSize = pBlockSize;
+      stride = strideFor(blockSize);
+      first = begin / blockSize;
+      count = end > begin ? (end - begin + blockSize - 1) / blockSize : 0;
+      re.resize(count * stride);
+      im.resize(count * stride);
+      if (count == 0) { return; }
+      audiofft::AudioFFT fft;
+      fft.init(blockSize * 2);
+      fftconvolver::SampleBuffer buffer(blockSize * 2);
+      for (size_t i = 0; i < count; i++) {
+        const size_t offset = begin + i * blockSize;
+        const size_t copy = std::min(blockSize, end - offset);
+        fftconvolver::CopyAndPad(buffer, ir + offset, copy);
+        fft.fft(buffer.data(), re.data() + i * stride, im.data() + i * stride);
+      }
+    }
+
+    /**
+     * Only copies the partitions, they need to have the stride of this block size
+     */
+    void init(const PreparedPartitions& prepared) {
+      blockSize = prepared.blockSize;
+      stride = strideFor(blockSize);
+      first = prepared.first;
+      count = prepared.count;
+      re.resize(count * stride);
+      im.resize(count * stride);
+      for (size_t i = 0; i < count * stride; i++) {
+        re[i] = prepared.re[i];
+        im[i] = prepared.im[i];
+      }
+    }
+
+    const T* getRe(const size_t i) const { return re.data() + i * stride; }
+    const T* getIm(const size_t i) const { return im.data() + i * stride; }
+
+    bool empty() const { return count == 0; }
+  };
+
+  /**
+   * Prepared impulse response for a single channel
+   * The head is done in small blocks without latency, the tail in big blocks
+   * which are delayed by one tail block.
+   * Short IRs or the first head block go to the direct form FIR instead.
+   */
+  struct IRSpectrum {
+    size_t length = 0;
+    FirTaps fir;
+    IRPartitions head;
+    IRPartitions tail;
+
+    /**
+     * @param firCrossover IRs up to this length will only use the FIR
+     * @param firHead Whether the first head block is done by the FIR
+     */
+    IRSpectrum(const fftconvolver::Sample* ir, size_t irLength, const size_t headBlock, const size_t tailBlock,
+      const size_t firCrossover = 0, const bool firHead = false
+    ) {
+      // Ignore zeros at the end of the impulse response because they only waste computation time
+      while (irLength > 0 && std::fabs(ir[irLength - 1]) < 0.000001f) {
+        --irLength;
+      }
+      length = irLength;
+      const size_t firEnd = firLength(irLength, headBlock, firCrossover, firHead);
+      fir.init(ir, firEnd);
+      const size_t headEnd = std::max(firEnd, std::min(irLength, tailBlock));
+      head.init(headBlock, ir, std::min(firEnd, headEnd), headEnd);
+      tail.init(tailBlock, ir, std::max(firEnd, tailBlock), std::max(irLength, tailBlock));
+    }
+
+    /**
+     * Only the FIR taps are taken from the samples, the partitions are copied
+     */
+    IRSpectrum(const fftconvolver::Sample* ir, const PreparedSpectrum& prepared, const bool firHead) {
+      length = prepared.length;
+      fir.init(ir, firLength(length, prepared.headBlock, prepared.firCrossover, firHead));
+      head.init(prepared.head);
+      tail.init(prepared.tail);
+    }
+
+    static size_t firLength(const size_t irLength, const size_t headBlock, const size_t firCrossover, const bool firHead) {
+      if (irLength <= firCrossover) { return irLength; }
+      return firHead ? headBlock : 0;
+    }
+
+    GUITARD_NO_COPY(IRSpectrum)
+  };
+
+  typedef std::shared_ptr<IRSpectrum> IRSpectrumShared;
+
+  /**
+   * The prepared IRs for all paths of a convolver
+   * A mono IR only needs the left to left path, a stereo one left to left and
+   * right to right, a true stereo one uses all four.
+   */
+  struct IRSpectrumSet {
+    IRSpectrumShared paths[ConvPaths::COUNT];
+    PathSet<FirTaps> fir;
+    PathSet<IRPartitions> head;
+    PathSet<IRPartitions> tail;
+
+    void set(const int input, const int output, IRSpectrumShared ir) {
+      const int index = ConvPaths::index(input, output);
+      paths[index] = ir;
+      fir.paths[index] = ir != nullptr ? &ir->fir : nullptr;
+      head.paths[index] = ir != nullptr ? &ir->head : nullptr;
+      tail.paths[index] = ir != nullptr ? &ir->tail : nullptr;
+    }
+
+    /**
+     * Both outputs will be the same if both inputs are
+     */
+    bool isMirrored() const {
+      return paths[ConvPaths::index(0, 0)] == paths[ConvPaths::index(1, 1)]
+        && paths[ConvPaths::index(1, 0)] == paths[ConvPaths::index(0, 1)];
+    }
+
+    GUITARD_NO_COPY(IRSpectrumSet)
+    IRSpectrumSet() = default;
+  };
+
+  typedef std::shared_ptr<IRSpectrumSet> IRSpectrumSetShared;
+
+  /**
+   * Uniformly partitioned convolution which does the multiply accumulate against
+   * up to MAX_IRS sets of IR partitions, each with its own gain.
+   * The gains only change on block boundaries, so fading between two IRs is
+   * a interpolation of their spectra and the input is only transformed once.
+   * Every input is transformed once and its spectra are used by all paths starting there,
+   * the paths ending at an output are summed up before the backward transform.
+   * An immediate stage also transforms partially filled blocks to get zero latency,
+   * a delayed stage only works on full blocks and outputs them one block later.
+   */
+  class SpectralStage {
+  public:
+    static const int MAX_IRS = 2;
+  private:
+    static const int CHANNELS = ConvPaths::CHANNELS;
+    typedef fftconvolver::Sample T;
+    typedef fftconvolver::SampleBuffer Buffer;
+    size_t mBlockSize = 0;
+    size_t mStride = 0;
+    bool mImmediate = true;
+    /** How many input spectra the history can hold */
+    size_t mCapacity = 0;
+    audiofft::AudioFFT mFFT;
+    Buffer mFFTBuffer;
+    Buffer mInput[CHANNELS];
+    Buffer mOverlap[CHANNELS];
+    Buffer mOutput[CHANNELS]; // Only used when delayed
+    Buffer mHistoryRe[CHANNELS], mHistoryIm[CHANNELS];
+    Buffer mPreRe[MAX_IRS][CHANNELS], mPreIm[MAX_IRS][CHANNELS];
+    Buffer mConvRe, mConvIm;
+    Buffer mFadeRe, mFadeIm;
+    size_t mCurrent = 0;
+    size_t mInputFill = 0;
+
+    PathSet<IRPartitions> mIRs[MAX_IRS];
+    T mGains[MAX_IRS] = { 1, 0 };
+    size_t mFadeLength = 0;
+    size_t mFadePos = 0;
+    bool mFading = false;
+    /** Set when there was nothing to process, means the history is out of date */
+    bool mIdle = false;
+    /** Both inputs use the first history when they are the same */
+    bool mSharedInput = true;
+    /** How many outputs were computed in the last call */
+    int mOutputs = 1;
+
+  public:
+    /**
+     * Input history which can be allocated outside of the audio thread and handed over with adopt()
+     */
+    struct History {
+      size_t capacity = 0;
+      Buffer re[CHANNELS], im[CHANNELS];
+
+      void allocate(const size_t partitions, const size_t stride) {
+        capacity = partitions;
+        for (int c = 0; c < CHANNELS; c++) {
+          re[c].resize(partitions * stride);
+          im[c].resize(partitions * stride);
+        }
+      }
+
+      /**
+       * Keeps the bigger of the two histories, the other one ends up in other
+       */
+      void takeLarger(History& other) {
+        if (other.capacity <= capacity) { return; }
+        for (int c = 0; c < CHANNELS; c++) {
+          Buffer::Swap(re[c], other.re[c]);
+          Buffer::Swap(im[c], other.im[c]);
+        }
+        std::swap(capacity, other.capacity);
+      }
+    };
+
+    SpectralStage() = default;
+    GUITARD_NO_COPY(SpectralStage)
+
+    void init(const size_t blockSize, const bool immediate, const size_t capacity) {
+      mBlockSize = blockSize;
+      mImmediate = immediate;
+      mStride = IRPartitions::strideFor(blockSize);
+      mFFT.init(blockSize * 2);
+      mFFTBuffer.resize(blockSize * 2);
+      for (int c = 0; c < CHANNELS; c++) {
+        mInput[c].resize(blockSize);
+        mOverlap[c].resize(blockSize);
+        mOutput[c].resize(immediate ? 0 : blockSize);
+        for (int i = 0; i < MAX_IRS; i++) {
+          mPreRe[i][c].resize(mStride);
+          mPreIm[i][c].resize(mStride);
+        }
+      }
+      mConvRe.resize(mStride);
+      mConvIm.resize(mStride);
+      mFadeRe.resize(mStride);
+      mFadeIm.resize(mStride);
+      mCapacity = 0;
+      reserve(std::max(capacity, size_t(1)));
+      mCurrent = 0;
+      mInputFill = 0;
+    }
+
+    /**
+     * Grows the input history so IRs with that many partitions can be used
+     * Keeps the history intact, but allocates
+     */
+    void reserve(const size_t partitions) {
+      if (partitions <= mCapacity) { return; }
+      History history;
+      history.allocate(partitions, mStride);
+      adopt(history);
+    }
+
+    /**
+     * Switches to a bigger history and copies over the spectra of the current one
+     * Realtime safe, the old buffers are left in history so they can be freed elsewhere
+     */
+    void adopt(History& history) {
+      if (history.capacity <= mCapacity) { return; }
+      for (int c = 0; c < CHANNELS; c++) {
+        for (size_t i = 0; i < mCapacity; i++) { // Newest spectrum ends up at index 0
+          const size_t from = ((mCurrent + i) % mCapacity) * mStride;
+          ::memcpy(history.re[c].data() + i * mStride, mHistoryRe[c].data() + from, mStride * sizeof(T));
+          ::memcpy(history.im[c].data() + i * mStride, mHistoryIm[c].data() + from, mStride * sizeof(T));
+        }
+        Buffer::Swap(history.re[c], mHistoryRe[c]);
+        Buffer::Swap(history.im[c], mHistoryIm[c]);
+      }
+      std::swap(history.capacity, mCapacity);
+      mCurrent = 0;
+    }
+
+    size_t getStride() const {
+      return mStride;
+    }
+
+    size_t getCapacity() const {
+      return mCapacity;
+    }
+
+    /**
+     * How many partitions of the history are needed for the IR
+     */
+    size_t partitionsNeeded(const IRPartitions& ir) const {
+      if (ir.count == 0) { return 0; }
+      return mImmediate ? ir.first + ir.count : ir.first + ir.count - 1;
+    }
+
+    void reset() {
+      for (int c = 0; c < CHANNELS; c++) {
+        mHistoryRe[c].setZero();
+        mHistoryIm[c].setZero();
+        mInput[c].setZero();
+        mOverlap[c].setZero();
+        mOutput[c].setZero();
+      }
+      mInputFill = 0;
+    }
+
+    /**
+     * Sets the IR right away without fading
+     */
+    void setIR(const PathSet<IRPartitions>& ir) {
+      wake();
+      mIRs[0] = ir;
+      mIRs[1] = PathSet<IRPartitions>();
+      mGains[0] = 1;
+      mGains[1] = 0;
+      mFading = false;
+    }
+
+    /**
+     * Fades from the current IR to the provided one over the given amount of samples
+     * The stage will keep both IRs around until the fade is done
+     * Either of them may be empty to fade from or to silence
+     */
+    void fadeTo(const PathSet<IRPartitions>& ir, const size_t samples) {
+      if (samples == 0 || (mIRs[0].empty() && ir.empty())) {
+        setIR(ir);
+        return;
+      }
+      wake();
+      mIRs[1] = ir;
+      mFadeLength = samples;
+      mFadePos = 0;
+      mFading = true;
+    }
+
+    bool isFading() const {
+      return mFading;
+    }
+
+    /**
+     * Adds the result to the outputs
+     * @param inputs 1 if both inputs are the same, only the first one will be read then
+     * @param outputs How many outputs to compute
+     */
+    void process(const T* const* input, T* const* output, const size_t len, const int inputs, const int outputs) {
+      if (!mFading && mIRs[0].empty()) {
+        mIdle = true; // Nothing to do until there are partitions
+        return;
+      }
+      shareInput(inputs == 1);
+      addOutputs(outputs);
+      if (mImmediate) {
+        processImmediate(input, output, len, inputs, outputs);
+      }
+      else {
+        processDelayed(input, output, len, inputs, outputs);
+      }
+    }
+
+  private:
+    /**
+     * The history of a stage which didn't do anything needs to be cleared before it's used again
+     */
+    void wake() {
+      if (mIdle) {
+        reset();
+        mIdle = false;
+      }
+    }
+
+    /**
+     * The second input wasn't transformed while the inputs were the same, so it gets a copy of the first one
+     */
+    void shareInput(const bool shared) {
+      if (!shared && mSharedInput) {
+        mInput[1].copyFrom(mInput[0]);
+        mHistoryRe[1].copyFrom(mHistoryRe[0]);
+        mHistoryIm[1].copyFrom(mHistoryIm[0]);
+      }
+      mSharedInput = shared;
+    }
+
+    /**
+     * The second output only gets computed when it's different from the first one
+     * so it starts off with the state of the first output
+     */
+    void addOutputs(const int outputs) {
+      if (outputs > mOutputs) {
+        mOverlap[1].copyFrom(mOverlap[0]);
+        mOutput[1].copyFrom(mOutput[0]);
+        for (int i = 0; i < MAX_IRS; i++) {
+          mPreRe[i][1].copyFrom(mPreRe[i][0]);
+          mPreIm[i][1].copyFrom(mPreIm[i][0]);
+        }
+      }
+      mOutputs = outputs;
+    }
+
+    T* historyRe(const int input, const size_t age) {
+      return mHistoryRe[mSharedInput ? 0 : input].data() + ((mCurrent + age) % mCapacity) * mStride;
+    }
+
+    T* historyIm(const int input, const size_t age) {
+      return mHistoryIm[mSharedInput ? 0 : input].data() + ((mCurrent + age) % mCapacity) * mStride;
+    }
+
+    /**
+     * Called at the start of each block, moves the fade forward
+     */
+    void updateGains() {
+      if (!mFading) { return; }
+      if (mFadePos >= mFadeLength) { // The last block was done with the new IR only
+        mIRs[0] = mIRs[1];
+        mIRs[1] = PathSet<IRPartitions>();
+        mGains[0] = 1;
+        mGains[1] = 0;
+        mFading = false;
+        return;
+      }
+      mFadePos = std::min(mFadeLength, mFadePos + mBlockSize);
+      mGains[1] = static_cast<T>(mFadePos) / static_cast<T>(mFadeLength);
+      mGains[0] = 1 - mGains[1];
+    }
+
+    /**
+     * Multiply accumulates the partitions [start, end) of all paths ending at the output
+     * Partition p of a IR goes with the input spectrum from first + p blocks ago,
+     * a delayed stage computes the next block so it's one less.
+     */
+    void accumulate(const PathSet<IRPartitions>& set, const int output, const size_t start, size_t end, T* re, T* im) {
+      for (int input = 0; input < CHANNELS; input++) {
+        const IRPartitions* ir = set.get(input, output);
+        if (ir == nullptr || ir->empty()) { continue; }
+        size_t age = ir->first + start - (mImmediate ? 0 : 1);
+        const size_t last = std::min(end, ir->count);
+        for (size_t i = start; i < last; i++, age++) {
+          fftconvolver::ComplexMultiplyAccumulate(
+            re, im, historyRe(input, age), historyIm(input, age), ir->getRe(i), ir->getIm(i), mStride
+          );
+        }
+      }
+    }
+
+    /**
+     * Mixes the accumulated spectra of both IRs according to their gains
+     */
+    void mix(T* re, T* im, const T* reB, const T* imB) const {
+      const T a = mGains[0], b = mGains[1];
+      for (size_t i = 0; i < mStride; i++) {
+        re[i] = re[i] * a + reB[i] * b;
+        im[i] = im[i] * a + imB[i] * b;
+      }
+    }
+
+    void processImmediate(const T* const* input, T* const* output, const size_t len, const int inputs, const int outputs) {
+      const size_t all = std::numeric_limits<size_t>::max();
+      size_t processed = 0;
+      while (processed < len) {
+        const bool inputBufferWasEmpty = mInputFill == 0;
+        const size_t processing = std::min(len - processed, mBlockSize - mInputFill);
+        const size_t inputBufferPos = mInputFill;
+        const bool blockDone = inputBufferPos + processing == mBlockSize;
+
+        // Forward FFT
+        for (int i = 0; i < inputs; i++) {
+          ::memcpy(mInput[i].data() + inputBufferPos, input[i] + processed, processing * sizeof(T));
+          fftconvolver::CopyAndPad(mFFTBuffer, mInput[i].data(), mBlockSize);
+          mFFT.fft(mFFTBuffer.data(), historyRe(i, 0), historyIm(i, 0));
+        }
+
+        // The partitions which only depend on previous blocks are done once per block
+        if (inputBufferWasEmpty) {
+          updateGains();
+          for (int s = 0; s < MAX_IRS; s++) {
+            for (int o = 0; o < outputs; o++) {
+              mPreRe[s][o].setZero();
+              mPreIm[s][o].setZero();
+              accumulate(mIRs[s], o, 1, all, mPreRe[s][o].data(), mPreIm[s][o].data());
+            }
+          }
+        }
+
+        for (int o = 0; o < outputs; o++) {
+          // Complex multiplication of the current block
+          mConvRe.copyFrom(mPreRe[0][o]);
+          mConvIm.copyFrom(mPreIm[0][o]);
+          accumulate(mIRs[0], o, 0, 1, mConvRe.data(), mConvIm.data());
+          if (mFading) {
+            mFadeRe.copyFrom(mPreRe[1][o]);
+            mFadeIm.copyFrom(mPreIm[1][o]);
+            accumulate(mIRs[1], o, 0, 1, mFadeRe.data(), mFadeIm.data());
+            mix(mConvRe.data(), mConvIm.data(), mFadeRe.data(), mFadeIm.data());
+          }
+
+          // Backward FFT
+          mFFT.ifft(mFFTBuffer.data(), mConvRe.data(), mConvIm.data());
+
+          // Add overlap
+          T* out = output[o] + processed;
+          const T* overlap = mOverlap[o].data() + inputBufferPos;
+          for (size_t i = 0; i < processing; i++) {
+            out[i] += mFFTBuffer[inputBufferPos + i] + overlap[i];
+          }
+          if (blockDone) {
+            ::memcpy(mOverlap[o].data(), mFFTBuffer.data() + mBlockSize, mBlockSize * sizeof(T));
+          }
+        }
+
+        mInputFill += processing;
+        if (blockDone) { // Input buffer full => Next block
+          for (int i = 0; i < inputs; i++) {
+            mInput[i].setZero();
+          }
+          mInputFill = 0;
+          mCurrent = (mCurrent > 0) ? (mCurrent - 1) : (mCapacity - 1);
+        }
+        processed += processing;
+      }
+    }
+
+    void processDelayed(const T* const* input, T* const* output, const size_t len, const int inputs, const int outputs) {
+      const size_t all = std::numeric_limits<size_t>::max();
+      size_t processed = 0;
+      while (processed < len) {
+        const size_t processing = std::min(len - processed, mBlockSize - mInputFill);
+        for (int i = 0; i < inputs; i++) {
+          ::memcpy(mInput[i].data() + mInputFill, input[i] + processed, processing * sizeof(T));
+        }
+        for (int o = 0; o < outputs; o++) { // Output computed one block earlier
+          T* out = output[o] + processed;
+          const T* delayed = mOutput[o].data() + mInputFill;
+          for (size_t i = 0; i < processing; i++) {
+            out[i] += delayed[i];
+          }
+        }
+        mInputFill += processing;
+        processed += processing;
+        if (mInputFill < mBlockSize) { continue; }
+        mInputFill = 0;
+
+        for (int i = 0; i < inputs; i++) {
+          fftconvolver::CopyAndPad(mFFTBuffer, mInput[i].data(), mBlockSize);
+          mFFT.fft(mFFTBuffer.data(), historyRe(i, 0), historyIm(i, 0));
+        }
+
+        updateGains();
+        for (int o = 0; o < outputs; o++) {
+          mConvRe.setZero();
+          mConvIm.setZero();
+          accumulate(mIRs[0], o, 0, all, mConvRe.data(), mConvIm.data());
+          if (mFading) {
+            mFadeRe.setZero();
+            mFadeIm.setZero();
+            accumulate(mIRs[1], o, 0, all, mFadeRe.data(), mFadeIm.data());
+            mix(mConvRe.data(), mConvIm.data(), mFadeRe.data(), mFadeIm.data());
+          }
+
+          mFFT.ifft(mFFTBuffer.data(), mConvRe.data(), mConvIm.data());
+          fftconvolver::Sum(mOutput[o].data(), mFFTBuffer.data(), mOverlap[o].data(), mBlockSize);
+          ::memcpy(mOverlap[o].data(), mFFTBuffer.data() + mBlockSize, mBlockSize * sizeof(T));
+        }
+        mCurrent = (mCurrent > 0) ? (mCurrent - 1) : (mCapacity - 1);
+      }
+    }
+  };
+
+  /**
+   * Convolver made of a zero latency head stage and a delayed tail stage
+   * Can crossfade to a new IR while only doing a single forward and backward transform
+   * per channel and block. IRs which arrive while a fade is going on will be queued up and the
+   * most recent one will be faded to next.
+   * If the head block is short enough the first block is done by a FIR, so the head stage can be
+   * delayed by one block as well and won't need to do a transform for each call.
+   * New IRs are handed over as an Update, which is allocated by the loading thread
+   * so the audio thread only has to swap pointers.
+   * Handles up to two inputs and outputs, see IRSpectrumSet for the paths between them.
+   * Identical inputs are only transformed once and identical outputs only computed once.
+   */
+  class SpectralConvolver {
+    typedef fftconvolver::Sample T;
+  public:
+    /**
+     * Everything needed to switch to a new IR without allocating or freeing anything
+     * After apply() it holds the replaced buffers and IRs, so free it outside of the audio thread
+     */
+    struct Update {
+      /** Current, next and pending IR from a reset plus the ones retired by fades */
+      static const int MAX_RETIRED = 5;
+      IRSpectrumSetShared ir;
+      /** Fade length in samples, 0 switches right away and clears the state */
+      size_t crossfade = 0;
+      FirStage::History fir;
+      SpectralStage::History head;
+      SpectralStage::History tail;
+      IRSpectrumSetShared retired[MAX_RETIRED];
+
+      /**
+       * Takes over the histories of an update which was never applied
+       * since the sizes the loading side reserved depend on them
+       */
+      void inherit(Update& older) {
+        fir.takeLarger(older.fir);
+        head.takeLarger(older.head);
+        tail.takeLarger(older.tail);
+      }
+
+      void retire(IRSpectrumSetShared& ir) {
+        if (ir == nullptr) { return; }
+        for (int i = 0; i < MAX_RETIRED; i++) {
+          if (retired[i] == nullptr) {
+            retired[i] = std::move(ir);
+            return;
+          }
+        }
+      }
+    };
+
+  private:
+    size_t mHeadBlockSize = 0;
+    size_t mTailBlockSize = 0;
+    size_t mFirCrossover = 0;
+    bool mFirHead = false;
+    FirStage mFir;
+    SpectralStage mHead;
+    SpectralStage mTail;
+    IRSpectrumSetShared mCurrent;
+    IRSpectrumSetShared mNext;
+    IRSpectrumSetShared mPending;
+    /**
+     * IRs which aren't used anymore, the audio thread can't free them
+     * so they'll be moved to the next update which gets applied
+     */
+    IRSpectrumSetShared mRetired[2];
+    size_t mFadeLength = 0;
+
+    /** History sizes the updates handed out so far will result in, only used by the loading side */
+    size_t mReservedFir = 0;
+    size_t mReservedHead = 0;
+    size_t mReservedTail = 0;
+
+  public:
+    SpectralConvolver() = default;
+    GUITARD_NO_COPY(SpectralConvolver)
+
+    void init(const size_t headBlockSize, const size_t tailBlockSize, const size_t firCrossover = GUITARD_FIR_CROSSOVER) {
+      mHeadBlockSize = fftconvolver::NextPowerOf2(headBlockSize);
+      mTailBlockSize = fftconvolver::NextPowerOf2(std::max(tailBlockSize, mHeadBlockSize));
+      mFirCrossover = firCrossover;
+      mFirHead = mHeadBlockSize <= mFirCrossover;
+      mFir.reserve(mFirHead ? mHeadBlockSize : 0);
+      mHead.init(mHeadBlockSize, !mFirHead, mTailBlockSize / mHeadBlockSize);
+      mTail.init(mTailBlockSize, false, 0);
+      mReservedFir = mFir.getCapacity();
+      mReservedHead = mHead.getCapacity();
+      mReservedTail = mTail.getCapacity();
+    }
+
+    /**
+     * Creates the spectrum for a IR matching the block sizes of this convolver
+     * This is where the expensive work happens, so do it outside of the audio thread
+     */
+    IRSpectrumShared prepare(const T* ir, const size_t length) const {
+      return std::make_shared<IRSpectrum>(ir, length, mHeadBlockSize, mTailBlockSize, mFirCrossover, mFirHead);
+    }
+
+    /**
+     * Uses the precomputed spectrum if it was made for the settings of this convolver
+     * and does the work otherwise
+     */
+    IRSpectrumShared prepare(const T* ir, const size_t length, const PreparedSpectrum* prepared) const {
+      if (prepared == nullptr || prepared->length > length
+        || prepared->headBlock != mHeadBlockSize || prepared->tailBlock != mTailBlockSize
+        || prepared->firCrossover != mFirCrossover
+        || prepared->head.stride != IRPartitions::strideFor(mHeadBlockSize)
+        || prepared->tail.stride != IRPartitions::strideFor(mTailBlockSize)
+      ) {
+        return prepare(ir, length);
+      }
+      return std::make_shared<IRSpectrum>(ir, *prepared, mFirHead);
+    }
+
+    /**
+     * Fills in the update and allocates bigger histories if the IR needs them
+     * Only one thread at a time may prepare updates and never the audio thread
+     */
+    void prepareUpdate(Update& update, IRSpectrumSetShared ir, const size_t crossfade) {
+      update.ir = ir;
+      update.crossfade = crossfade;
+      size_t fir = 0, head = 0, tail = 0;
+      for (auto& path : ir->paths) {
+        if (path == nullptr) { continue; }
+        fir = std::max(fir, path->fir.length);
+        head = std::max(head, mHead.partitionsNeeded(path->head));
+        tail = std::max(tail, mTail.partitionsNeeded(path->tail));
+      }
+      if (fir > mReservedFir) {
+        update.fir.allocate(fir);
+        mReservedFir = fir;
+      }
+      if (head > mReservedHead) {
+        update.head.allocate(head, mHead.getStride());
+        mReservedHead = head;
+      }
+      if (tail > mReservedTail) {
+        update.tail.allocate(tail, mTail.getStride());
+        mReservedTail = tail;
+      }
+    }
+
+    /**
+     * Switches or starts fading to the IR of the update
+     * Realtime safe, call it between two blocks
+     */
+    void apply(Update& update) {
+      mFir.adopt(update.fir);
+      mHead.adopt(update.head);
+      mTail.adopt(update.tail);
+      for (auto& retired : mRetired) {
+        update.retire(retired);
+      }
+      mFadeLength = update.crossfade;
+      if (update.crossfade == 0 || mCurrent == nullptr) {
+        update.retire(mCurrent);
+        update.retire(mNext);
+        update.retire(mPending);
+        mCurrent = update.ir;
+        mFir.setIR(mCurrent->fir);
+        mHead.setIR(mCurrent->head);
+        mTail.setIR(mCurrent->tail);
+        mFir.reset();
+        mHead.reset();
+        mTail.reset();
+      }
+      else if (mNext == nullptr) {
+        startFade(update.ir);
+      }
+      else {
+        update.retire(mPending);
+        mPending = update.ir; // Will be picked up once the running fade is done
+      }
+    }
+
+    /**
+     * Swaps the IR without fading, also clears the convolution state
+     * Not realtime safe
+     */
+    void setIR(IRSpectrumSetShared ir) {
+      crossfadeTo(ir, 0);
+    }
+
+    /**
+     * Sets a mono IR, only the first input and output will be used
+     * Not realtime safe
+     */
+    void setIR(IRSpectrumShared ir) {
+      setIR(makeMono(ir));
+    }
+
+    /**
+     * Fades to the IR over the provided amount of samples
+     * Not realtime safe since the replaced IRs are freed right away
+     */
+    void crossfadeTo(IRSpectrumSetShared ir, const size_t samples) {
+      Update update;
+      prepareUpdate(update, ir, samples);
+      apply(update);
+    }
+
+    void crossfadeTo(IRSpectrumShared ir, const size_t samples) {
+      crossfadeTo(makeMono(ir), samples);
+    }
+
+    /**
+     * Mono convolution using the first path
+     * Input and output can't be the same buffer
+     */
+    void process(const T* input, T* output, const size_t len) {
+      process(&input, &output, len, 1, 1);
+    }
+
+    /**
+     * False while the current IR or the one it fades to is different for the two sides
+     */
+    bool isMirrored() const {
+      return (mCurrent == nullptr || mCurrent->isMirrored()) && (mNext == nullptr || mNext->isMirrored());
+    }
+
+    /**
+     * How many of the most recent input samples the stages still depend on
+     * Inputs have to be the same for at least that long before they can share the history,
+     * otherwise the older part of the second one is lost. Grows when longer IRs get applied
+     */
+    size_t getHistoryLength() const {
+      // One more block for the input which is still waiting to be transformed
+      const size_t head = (mHead.getCapacity() + 1) * mHeadBlockSize;
+      const size_t tail = (mTail.getCapacity() + 1) * mTailBlockSize;
+      return std::max(mFir.getCapacity(), std::max(head, tail));
+    }
+
+    /**
+     * Input and output buffers can't be the same
+     * @param inputs 1 if both inputs have been the same for getHistoryLength() samples, only the first one will be read then
+     * @param outputs How many outputs to compute
+     */
+    void process(const T* const* input, T* const* output, const size_t len, const int inputs, const int outputs) {
+      for (int o = 0; o < outputs; o++) {
+        ::memset(output[o], 0, len * sizeof(T));
+      }
+      if (mCurrent == nullptr) { return; }
+      // With a single input the outputs of a mirrored IR are the same
+      const bool mirrored = inputs == 1 && mCurrent->isMirrored() && (mNext == nullptr || mNext->isMirrored());
+      const int computed = mirrored ? 1 : outputs;
+      mHead.process(input, output, len, inputs, computed);
+      mFir.process(input, output, len, inputs, computed);
+      mTail.process(input, output, len, inputs, computed);
+      if (computed < outputs) {
+        ::memcpy(output[1], output[0], len * sizeof(T));
+      }
+
+      if (mNext != nullptr && !mHead.isFading() && !mTail.isFading() && !mFir.isFading()) {
+        // Fade is over, keep the old IR around until it can be freed outside of the audio thread
+        mRetired[mRetired[0] == nullptr ? 0 : 1] = std::move(mCurrent);
+        mCurrent = std::move(mNext);
+        mNext = nullptr;
+        if (mPending != nullptr) {
+          IRSpectrumSetShared pending = std::move(mPending);
+          mPending = nullptr;
+          startFade(pending);
+        }
+      }
+    }
+
+    bool isFading() const {
+      return mNext != nullptr;
+    }
+
+  private:
+    static IRSpectrumSetShared makeMono(IRSpectrumShared ir) {
+      IRSpectrumSetShared set = std::make_shared<IRSpectrumSet>();
+      set->set(0, 0, ir);
+      return set;
+    }
+
+    void startFade(IRSpectrumSetShared ir) {
+      mNext = ir;
+      // Short IRs don't have a tail or head, so those stages fade from or to silence
+      mFir.fadeTo(mNext->fir, mFadeLength);
+      mHead.fadeTo(mNext->head, mFadeLength);
+      mTail.fadeTo(mNext->tail, mFadeLength);
+    }
+  };
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "./GTypes.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace guitard {
+  /**
+   * Nonlinearities for the AdaaWaveshaper
+   * Each one needs the function itself f, its antiderivative F1 and the antiderivative of that F2
+   * All of them are zero at zero, so a silent waveshaper doesn't have to remember anything
+   */
+  namespace shapes {
+    const double Ln2 = 0.69314718055994530942;
+    const double Pi = 3.14159265358979323846;
+
+    /**
+     * Dilogarithm Li2(y) for y in [-1, 0] using the series in u = -log(1 - y) with the Bernoulli numbers,
+     * |u| stays below log(2) so a few terms are enough for double precision
+     */
+    inline double dilog(const double y) {
+      const double u = -std::log1p(-y);
+      const double u2 = u * u;
+      return u * (1 + u * (-0.25 + u * (1.0 / 36 + u2 * (-1.0 / 3600 + u2 * (1.0 / 211680
+        + u2 * (-1.0 / 10886400 + u2 * (1.0 / 526901760 + u2 * -4.0647616451442255e-11)))))));
+    }
+
+    struct Tanh {
+      double f(const double x) const {
+        return std::tanh(x);
+      }
+
+      /**
+       * log(cosh(x)) without overflowing for large x
+       */
+      double F1(const double x) const {
+        const double a = std::abs(x);
+        return a + std::log1p(std::exp(-2 * a)) - Ln2;
+      }
+
+      double F2(const double x) const {
+        const double a = std::abs(x);
+        const double result = 0.5 * a * a - a * Ln2 + 0.5 * dilog(-std::exp(-2 * a)) + Pi * Pi / 24;
+        return x < 0 ? -result : result;
+      }
+    };
+
+    /**
+     * Hard clips at -low and high, symmetric if both are the same
+     */
+    struct Clip {
+      double low = 1;
+      double high = 1;
+
+      double f(const double x) const {
+        return std::min(std::max(x, -low), high);
+      }
+
+      double F1(const double x) const {
+        if (x > high) { return high * x - 0.5 * high * high; }
+        if (x < -low) { return -low * x - 0.5 * low * low; }
+        return 0.5 * x * x;
+      }
+
+      double F2(const double x) const {
+        if (x > high) { return 0.5 * high * x * x - 0.5 * high * high * x + high * high * high / 6; }
+        if (x < -low) { return -0.5 * low * x * x - 0.5 * low * low * x - low * low * low / 6; }
+        return x * x * x / 6;
+      }
+    };
+
+    /**
+     * Different gains for the positive and negative half, down = -1 is a full wave rectifier
+     */
+    struct Rectify {
+      double up = 1;
+      double down = -1;
+
+      double f(const double x) const {
+        return x * (x > 0 ? up : down);
+      }
+
+      double F1(const double x) const {
+        return 0.5 * x * x * (x > 0 ? up : down);
+      }
+
+      double F2(const double x) const {
+        return x * x * x / 6 * (x > 0 ? up : down);
+      }
+    };
+  }
+
+  /**
+   * Waveshaper with antiderivative anti-aliasing for a single channel
+   * Instead of the shape itself the difference of its antiderivative over the last samples gets used,
+   * which is like integrating the output of the shape over a sample and filters out most of the aliasing
+   * without any oversampling. First order uses F1 and adds half a sample of delay,
+   * second order uses F2 and adds a full sample. Order 0 is the plain shape.
+   */
+  template <class Shape>
+  class AdaaWaveshaper {
+    /**
+     * Below this difference between the samples the division gets unstable,
+     * the shape is evaluated in the middle instead
+     */
+    static constexpr double Tolerance = 1e-5;
+
+    Shape mShape;
+    int mOrder = 1;
+    double mX1 = 0;
+    double mX2 = 0;
+    double mF1 = 0; // F1 of mX1
+    double mF2 = 0; // F2 of mX1
+    double mD1 = 0; // Last difference quotient of F2 for the second order
+
+    double differenceF2(const double x, const double x1, const double f2, const double f21) const {
+      const double dx = x - x1;
+      if (std::abs(dx) < Tolerance) { return mShape.F1(0.5 * (x + x1)); }
+      return (f2 - f21) / dx;
+    }
+
+    double first(const double x) {
+      const double f1 = mShape.F1(x);
+      const double dx = x - mX1;
+      const double y = std::abs(dx) < Tolerance ? mShape.f(0.5 * (x + mX1)) : (f1 - mF1) / dx;
+      mX1 = x;
+      mF1 = f1;
+      return y;
+    }
+
+    double second(const double x) {
+      const double f2 = mShape.F2(x);
+      const double d = differenceF2(x, mX1, f2, mF2);
+      const double dx = x - mX2;
+      double y;
+      if (std::abs(dx) < Tolerance) {
+        const double xBar = 0.5 * (x + mX2);
+        const double delta = xBar - mX1;
+        if (std::abs(delta) < Tolerance) {
+          y = mShape.f(0.5 * (xBar + mX1));
+        }
+        else {
+          y = 2 / delta * (mShape.F1(xBar) + (mF2 - mShape.F2(xBar)) / delta);
+        }
+      }
+      else {
+        y = 2 * (d - mD1) / dx;
+      }
+      mX2 = mX1;
+      mX1 = x;
+      mF2 = f2;
+      mD1 = d;
+      return y;
+    }
+
+  public:
+    /**
+     * Call refresh() after changing the shape
+     */
+    Shape& shape() {
+      return mShape;
+    }
+
+    /**
+     * The remembered antiderivatives have to match the shape, otherwise the next sample clicks
+     */
+    void refresh() {
+      mF1 = mShape.F1(mX1);
+      mF2 = mShape.F2(mX1);
+      mD1 = differenceF2(mX1, mX2, mF2, mShape.F2(mX2));
+    }
+
+    void setOrder(const int order) {
+      const int o = std::max(0, std::min(2, order));
+      if (o != mOrder) {
+        mOrder = o;
+        refresh();
+      }
+    }
+
+    int getOrder() const {
+      return mOrder;
+    }
+
+    /**
+     * Delay in samples the anti-aliasing adds
+     */
+    double getDelay() const {
+      return 0.5 * mOrder;
+    }
+
+    void reset() {
+      mX1 = mX2 = 0;
+      refresh();
+    }
+
+    double process(const double x) {
+      if (mOrder == 1) { return first(x); }
+      if (mOrder == 2) { return second(x); }
+      mX2 = mX1;
+      mX1 = x;
+      return mShape.f(x);
+    }
+
+    /**
+     * Shapes a whole block, the gain ramps from gainStart to gainEnd before the shape
+     */
+    void process(const sample* in, sample* out, const int frames, const double gainStart = 1, const double gainEnd = 1) {
+      const double step = frames > 0 ? (gainEnd - gainStart) / frames : 0;
+      double gain = gainStart;
+      if (mOrder == 1) {
+        for (int i = 0; i < frames; i++, gain += step) { out[i] = static_cast<sample>(first(in[i] * gain)); }
+      }
+      else if (mOrder == 2) {
+        for (int i = 0; i < frames; i++, gain += step) { out[i] = static_cast<sample>(second(in[i] * gain)); }
+      }
+      else {
+        for (int i = 0; i < frames; i++, gain += step) { out[i] = static_cast<sample>(mShape.f(in[i] * gain)); }
+        if (frames > 1) { mX2 = in[frames - 2] * (gain - 2 * step); }
+        if (frames > 0) { mX1 = in[frames - 1] * (gain - step); }
+      }
+    }
+  };
+}
@@ -253,10 +253,12 @@ namespace guitard {
       });
 
       mNodeAddEvent.subscribe(mBus, MessageBus::NodeAdd, [&](const NodeList::NodeInfo& info) {
-        MessageBus::fireEvent(mBus, MessageBus::PushUndoState, false);
         Node* node = NodeList::createNode(info.name);
-        mGraph->addNode(node, { 300, 300 });
-        setUpNodeUi(node);
+        if (node != nullptr) {
+          MessageBus::fireEvent(mBus, MessageBus::PushUndoState, false);
+          mGraph->addNode(node, { 300, 300 });
+          setUpNodeUi(node);
+        }
       });
 
       mNodeDelSub.subscribe(mBus, MessageBus::NodeDeleted, [&](Node* param) {
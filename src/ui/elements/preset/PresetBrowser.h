@@ -10,6 +10,8 @@ namespace guitard {
   class PresetBrowser : public ScrollViewControl, public ScrollViewChild {
     MessageBus::Bus* mBus = nullptr;
     soundwoofer::SWPresets mPresets;
+    /** putPresets() creates controls, so the callback is called on the UI thread */
+    soundwoofer::async::CallbackQueueShared mCallbackQueue = std::make_shared<soundwoofer::async::CallbackQueue>();
     soundwoofer::async::Callback mCallback =
       std::make_shared<soundwoofer::async::CallbackFunc>(
       [&](soundwoofer::Status s) {
@@ -53,7 +55,14 @@ namespace guitard {
     void refresh() {
       //soundwoofer::preset::list();
       //putPresets();
-      soundwoofer::async::preset::list(mCallback);
+      soundwoofer::async::preset::list(mCallback, soundwoofer::async::Options(
+        soundwoofer::async::PRIORITY_LOW, nullptr, mCallbackQueue
+      ));
+    }
+
+    bool IsDirty() override {
+      mCallbackQueue->dispatch(); // Called on every frame
+      return ScrollViewControl::IsDirty();
     }
 
     void onScrollOutView() override {
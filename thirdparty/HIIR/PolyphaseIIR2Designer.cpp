@@ -31,7 +31,7 @@ http://sam.zoy.org/wtfpl/COPYING for more details.
 
 #include "./def.h"
 #include "./fnc.h"
-#include "./PolyphaseIir2Designer.h"
+#include "./PolyphaseIIR2Designer.h"
 
 #include <cassert>
 #include <cmath>
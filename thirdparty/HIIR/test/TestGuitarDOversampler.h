@@ -0,0 +1,97 @@
+/*****************************************************************************
+
+        TestGuitarDOversampler.h
+
+Speed test of the GuitarD wrapper around the hiir classes
+(src/types/GOversampler.h), once for every instruction set the CPU supports.
+The wrapper picks the hiir implementation at runtime, so this shows what it
+ends up with and what the interleaving of the lane versions costs.
+
+*Tab=3***********************************************************************/
+
+
+
+#if ! defined (hiir_test_TestGuitarDOversampler_HEADER_INCLUDED)
+#define hiir_test_TestGuitarDOversampler_HEADER_INCLUDED
+
+#if defined (_MSC_VER)
+	#pragma once
+	#pragma warning (4 : 4250) // "Inherits via dominance."
+#endif
+
+
+
+/*\\\ INCLUDE FILES \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+
+
+namespace hiir
+{
+namespace test
+{
+
+
+
+class TestGuitarDOversampler
+{
+
+/*\\\ PUBLIC \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+public:
+
+	static void    perform_test ();
+
+
+
+/*\\\ PROTECTED \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+protected:
+
+
+
+/*\\\ PRIVATE \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+private:
+
+	enum {         BLOCK_LEN  = 512 };
+	enum {         NBR_BLOCKS = 1024 };
+
+	template <int NC>
+	static void    test_stage (int nbr_chn);
+	static void    test_oversampler (unsigned int factor, int quality);
+
+
+
+/*\\\ FORBIDDEN MEMBER FUNCTIONS \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+private:
+
+	               TestGuitarDOversampler ()                                    = delete;
+	               TestGuitarDOversampler (const TestGuitarDOversampler &other) = delete;
+	               TestGuitarDOversampler (TestGuitarDOversampler &&other)      = delete;
+	               ~TestGuitarDOversampler ()                                   = delete;
+	TestGuitarDOversampler &
+	               operator = (const TestGuitarDOversampler &other)             = delete;
+	TestGuitarDOversampler &
+	               operator = (TestGuitarDOversampler &&other)                  = delete;
+	bool           operator == (const TestGuitarDOversampler &other)            = delete;
+	bool           operator != (const TestGuitarDOversampler &other)            = delete;
+
+}; // class TestGuitarDOversampler
+
+
+
+}  // namespace test
+}  // namespace hiir
+
+
+
+#include "./test/TestGuitarDOversampler.hpp"
+
+
+
+#endif   // hiir_test_TestGuitarDOversampler_HEADER_INCLUDED
+
+
+
+/*\\\ EOF \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
@@ -0,0 +1,256 @@
+/*****************************************************************************
+
+        TestGuitarDOversampler.hpp
+
+*Tab=3***********************************************************************/
+
+
+
+#if defined (hiir_test_TestGuitarDOversampler_CURRENT_CODEHEADER)
+	#error Recursive inclusion of TestGuitarDOversampler code header.
+#endif
+#define hiir_test_TestGuitarDOversampler_CURRENT_CODEHEADER
+
+#if ! defined (hiir_test_TestGuitarDOversampler_CODEHEADER_INCLUDED)
+#define hiir_test_TestGuitarDOversampler_CODEHEADER_INCLUDED
+
+
+
+/*\\\ INCLUDE FILES \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+#include "./test/conf.h"
+#include "./test/TimerAccurate.h"
+#include "./PolyphaseIIR2Designer.h"
+
+// Same setup as the headless GuitarD build, the wrapper works on float here
+#if ! defined (GUITARD_HEADLESS)
+	#define GUITARD_HEADLESS
+#endif
+#if ! defined (SAMPLE_TYPE_FLOAT)
+	#define SAMPLE_TYPE_FLOAT
+#endif
+#if defined (hiir_test_SSE) && ! defined (GUITARD_SSE)
+	#define GUITARD_SSE
+#endif
+// PolyphaseIir2Designer.cpp is already part of the project
+#if ! defined (GUITARD_HIIR_DESIGNER_LINKED)
+	#define GUITARD_HIIR_DESIGNER_LINKED
+#endif
+
+#include "../../../src/types/GOversampler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+
+
+
+namespace hiir
+{
+namespace test
+{
+
+
+
+/*\\\ PUBLIC \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+
+
+void	TestGuitarDOversampler::perform_test ()
+{
+	printf ("GuitarD Oversampler, widest instruction set: %s\n", guitard::cpu::name (guitard::cpu::widest ()));
+
+	const unsigned int   fact_arr [] = { 2, 4, 8, 16 };
+	for (int quality = 0; quality < guitard::OversamplingQualityCount; ++quality)
+	{
+		for (unsigned int factor : fact_arr)
+		{
+			test_oversampler (factor, quality);
+		}
+	}
+
+	// The channel counts decide between the mono and the lane versions
+	const int      chn_arr [] = { 1, 2, 4, 8, 16 };
+	for (int chn : chn_arr)
+	{
+		test_stage <12> (chn);
+	}
+	for (int chn : chn_arr)
+	{
+		test_stage <4> (chn);
+	}
+
+	printf ("\n");
+	fflush (stdout);
+}
+
+
+
+/*\\\ PROTECTED \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+
+
+/*\\\ PRIVATE \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+
+
+static const guitard::Simd	TestGuitarDOversampler_simd_arr [] =
+{
+	guitard::Simd::FPU,
+	guitard::Simd::SSE,
+	guitard::Simd::NEON,
+	guitard::Simd::AVX,
+	guitard::Simd::AVX512
+};
+
+
+
+// Stereo, up and down by the wrapper, the oversampled callback only copies
+void	TestGuitarDOversampler::test_oversampler (unsigned int factor, int quality)
+{
+	std::vector <float>  src_l (BLOCK_LEN);
+	std::vector <float>  src_r (BLOCK_LEN);
+	std::vector <float>  dst_l (BLOCK_LEN);
+	std::vector <float>  dst_r (BLOCK_LEN);
+	for (int pos = 0; pos < BLOCK_LEN; ++pos)
+	{
+		src_l [pos] = (float (rand ())) * (2.0f / RAND_MAX) - 1.0f;
+		src_r [pos] = (float (rand ())) * (2.0f / RAND_MAX) - 1.0f;
+	}
+	float *        src_ptr_arr [2] = { src_l.data (), src_r.data () };
+	float *        dst_ptr_arr [2] = { dst_l.data (), dst_r.data () };
+
+	for (guitard::Simd simd : TestGuitarDOversampler_simd_arr)
+	{
+		if (! guitard::cpu::supports (simd))
+		{
+			continue;
+		}
+
+		// Too big for the stack
+		guitard::Oversampler *  os_ptr = new guitard::Oversampler (2, 2, simd);
+		os_ptr->setFactor (factor);
+		os_ptr->setQuality (quality);
+		os_ptr->mProc = [] (float **in_ptr_arr, float **out_ptr_arr, int nbr_spl)
+		{
+			for (int chn = 0; chn < 2; ++chn)
+			{
+				std::copy (in_ptr_arr [chn], in_ptr_arr [chn] + nbr_spl, out_ptr_arr [chn]);
+			}
+		};
+
+		printf (
+			"Speed test, Oversampler %2dx %-6s %-7s -> %-7s x%-2d, %5.2f spl latency:",
+			int (factor),
+			guitard::OversamplingQualities [quality].name,
+			guitard::cpu::name (simd),
+			guitard::cpu::name (os_ptr->simd ()),
+			os_ptr->lanes (),
+			os_ptr->getLatency ()
+		);
+		fflush (stdout);
+
+		TimerAccurate  tim;
+		const long     nbr_tests = 10;
+		for (long test_cnt = 0; test_cnt < nbr_tests; ++test_cnt)
+		{
+			tim.start ();
+			for (int blk_cnt = 0; blk_cnt < NBR_BLOCKS; ++blk_cnt)
+			{
+				os_ptr->process (src_ptr_arr, dst_ptr_arr, BLOCK_LEN);
+			}
+			tim.stop ();
+		}
+		delete os_ptr;
+
+		// Samples at the base rate, all channels
+		const double   spl_per_s = tim.get_best_rate (BLOCK_LEN * NBR_BLOCKS * 2);
+		printf ("%10.3f Mspl/s\n", spl_per_s / 1000000.0);
+		fflush (stdout);
+	}
+}
+
+
+
+// A single 2x stage going up and down again
+template <int NC>
+void	TestGuitarDOversampler::test_stage (int nbr_chn)
+{
+	double         coef_arr [NC];
+	PolyphaseIir2Designer::compute_coefs_spec_order_tbw (&coef_arr [0], NC, 0.1 / NC);
+
+	std::vector <std::vector <float> >  src_arr (nbr_chn, std::vector <float> (BLOCK_LEN));
+	std::vector <std::vector <float> >  ovr_arr (nbr_chn, std::vector <float> (BLOCK_LEN * 2));
+	std::vector <std::vector <float> >  dst_arr (nbr_chn, std::vector <float> (BLOCK_LEN));
+	std::vector <float *>   src_ptr_arr;
+	std::vector <float *>   ovr_ptr_arr;
+	std::vector <float *>   dst_ptr_arr;
+	for (int chn = 0; chn < nbr_chn; ++chn)
+	{
+		for (int pos = 0; pos < BLOCK_LEN; ++pos)
+		{
+			src_arr [chn] [pos] = (float (rand ())) * (2.0f / RAND_MAX) - 1.0f;
+		}
+		src_ptr_arr.push_back (src_arr [chn].data ());
+		ovr_ptr_arr.push_back (ovr_arr [chn].data ());
+		dst_ptr_arr.push_back (dst_arr [chn].data ());
+	}
+
+	for (guitard::Simd simd : TestGuitarDOversampler_simd_arr)
+	{
+		if (! guitard::cpu::supports (simd))
+		{
+			continue;
+		}
+
+		guitard::OversamplingStage *  stage_ptr =
+			guitard::createOversamplingStage <NC> (nbr_chn, nbr_chn, simd);
+		stage_ptr->setCoefficients (&coef_arr [0]);
+		stage_ptr->clear ();
+
+		printf (
+			"Speed test, OversamplingStage %-7s -> %-7s x%-2d, %2d chn, %2d coef:",
+			guitard::cpu::name (simd),
+			guitard::cpu::name (stage_ptr->simd ()),
+			stage_ptr->lanes (),
+			nbr_chn,
+			NC
+		);
+		fflush (stdout);
+
+		TimerAccurate  tim;
+		const long     nbr_tests = 10;
+		for (long test_cnt = 0; test_cnt < nbr_tests; ++test_cnt)
+		{
+			tim.start ();
+			for (int blk_cnt = 0; blk_cnt < NBR_BLOCKS; ++blk_cnt)
+			{
+				stage_ptr->up (ovr_ptr_arr.data (), src_ptr_arr.data (), BLOCK_LEN);
+				stage_ptr->down (dst_ptr_arr.data (), ovr_ptr_arr.data (), BLOCK_LEN);
+			}
+			tim.stop ();
+		}
+		delete stage_ptr;
+
+		const double   spl_per_s = tim.get_best_rate (BLOCK_LEN * NBR_BLOCKS * nbr_chn);
+		printf ("%10.3f Mspl/s\n", spl_per_s / 1000000.0);
+		fflush (stdout);
+	}
+}
+
+
+
+}  // namespace test
+}  // namespace hiir
+
+
+
+#endif   // hiir_test_TestGuitarDOversampler_CODEHEADER_INCLUDED
+
+#undef hiir_test_TestGuitarDOversampler_CURRENT_CODEHEADER
+
+
+
+/*\\\ EOF \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
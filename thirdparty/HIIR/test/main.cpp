@@ -38,6 +38,7 @@ http://sam.zoy.org/wtfpl/COPYING for more details.
 #include "./test/conf.h"
 #include "./test/TestAllClassesFnc.h"
 #include "./test/TestAllClassesSpeed.h"
+#include "./test/TestGuitarDOversampler.h"
 #include "./def.h"
 #include "./fnc.h"
 
@@ -266,6 +267,8 @@ int	HIIR_test_speed ()
 	hiir::test::TestAllClassesSpeed <32>::perform_test ();
 #endif   // hiir_test_LONG_SPEED_TESTS
 
+	hiir::test::TestGuitarDOversampler::perform_test ();
+
 	return ret_val;
 }
 
@@ -29,8 +29,6 @@
 #include <cstring>
 #include <new>
 
-namespace fftconvolver {
-
 #if defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
   #if !defined(FFTCONVOLVER_USE_SSE) && !defined(FFTCONVOLVER_DONT_USE_SSE)
     #define FFTCONVOLVER_USE_SSE
@@ -41,6 +39,8 @@ namespace fftconvolver {
   #include <xmmintrin.h>
 #endif
 
+namespace fftconvolver {
+
 #if defined(__GNUC__)
   #define FFTCONVOLVER_RESTRICT __restrict__
 #else
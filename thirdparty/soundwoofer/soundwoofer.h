@@ -12,6 +12,11 @@
 #include "./soundwooferTypes.h"
 #include "./soundwooferFile.h"
 #include "./soundwooferWave.h"
+#include "./soundwooferCache.h"
+#include "./soundwooferStore.h"
+#include "./soundwooferIntern.h"
+#include "./soundwooferLibrary.h"
+#include "./soundwooferImport.h"
 #include "./soundwooferSerialize.h"
 
 #ifndef SOUNDWOOFER_NO_API
@@ -31,6 +36,13 @@ namespace soundwoofer {
      * Sets the location for data like caches etc
      */
     Status setHomeDirectory(std::string path);
+
+    /**
+     * Enables trimming and so on for all IRs loaded from now on
+     * Off unless this gets called, since it changes how the IRs in existing presets sound
+     * See wave::processIR
+     */
+    void setIRProcessing(const SWProcessing& processing, bool enabled = true);
   }
 
   namespace ir {
@@ -90,6 +102,16 @@ namespace soundwoofer {
     );
 
     SWRigs getRig();
+
+    /**
+     * Hashed lookups into the lists, return nullptr if there's no match
+     * Only knows what list() found
+     */
+    SWImpulseShared findIR(const std::string& file);
+
+    SWRigShared findRig(const std::string& id);
+
+    SWComponentShared findComponent(const std::string& id);
   }
 
   namespace preset {
@@ -1,34 +1,100 @@
 #pragma once
 #include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <vector>
+#include <string>
 #include "./soundwooferTypes.h"
 
 namespace soundwoofer {
   /**
    * Allows async operations wrapping the SW singleton
+   * The tasks run on a small pool of workers which sleep while there's nothing to do.
+   * Requests for something which is already queued (or for IRs already loading) get merged,
+   * every caller still gets its callback.
    */
   namespace async {
     /**
      * Clears the async queue, but doesn't terminate a running task
      * Call this if for example the UI gets destroyed to be sure there are no callbacks
      * lingering which might be attached to destroyed UI elements
+     * Tasks which are already running won't call their callbacks anymore
      */
     void cancelAll(const bool doJoin = false);
 
+    /**
+     * Limits the amount of tasks running at the same time
+     * Defaults to half the cores but no more than 4
+     */
+    void setWorkerCount(size_t count);
+
     typedef std::function<void(Status)> CallbackFunc;
 
     /**
      * Callback for async operations which provides a status code
+     * Only a weak reference is kept, so the callback won't be called once the owner let go of it
      */
     typedef std::shared_ptr<std::function<void(Status)>> Callback;
 
+    /**
+     * Higher priorities are picked first, e.g. the IR of the running preset before the browser listing
+     */
+    enum Priority {
+      PRIORITY_LOW = 0,
+      PRIORITY_NORMAL,
+      PRIORITY_HIGH
+    };
+
+    /**
+     * Cancels a single request, its task won't start if nobody else needs it
+     * and the callback won't be called if it's already running
+     */
+    class CancelToken {
+      std::atomic<bool> mCancelled = { false };
+    public:
+      void cancel() { mCancelled = true; }
+      bool cancelled() const { return mCancelled; }
+    };
+
+    typedef std::shared_ptr<CancelToken> CancelTokenShared;
+
+    /**
+     * Collects callbacks to call them on a specific thread like the UI thread
+     * That thread needs to call dispatch() regularly
+     */
+    class CallbackQueue {
+      std::mutex mMutex;
+      std::vector<std::function<void()>> mPending;
+    public:
+      void post(std::function<void()> func);
+
+      /**
+       * Calls all the pending callbacks, returns how many there were
+       */
+      size_t dispatch();
+    };
+
+    typedef std::shared_ptr<CallbackQueue> CallbackQueueShared;
+
+    /**
+     * Optional settings for a request
+     */
+    struct Options {
+      Priority priority;
+      CancelTokenShared token; // Can be left empty, cancelAll() will still work
+      CallbackQueueShared queue; // The callback gets called on the worker if there's none
+      Options(Priority p = PRIORITY_NORMAL, CancelTokenShared t = nullptr, CallbackQueueShared q = nullptr) :
+        priority(p), token(t), queue(q) { }
+    };
+
     /**
      * There's no reason to touch anything in here
      */
     namespace _ {
-      int maxQueueLength =
+      size_t maxQueueLength =
 #ifndef SOUNDWOOFER_MAX_ASYNC_QUEUE
         3;
 #else
@@ -42,57 +108,88 @@ namespace soundwoofer {
       typedef std::function<Status()> Task;
 
       /**
-       * Bundles together a task and a callback to call after a task has been finished
+       * Someone waiting for a task to finish
+       */
+      struct Waiter {
+        std::weak_ptr<CallbackFunc> callback;
+        CancelTokenShared token;
+        CallbackQueueShared queue;
+      };
+
+      /**
+       * Bundles together a task and everyone to notify after it has been finished
        */
       struct TaskBundle {
-        Callback callback;
         Task task;
+        /** Requests with the same key do the same thing and get merged, empty to never merge */
+        std::string key;
+        /** Whether requests can also be merged into the task while it's running */
+        bool mergeRunning = false;
+        /** Tasks in the same group never run at the same time, e.g. the ones rebuilding the lists */
+        std::string group;
+        Priority priority = PRIORITY_NORMAL;
+        size_t order = 0; // First in first out within the same priority
+        size_t generation = 0; // cancelAll() starts a new one
+        std::vector<Waiter> waiters;
       };
 
       typedef std::shared_ptr<TaskBundle> TaskBundleShared;
 
       /**
-       * Tasks will be queued up here and processed from back to front by mThread
-       */
-      std::vector<TaskBundleShared> mQueue;
-
-      /**
-       * This will mutex the mQueue
+       * Workers and queue, the instance lives until the program exits and joins the workers then
        */
-      std::mutex mutex;
-      std::thread thread;
-      bool threadRunning = false;
-
-      struct LifeCycleHook {
-        static LifeCycleHook& instance() {
-          static LifeCycleHook _instance; return _instance;
+      struct Pool {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<TaskBundleShared> queue;
+        std::vector<TaskBundleShared> running;
+        std::vector<std::thread> workers;
+        size_t workerCount;
+        size_t generation = 0;
+        size_t order = 0;
+        bool stop = false;
+
+        static Pool& instance() {
+          static Pool _instance; return _instance;
         }
-        ~LifeCycleHook() { cancelAll(true); }
+
+        Pool();
+        ~Pool();
       };
 
       /**
-       * This will add a TaskBundle to the queue and set off
-       * the thread to work on the queue if it's not already running
+       * This will add a TaskBundle to the queue or merge it with an equal one
+       * and wake up a worker
+       * If the queue is full the oldest PRIORITY_LOW task gets dropped and its callbacks get CANCELLED
        */
-      void startAsync(Task task, Callback callback);
+      void startAsync(
+        Task task, Callback callback, const Options& options,
+        const std::string& key = "", bool mergeRunning = false, const std::string& group = ""
+      );
     }
 
     namespace ir {
-      Status list(const Callback callback);
+      Status list(const Callback callback, const Options& options = Options(PRIORITY_LOW));
 
-      Status load(SWImpulseShared ir, Callback callback, size_t sampleRate = 0, bool normalize = true);
+      Status load(
+        SWImpulseShared ir, Callback callback, size_t sampleRate = 0, bool normalize = true,
+        const Options& options = Options(PRIORITY_HIGH)
+      );
 
-      Status loadUnknown(SWImpulseShared* ir, Callback callback, size_t sampleRate = 0, bool normalize = true);
+      Status loadUnknown(
+        SWImpulseShared* ir, Callback callback, size_t sampleRate = 0, bool normalize = true,
+        const Options& options = Options(PRIORITY_HIGH)
+      );
     }
 
     namespace preset {
-      Status list(const Callback callback);
+      Status list(const Callback callback, const Options& options = Options(PRIORITY_LOW));
 
 #ifndef SOUNDWOOFER_NO_API
-      Status send(const SWPresetShared preset, Callback callback);
+      Status send(const SWPresetShared preset, Callback callback, const Options& options = Options());
 #endif
 
-      Status load(SWPresetShared preset, Callback callback);
+      Status load(SWPresetShared preset, Callback callback, const Options& options = Options());
     }
   }
 }
@@ -100,4 +197,4 @@ namespace soundwoofer {
 
 #ifdef SOUNDWOOFER_IMPL
   #include "./soundwooferAsyncImpl.h"
-#endif
\ No newline at end of file
+#endif
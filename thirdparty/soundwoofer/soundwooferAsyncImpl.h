@@ -2,111 +2,303 @@
 
 #include "./soundwooferAsync.h"
 #include "./soundwoofer.h"
+#include <algorithm>
+#include <sstream>
 
 namespace soundwoofer {
   namespace async {
-    void cancelAll(const bool doJoin) {
-      _::mutex.lock();
-      _::threadRunning = false;
-      _::mQueue.clear();
+    namespace _ {
+      /**
+       * Calls the callback right away or hands it to the queue of the waiter
+       */
+      void notify(const Waiter& waiter, const Status status) {
+        if (waiter.token != nullptr && waiter.token->cancelled()) { return; }
+        auto call = [waiter, status]() {
+          if (waiter.token != nullptr && waiter.token->cancelled()) { return; }
+          Callback callback = waiter.callback.lock();
+          if (callback != nullptr) { // Still valid
+            (*callback)(status);
+          }
+        };
+        if (waiter.queue != nullptr) {
+          waiter.queue->post(call);
+        }
+        else {
+          call();
+        }
+      }
+
+      /**
+       * A task can be skipped if everyone who wanted it cancelled
+       */
+      bool cancelled(const TaskBundleShared& t) {
+        for (auto& i : t->waiters) {
+          if (i.token == nullptr || !i.token->cancelled()) { return false; }
+        }
+        return !t->waiters.empty();
+      }
 
-      if (_::thread.joinable() && doJoin) {
-        _::thread.join();
+      /**
+       * Highest priority first and oldest first within the same priority
+       * Skips tasks which are blocked by their group, needs the lock
+       */
+      std::vector<TaskBundleShared>::iterator pick(Pool& pool) {
+        auto best = pool.queue.end();
+        for (auto i = pool.queue.begin(); i != pool.queue.end(); ++i) {
+          if (!(*i)->group.empty()) {
+            bool blocked = false;
+            for (auto& r : pool.running) {
+              if (r->group == (*i)->group) { blocked = true; break; }
+            }
+            if (blocked) { continue; }
+          }
+          if (best == pool.queue.end() || (*i)->priority > (*best)->priority
+            || ((*i)->priority == (*best)->priority && (*i)->order < (*best)->order)) {
+            best = i;
+          }
+        }
+        return best;
       }
-      _::mutex.unlock();
-    }
 
-    namespace _ {
-      void startAsync(Task task, Callback callback) {
-        if (maxQueueLength < _::mQueue.size()) {
-          cancelAll(true);
+      /**
+       * Workers which got joined or detached aren't in the pool anymore, needs the lock
+       */
+      bool retired(Pool& pool) {
+        if (pool.stop) { return true; }
+        for (auto& i : pool.workers) {
+          if (i.get_id() == std::this_thread::get_id()) { return false; }
         }
-        LifeCycleHook::instance(); // Create the stack singleton to clean up on program exit
-        mutex.lock();
-        mQueue.push_back(std::make_shared<TaskBundle>(TaskBundle {
-          callback, task
-        }));
-        if (!threadRunning) {
-          if (thread.joinable()) {
-            thread.join();
+        return true;
+      }
+
+      void work() {
+        Pool& pool = Pool::instance();
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        while (true) {
+          auto next = pool.queue.end();
+          pool.wake.wait(lock, [&]() {
+            if (retired(pool)) { return true; }
+            next = pick(pool);
+            return next != pool.queue.end();
+          });
+          if (retired(pool)) { return; }
+          TaskBundleShared t = *next; // A copy to ensure the object keeps on living
+          pool.queue.erase(next);
+          if (cancelled(t)) { continue; }
+          pool.running.push_back(t);
+          lock.unlock();
+          const Status status = t->task(); // Do the main task
+          lock.lock();
+          pool.running.erase(std::find(pool.running.begin(), pool.running.end(), t));
+          // Nobody can join the task anymore once it's out of running
+          const std::vector<Waiter> waiters = std::move(t->waiters);
+          const bool valid = t->generation == pool.generation; // cancelAll() might have happened
+          if (!t->group.empty()) { pool.wake.notify_all(); } // Tasks might have waited for this one
+          lock.unlock();
+          if (valid) {
+            for (auto& i : waiters) {
+              notify(i, status);
+            }
+          }
+          lock.lock();
+        }
+      }
+
+      /**
+       * Starts workers until there are enough for the queue, needs the lock
+       */
+      void spawnWorkers(Pool& pool) {
+        const size_t busy = pool.running.size() + pool.queue.size();
+        while (pool.workers.size() < pool.workerCount && pool.workers.size() < busy) {
+          pool.workers.emplace_back(work);
+        }
+      }
+
+      Pool::Pool() {
+        const size_t cores = std::thread::hardware_concurrency();
+        workerCount = std::max(size_t(1), std::min(size_t(4), cores / 2));
+      }
+
+      /**
+       * Takes the workers out of the pool and waits for them
+       */
+      void stopWorkers(Pool& pool) {
+        std::vector<std::thread> workers;
+        {
+          std::lock_guard<std::mutex> lock(pool.mutex);
+          pool.queue.clear();
+          pool.generation++; // Running tasks won't call back anymore
+          pool.stop = true;
+          workers.swap(pool.workers);
+        }
+        pool.wake.notify_all();
+        for (auto& i : workers) { // Join without holding the lock so the tasks can finish
+          if (i.get_id() == std::this_thread::get_id()) {
+            i.detach(); // Called from a callback, the worker will leave once it's back in the loop
           }
-          threadRunning = true;
-          mutex.unlock();
-          thread = std::thread([&]() {
-            while (threadRunning) {
-              mutex.lock(); // Mutex to make sure the queue doesn't get corrupted
-              if (mQueue.empty()) { // Could be empty by now
-                mutex.unlock();
-                continue;
-              }
-              TaskBundleShared t = *mQueue.begin(); // A copy to ensure the object keeps on living
-              mQueue.erase(mQueue.begin());
-              mutex.unlock();
-              const Status status = t->task(); // Do the main task
-              if (threadRunning) { // We might want to terminate here if the whole queue was cleared
-                const int count = t->callback.use_count();
-                if (1 < count) { // More than one owner (this one) means it's still valid
-                  (*t->callback)(status); // Do the callback if it's still valid
-                }
-                mutex.lock();
-                threadRunning = !mQueue.empty();
-                mutex.unlock();
-              }
+          else {
+            i.join();
+          }
+        }
+      }
+
+      Pool::~Pool() {
+        stopWorkers(*this);
+      }
+
+      void startAsync(
+        Task task, Callback callback, const Options& options,
+        const std::string& key, const bool mergeRunning, const std::string& group
+      ) {
+        Pool& pool = Pool::instance();
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        const Waiter waiter = { callback, options.token, options.queue };
+
+        if (!key.empty()) {
+          for (auto& i : pool.queue) { // Already waiting to run
+            if (i->key == key) {
+              i->waiters.push_back(waiter);
+              i->priority = std::max(i->priority, options.priority);
+              return;
             }
-          });
+          }
+          for (auto& i : pool.running) { // Already running and the result will be the same
+            if (i->key == key && i->mergeRunning && i->generation == pool.generation) {
+              i->waiters.push_back(waiter);
+              return;
+            }
+          }
         }
-        else {
-          mutex.unlock();
+
+        std::vector<Waiter> dropped;
+        if (maxQueueLength <= pool.queue.size()) {
+          // Drop the oldest request with the lowest priority, flipping through IRs only needs the last one
+          // Anything above PRIORITY_LOW stays queued, the queue just gets longer then
+          auto oldest = pool.queue.begin();
+          for (auto i = pool.queue.begin(); i != pool.queue.end(); ++i) {
+            if ((*i)->priority < (*oldest)->priority
+              || ((*i)->priority == (*oldest)->priority && (*i)->order < (*oldest)->order)) {
+              oldest = i;
+            }
+          }
+          if ((*oldest)->priority == PRIORITY_LOW) {
+            dropped = std::move((*oldest)->waiters);
+            pool.queue.erase(oldest);
+          }
+        }
+
+        TaskBundleShared t = std::make_shared<TaskBundle>();
+        t->task = task;
+        t->key = key;
+        t->mergeRunning = mergeRunning;
+        t->group = group;
+        t->priority = options.priority;
+        t->order = pool.order++;
+        t->generation = pool.generation;
+        t->waiters.push_back(waiter);
+        pool.queue.push_back(t);
+        if (!pool.stop) {
+          spawnWorkers(pool);
         }
+        pool.wake.notify_one();
+        lock.unlock();
+        for (auto& i : dropped) { // Without the lock since the callbacks might start new requests
+          notify(i, CANCELLED);
+        }
+      }
+    }
+
+    void cancelAll(const bool doJoin) {
+      _::Pool& pool = _::Pool::instance();
+      if (!doJoin) {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.queue.clear();
+        pool.generation++; // Running tasks won't call back anymore
+        return;
       }
+      _::stopWorkers(pool);
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.stop = false;
+      _::spawnWorkers(pool); // Something might have been queued while joining
+    }
+
+    void setWorkerCount(const size_t count) {
+      _::Pool& pool = _::Pool::instance();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.workerCount = std::max(size_t(1), count);
+    }
+
+    void CallbackQueue::post(std::function<void()> func) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mPending.push_back(std::move(func));
+    }
+
+    size_t CallbackQueue::dispatch() {
+      std::vector<std::function<void()>> pending;
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        pending.swap(mPending);
+      }
+      for (auto& i : pending) { // Without the lock so the callbacks can start new requests
+        i();
+      }
+      return pending.size();
     }
 
     namespace ir {
-      Status list(const Callback callback) {
-        _::startAsync([&]() {
+      const std::string LIST_GROUP = "ir_list";
+
+      Status list(const Callback callback, const Options& options) {
+        _::startAsync([]() {
           return soundwoofer::ir::list();
-        }, callback);
+        }, callback, options, "ir_list", false, LIST_GROUP);
         return ASYNC;
       }
 
-      Status load(SWImpulseShared ir, Callback callback, size_t sampleRate, bool normalize) {
-        _::startAsync([&, ir, sampleRate, normalize]() {
+      Status load(SWImpulseShared ir, Callback callback, size_t sampleRate, bool normalize, const Options& options) {
+        std::stringstream key; // Loading the same object again won't change the result
+        key << "ir_load" << ir.get() << "_" << sampleRate << "_" << normalize;
+        _::startAsync([ir, sampleRate, normalize]() {
           return soundwoofer::ir::load(ir, sampleRate, normalize);
-        }, callback);
+        }, callback, options, key.str(), true);
         return ASYNC;
       }
 
-      Status loadUnknown(SWImpulseShared* ir, Callback callback, size_t sampleRate, bool normalize) {
-        _::startAsync([&, ir, sampleRate, normalize]() {
+      Status loadUnknown(SWImpulseShared* ir, Callback callback, size_t sampleRate, bool normalize, const Options& options) {
+        std::stringstream key; // The pointer might point to a different IR by the time it runs again
+        key << "ir_unknown" << ir << "_" << sampleRate << "_" << normalize;
+        _::startAsync([ir, sampleRate, normalize]() {
           return soundwoofer::ir::loadUnknown(ir, sampleRate, normalize);
-        }, callback);
+        }, callback, options, key.str(), false, LIST_GROUP); // Looks up the lists
         return ASYNC;
       }
     }
 
     namespace preset {
-      Status list(const Callback callback) {
-        _::startAsync([&]() {
+      const std::string PRESET_GROUP = "preset";
+
+      Status list(const Callback callback, const Options& options) {
+        _::startAsync([]() {
           return soundwoofer::preset::list();
-        }, callback);
+        }, callback, options, "preset_list", false, PRESET_GROUP);
         return ASYNC;
       }
 
 #ifndef SOUNDWOOFER_NO_API
-      Status send(const SWPresetShared preset, Callback callback) {
-        _::startAsync([&, preset]() {
+      Status send(const SWPresetShared preset, Callback callback, const Options& options) {
+        _::startAsync([preset]() {
           return soundwoofer::preset::send(preset);
-        }, callback);
+        }, callback, options);
         return ASYNC;
       }
 #endif
 
-      Status load(SWPresetShared preset, Callback callback) {
-        _::startAsync([&, preset]() {
+      Status load(SWPresetShared preset, Callback callback, const Options& options) {
+        _::startAsync([preset]() {
           return soundwoofer::preset::load(preset);
-        }, callback);
+        }, callback, options, "", false, PRESET_GROUP);
         return ASYNC;
       }
     }
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include "./soundwooferTypes.h"
+
+namespace soundwoofer {
+  /**
+   * Keeps decoded, normalized, resampled and processed IRs on disk
+   * The blobs are addressed by the hash of the source wave and all settings which change the result,
+   * so loading a IR a second time only needs to map the blob.
+   */
+  namespace cache {
+    /**
+     * Bump this whenever decoding or processing changes the result so old blobs won't be used
+     */
+    const uint32_t VERSION = 2;
+
+    /**
+     * Whether the cache is turned on and the directory is known
+     */
+    bool enabled();
+
+    /**
+     * Builds the name of the blob from the file::hashData of the source wave and the current settings
+     */
+    std::string key(const std::string& hash, size_t sampleRate, bool normalize);
+
+    /**
+     * Maps the blob, the samples of the IR will point right into it
+     * Returns NOT_CACHED if there's no valid blob
+     */
+    Status load(SWImpulseShared& ir, const std::string& key);
+
+    /**
+     * Writes the samples of the IR to a blob
+     */
+    Status store(const SWImpulseShared& ir, const std::string& key);
+
+    /**
+     * Deletes all blobs
+     */
+    void clear();
+  }
+}
+
+#ifdef SOUNDWOOFER_IMPL
+  #include "./soundwooferCacheImpl.h"
+#endif
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "./soundwooferCache.h"
+#include "./soundwooferFile.h"
+#include "./soundwooferState.h"
+#include <cstring>
+#include <cstdio>
+
+namespace soundwoofer {
+  namespace cache {
+    const char MAGIC[4] = { 'S', 'W', 'I', 'R' };
+    const std::string EXTENSION = ".swir";
+    /**
+     * The samples start here so they stay aligned, the channels are stored one after another
+     */
+    const size_t HEADER_SIZE = 128;
+
+    struct BlobHeader {
+      char magic[4];
+      uint32_t version;
+      uint32_t channels;
+      uint32_t sampleRate;
+      uint64_t length;
+      uint32_t normalized;
+      uint32_t processed;
+      uint64_t lengthBefore;
+      uint64_t lengthAfter;
+      uint64_t partitionsBefore;
+      uint64_t partitionsAfter;
+      float cpuSaved;
+    };
+
+    static_assert(sizeof(BlobHeader) <= HEADER_SIZE, "Blob header too big");
+
+    bool enabled() {
+      return state::cacheProcessedIRs && !state::processedCacheDirectory.empty();
+    }
+
+    std::string key(const std::string& hash, size_t sampleRate, bool normalize) {
+      std::stringstream ss;
+      ss << hash << "-" << sampleRate << (normalize ? "-n" : "");
+      if (state::processIRs) {
+        const SWProcessing& p = state::irProcessing;
+        ss << "-p" << p.minimumPhase << "_" << static_cast<int>(p.trimThreshold * 10)
+          << "_" << static_cast<int>(p.fadeLength * 10) << "_" << p.partitionSize;
+      }
+      ss << "-v" << VERSION;
+      return ss.str();
+    }
+
+    Status load(SWImpulseShared& ir, const std::string& key) {
+      if (!enabled()) { return NOT_CACHED; }
+      file::MappedFileShared blob = std::make_shared<file::MappedFile>(
+        state::processedCacheDirectory + key + EXTENSION
+      );
+      if (!blob->valid() || blob->size() < HEADER_SIZE) { return NOT_CACHED; }
+      BlobHeader header;
+      ::memcpy(&header, blob->data(), sizeof(BlobHeader));
+      if (::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) { return NOT_CACHED; }
+      if (header.channels == 0 || header.length == 0) { return NOT_CACHED; }
+      if (blob->size() != HEADER_SIZE + header.channels * header.length * sizeof(float)) {
+        return NOT_CACHED; // Probably got cut off while writing
+      }
+
+      ir->clearSamples();
+      ir->channels = header.channels;
+      ir->length = static_cast<size_t>(header.length);
+      ir->sampleRate = header.sampleRate;
+      ir->normalized = header.normalized != 0;
+      ir->processed = header.processed != 0;
+      ir->report.lengthBefore = static_cast<size_t>(header.lengthBefore);
+      ir->report.lengthAfter = static_cast<size_t>(header.lengthAfter);
+      ir->report.partitionsBefore = static_cast<size_t>(header.partitionsBefore);
+      ir->report.partitionsAfter = static_cast<size_t>(header.partitionsAfter);
+      ir->report.cpuSaved = header.cpuSaved;
+      ir->samples = new float* [ir->channels];
+      float* data = reinterpret_cast<float*>(blob->data() + HEADER_SIZE);
+      for (size_t c = 0; c < ir->channels; c++) {
+        ir->samples[c] = data + c * ir->length;
+      }
+      ir->storage = blob;
+      return SUCCESS;
+    }
+
+    Status store(const SWImpulseShared& ir, const std::string& key) {
+      if (!enabled()) { return GENERIC_ERROR; }
+      if (ir->samples == nullptr || ir->channels == 0 || ir->length == 0) { return GENERIC_ERROR; }
+      const size_t channelSize = ir->length * sizeof(float);
+      std::vector<char> blob(HEADER_SIZE + ir->channels * channelSize, 0);
+      BlobHeader header;
+      ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version = VERSION;
+      header.channels = static_cast<uint32_t>(ir->channels);
+      header.sampleRate = static_cast<uint32_t>(ir->sampleRate);
+      header.length = ir->length;
+      header.normalized = ir->normalized;
+      header.processed = ir->processed;
+      header.lengthBefore = ir->report.lengthBefore;
+      header.lengthAfter = ir->report.lengthAfter;
+      header.partitionsBefore = ir->report.partitionsBefore;
+      header.partitionsAfter = ir->report.partitionsAfter;
+      header.cpuSaved = ir->report.cpuSaved;
+      ::memcpy(blob.data(), &header, sizeof(BlobHeader));
+      for (size_t c = 0; c < ir->channels; c++) {
+        ::memcpy(blob.data() + HEADER_SIZE + c * channelSize, ir->samples[c], channelSize);
+      }
+
+      // Write to a temporary file first so other loaders never see a half written blob
+      const std::string path = state::processedCacheDirectory + key + EXTENSION;
+      const std::string temp = path + "." + file::generateUUID();
+      if (file::writeFile(temp.c_str(), blob.data(), blob.size()) != SUCCESS) {
+        file::deleteFile(temp.c_str());
+        return GENERIC_ERROR;
+      }
+      if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        file::deleteFile(temp.c_str()); // Most likely someone else was faster
+        return GENERIC_ERROR;
+      }
+      return SUCCESS;
+    }
+
+    void clear() {
+      if (state::processedCacheDirectory.empty()) { return; }
+      for (auto& i : file::scanDir(state::processedCacheDirectory)) {
+        if (!i.isFolder) {
+          file::deleteFile(i.absolute.c_str());
+        }
+      }
+    }
+  }
+}
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <iomanip>
 #include <cassert>
+#include <cstdint>
 
 #include "./soundwooferTypes.h"
 
@@ -54,11 +55,84 @@ namespace soundwoofer {
     Status deleteFile(const char* path);
 
     /**
-     * Simple file hashing from
-     * https://gist.github.com/nitrix/34196ff0c93fdfb01d51
+     * Streaming 64 bit hash, same algorithm and results as XXH64
+     * Works on 32 bytes at a time, so it's limited by memory bandwidth rather than the hashing
+     */
+    class Hasher {
+      uint64_t mAcc[4];
+      unsigned char mBuffer[32];
+      size_t mBuffered = 0;
+      uint64_t mTotal = 0;
+      uint64_t mSeed;
+    public:
+      explicit Hasher(uint64_t seed = 0);
+
+      void update(const char* data, size_t length);
+
+      uint64_t digest() const;
+
+      static std::string hex(uint64_t hash);
+    };
+
+    /**
+     * Content hash of a file as hex string, empty if the file can't be read
      */
     std::string hashFile(const std::string path);
 
+    /**
+     * Content hash of a buffer as hex string, used to address IRs and cached data by content
+     */
+    std::string hashData(const char* data, const size_t length);
+
+    /**
+     * The 32 bit DJB hash older versions used as id for user IRs
+     * Only needed to find the files of old presets
+     * https://gist.github.com/nitrix/34196ff0c93fdfb01d51
+     */
+    std::string hashDataLegacy(const char* data, const size_t length);
+
+    /**
+     * Whether the id came from hashData
+     */
+    bool isContentHash(const std::string& id);
+
+    /**
+     * Whether the id came from hashDataLegacy
+     */
+    bool isLegacyHash(const std::string& id);
+
+    bool fileExists(const std::string& path);
+
+    /**
+     * Last modification of a file or folder in nanoseconds since the epoch, 0 if it doesn't exist
+     * Only has second resolution on windows
+     */
+    int64_t modifiedTime(const std::string& path);
+
+    /**
+     * Maps a whole file into memory
+     * Writing to the data is allowed but stays private to the process, the file won't change
+     */
+    class MappedFile {
+      char* mData = nullptr;
+      size_t mSize = 0;
+#ifdef _WIN32
+      void* mFile = nullptr;
+      void* mMapping = nullptr;
+#endif
+    public:
+      explicit MappedFile(const std::string& path);
+      ~MappedFile();
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      bool valid() const { return mData != nullptr; }
+      char* data() const { return mData; }
+      size_t size() const { return mSize; }
+    };
+
+    typedef std::shared_ptr<MappedFile> MappedFileShared;
+
     bool isWaveName(std::string& name);
 
     bool isJSONName(std::string& name);
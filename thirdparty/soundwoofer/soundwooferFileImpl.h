@@ -11,6 +11,22 @@
   #endif
 #endif
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+#ifdef _WIN32
+  #include <sys/types.h>
+  #include <sys/stat.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
 namespace soundwoofer {
   /**
    * Bundles a few convenient file operations
@@ -69,7 +85,7 @@ namespace soundwoofer {
       mode_t process_mask = umask(0);
       int result_code = mkdir(path, S_IRWXU | S_IRWXG | S_IRWXO);
       umask(process_mask);
-      return !result_code ? SUCCESS : GENERIC_ERROR;
+      return !result_code || errno == EEXIST ? SUCCESS : GENERIC_ERROR; // Same as windows
 #endif
     }
 
@@ -89,26 +105,232 @@ namespace soundwoofer {
       return std::remove(path) == 0 ? SUCCESS : GENERIC_ERROR;
     }
 
-    std::string hashFile(const std::string path) {
-      std::ifstream fp(path);
-      std::stringstream ss;
+    namespace {
+      const uint64_t PRIME1 = 11400714785074694791ull;
+      const uint64_t PRIME2 = 14029467366897019727ull;
+      const uint64_t PRIME3 = 1609587929392839161ull;
+      const uint64_t PRIME4 = 9650029242287828579ull;
+      const uint64_t PRIME5 = 2870177450012600261ull;
 
-      // Unable to hash file, return an empty hash.
-      if (!fp.is_open()) {
-        return "";
+      inline uint64_t rotate(const uint64_t x, const int r) {
+        return (x << r) | (x >> (64 - r));
       }
 
-      // Hashing
-      uint32_t magic = 5381;
-      char c;
-      while (fp.get(c)) {
-        magic = ((magic << 5) + magic) + c; // magic * 33 + c
+      inline uint64_t read64(const unsigned char* p) {
+        uint64_t v;
+        ::memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+      inline uint32_t read32(const unsigned char* p) {
+        uint32_t v;
+        ::memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+      inline uint64_t round(uint64_t acc, const uint64_t input) {
+        acc += input * PRIME2;
+        return rotate(acc, 31) * PRIME1;
+      }
+
+      inline uint64_t merge(uint64_t hash, const uint64_t acc) {
+        hash ^= round(0, acc);
+        return hash * PRIME1 + PRIME4;
+      }
+    }
+
+    Hasher::Hasher(const uint64_t seed) : mSeed(seed) {
+      mAcc[0] = seed + PRIME1 + PRIME2;
+      mAcc[1] = seed + PRIME2;
+      mAcc[2] = seed;
+      mAcc[3] = seed - PRIME1;
+    }
+
+    void Hasher::update(const char* data, size_t length) {
+      const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+      mTotal += length;
+      if (mBuffered > 0) { // Fill up the stripe left over from the last call
+        const size_t fill = std::min(length, sizeof(mBuffer) - mBuffered);
+        ::memcpy(mBuffer + mBuffered, p, fill);
+        mBuffered += fill;
+        p += fill;
+        length -= fill;
+        if (mBuffered < sizeof(mBuffer)) { return; }
+        for (int i = 0; i < 4; i++) {
+          mAcc[i] = round(mAcc[i], read64(mBuffer + i * 8));
+        }
+        mBuffered = 0;
+      }
+      // Four independent lanes so the multiplications can overlap
+      uint64_t a0 = mAcc[0], a1 = mAcc[1], a2 = mAcc[2], a3 = mAcc[3];
+      for (; length >= 32; p += 32, length -= 32) {
+        a0 = round(a0, read64(p));
+        a1 = round(a1, read64(p + 8));
+        a2 = round(a2, read64(p + 16));
+        a3 = round(a3, read64(p + 24));
+      }
+      mAcc[0] = a0; mAcc[1] = a1; mAcc[2] = a2; mAcc[3] = a3;
+      ::memcpy(mBuffer, p, length);
+      mBuffered = length;
+    }
+
+    uint64_t Hasher::digest() const {
+      uint64_t hash;
+      if (mTotal >= 32) {
+        hash = rotate(mAcc[0], 1) + rotate(mAcc[1], 7) + rotate(mAcc[2], 12) + rotate(mAcc[3], 18);
+        for (int i = 0; i < 4; i++) {
+          hash = merge(hash, mAcc[i]);
+        }
+      }
+      else {
+        hash = mSeed + PRIME5;
+      }
+      hash += mTotal;
+
+      const unsigned char* p = mBuffer;
+      size_t length = mBuffered;
+      for (; length >= 8; p += 8, length -= 8) {
+        hash ^= round(0, read64(p));
+        hash = rotate(hash, 27) * PRIME1 + PRIME4;
+      }
+      if (length >= 4) {
+        hash ^= read32(p) * PRIME1;
+        hash = rotate(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+        length -= 4;
+      }
+      for (; length > 0; p++, length--) {
+        hash ^= (*p) * PRIME5;
+        hash = rotate(hash, 11) * PRIME1;
       }
 
+      hash ^= hash >> 33;
+      hash *= PRIME2;
+      hash ^= hash >> 29;
+      hash *= PRIME3;
+      hash ^= hash >> 32;
+      return hash;
+    }
+
+    std::string Hasher::hex(const uint64_t hash) {
+      std::stringstream ss;
+      ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+      return ss.str();
+    }
+
+    std::string hashFile(const std::string path) {
+      MappedFile file(path);
+      if (!file.valid()) { return ""; } // Unable to hash file, return an empty hash.
+      return hashData(file.data(), file.size());
+    }
+
+    std::string hashData(const char* data, const size_t length) {
+      Hasher hasher;
+      hasher.update(data, length);
+      return Hasher::hex(hasher.digest());
+    }
+
+    std::string hashDataLegacy(const char* data, const size_t length) {
+      uint32_t magic = 5381;
+      for (size_t i = 0; i < length; i++) {
+        magic = ((magic << 5) + magic) + data[i]; // magic * 33 + c
+      }
+      std::stringstream ss;
       ss << std::hex << std::setw(8) << std::setfill('0') << magic;
       return ss.str();
     }
 
+    namespace {
+      bool isHex(const std::string& id, const size_t length) {
+        if (id.size() != length) { return false; }
+        for (const char c : id) {
+          if (!isxdigit(static_cast<unsigned char>(c))) { return false; }
+        }
+        return true;
+      }
+    }
+
+    bool isContentHash(const std::string& id) {
+      return isHex(id, 16);
+    }
+
+    bool isLegacyHash(const std::string& id) {
+      return isHex(id, 8);
+    }
+
+    bool fileExists(const std::string& path) {
+      std::ifstream file(path);
+      return file.good();
+    }
+
+    int64_t modifiedTime(const std::string& path) {
+#ifdef _WIN32
+      struct _stat64 info;
+      if (_stat64(path.c_str(), &info) != 0) { return 0; }
+      return static_cast<int64_t>(info.st_mtime) * 1000000000ll;
+#else
+      struct stat info;
+      if (stat(path.c_str(), &info) != 0) { return 0; }
+  #ifdef __APPLE__
+      return static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000ll + info.st_mtimespec.tv_nsec;
+  #else
+      return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000ll + info.st_mtim.tv_nsec;
+  #endif
+#endif
+    }
+
+    MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+      HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+      );
+      if (file == INVALID_HANDLE_VALUE) { return; }
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+      }
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+      if (mapping == nullptr) {
+        CloseHandle(file);
+        return;
+      }
+      mData = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+      if (mData == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+      }
+      mFile = file;
+      mMapping = mapping;
+      mSize = static_cast<size_t>(size.QuadPart);
+#else
+      const int file = open(path.c_str(), O_RDONLY);
+      if (file < 0) { return; }
+      struct stat info;
+      if (fstat(file, &info) != 0 || info.st_size == 0) {
+        close(file);
+        return;
+      }
+      void* data = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+      close(file); // The mapping stays valid
+      if (data == MAP_FAILED) { return; }
+      mData = static_cast<char*>(data);
+      mSize = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+      if (mData == nullptr) { return; }
+#ifdef _WIN32
+      UnmapViewOfFile(mData);
+      CloseHandle(mMapping);
+      CloseHandle(mFile);
+#else
+      munmap(mData, mSize);
+#endif
+    }
+
     bool isWaveName(std::string& name) {
       return name.length() - name.find_last_of(".WAV") == 4
         || name.length() - name.find_last_of(".wav") == 4;
@@ -135,13 +357,14 @@ namespace soundwoofer {
     }
 
     std::string generateUUID() {
-      srand(time(nullptr));
+      // Seeding rand with the time gave every call in the same second the same id
+      thread_local std::mt19937 random(std::random_device{}());
       const int charLength = 10 + 26;
       const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
       const int UUIDLength = 36;
       char out[UUIDLength];
       for (int i = 0; i < UUIDLength; i++) {
-        out[i] = chars[rand() % charLength];
+        out[i] = chars[random() % charLength];
       }
       out[9] = out[14] = out[19] = out[24] = '-';
       std::string ret;
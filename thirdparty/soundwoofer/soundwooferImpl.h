@@ -2,6 +2,7 @@
 
 #include "./soundwoofer.h"
 #include "./soundwooferState.h"
+#include <algorithm>
 
 namespace soundwoofer {
   namespace setup {
@@ -9,6 +10,7 @@ namespace soundwoofer {
       state::pluginName = name;
       state::cacheIRs = true;
       state::cachePresets = true;
+      state::cacheProcessedIRs = true;
     }
 
     void setPluginVersion(const std::string& version) {
@@ -23,6 +25,8 @@ namespace soundwoofer {
       state::irDirectory = path + "irs" + file::PATH_DELIMITER;
       state::presetCacheDirectory = path + "preset_cache" + file::PATH_DELIMITER;
       state::irCacheDirectory = path + "ir_cache" + file::PATH_DELIMITER;
+      state::processedCacheDirectory = path + "ir_processed" + file::PATH_DELIMITER;
+      state::packDirectory = path + "packs" + file::PATH_DELIMITER;
       bool ok = true;
       ok = file::createFolder(path.c_str()) != SUCCESS ? false : ok;
 #ifndef SOUNDWOOFER_NO_API
@@ -31,8 +35,15 @@ namespace soundwoofer {
 #endif
       ok = file::createFolder(state::presetDirectory.c_str()) != SUCCESS ? false : ok;
       ok = file::createFolder(state::irDirectory.c_str()) != SUCCESS ? false : ok;
+      ok = file::createFolder(state::processedCacheDirectory.c_str()) != SUCCESS ? false : ok;
+      ok = file::createFolder(state::packDirectory.c_str()) != SUCCESS ? false : ok;
       return ok ? SUCCESS : GENERIC_ERROR;
     }
+
+    void setIRProcessing(const SWProcessing& processing, bool enabled) {
+      state::irProcessing = processing;
+      state::processIRs = enabled;
+    }
   }
 
   namespace ir {
@@ -62,9 +73,15 @@ namespace soundwoofer {
       state::GenericRig->impulses.clear();
       state::GenericRig->components.clear();
       state::GenericRig->impulses.clear();
+      state::irsByFile.clear();
+      state::rigsById.clear();
+      state::componentsById.clear();
       state::componentList.push_back(state::GenericComponent);
       state::componentList.push_back(state::GenericMicrophone);
       state::rigList.push_back(state::GenericRig);
+      state::componentsById[state::GenericComponent->id] = state::GenericComponent;
+      state::componentsById[state::GenericMicrophone->id] = state::GenericMicrophone;
+      state::rigsById[state::GenericRig->id] = state::GenericRig;
       state::GenericRig->components.push_back(state::GenericComponent);
       state::GenericRig->components.push_back(state::GenericMicrophone);
     }
@@ -84,48 +101,44 @@ namespace soundwoofer {
           }
         );
         state::GenericRig->impulses.push_back(ir);
+        state::irsByFile[ir->file] = ir;
       };
 
       if (!state::irDirectory.empty()) { // Gather the user IRs in the IR directory
-        auto cabLevel = file::scanDir(state::irDirectory);
-        for (auto i : cabLevel) {
+        // Unchanged folders come from the index, so this is cheap even for big libraries
+        auto cabLevel = library::scanDir(state::irDirectory);
+        for (auto& i : cabLevel) {
           if (i.isFolder) {
             SWRigShared rig(new SWRig{ i.name, i.name, USER_SRC });
-            auto micLevel = file::scanDir(i);
-            for (auto j : micLevel) {
-              SWComponentShared existingMic;
-              for (auto& m : state::componentList) {
-                if (m->name == j.name) {
-                  existingMic = m;
-                  break;
-                }
+            auto micLevel = library::scanDir(i);
+            for (auto& j : micLevel) {
+              if (!j.isFolder) { // At mic level
+                addToUncategorized(j);
+                continue;
               }
-              SWComponentShared mic;
-              if (existingMic == nullptr) { // Make a new one
+              SWComponentShared mic = findComponent(j.name); // User mics use the name as id
+              if (mic == nullptr) { // Make a new one and only register it globally once
                 mic = SWComponentShared(new SWComponent{ j.name, j.name, TypeMicrophone, USER_SRC });
+                state::componentList.push_back(mic);
+                state::componentsById[mic->id] = mic;
               }
-              else {
-                mic = existingMic;
-              }
-              
               rig->microphones.push_back(mic);
-              if (existingMic == nullptr) { state::componentList.push_back(mic); }  // Only register it globally once
-              if (j.isFolder) {
-                auto posLevel = file::scanDir(j);
-                for (auto k : posLevel) {
-                  if (!k.isFolder && file::isWaveName(k.name)) {
-                    SWImpulseShared ir(new SWImpulse{ "CHECKSUM", k.name, mic->id, rig->id, k.relative, USER_SRC });
-                    state::irList.push_back(ir); // GLOBAL
-                    rig->impulses.push_back(ir);
-                  }
+              auto posLevel = library::scanDir(j);
+              for (auto& k : posLevel) {
+                if (!k.isFolder && file::isWaveName(k.name)) {
+                  SWImpulseShared ir(new SWImpulse{ "CHECKSUM", k.name, mic->id, rig->id, k.relative, USER_SRC });
+                  state::irList.push_back(ir); // GLOBAL
+                  state::irsByFile[ir->file] = ir;
+                  rig->impulses.push_back(ir);
                 }
               }
-              else { addToUncategorized(j); } // At mic level
             }
             state::rigList.push_back(rig); // GLOBAL
+            state::rigsById[rig->id] = rig;
           }
           else { addToUncategorized(i); } // At Cabinet level
         }
+        library::save();
       }
 
 #ifndef SOUNDWOOFER_NO_API
@@ -139,12 +152,14 @@ namespace soundwoofer {
       //  load(i, 48000);
       //}
       state::irList.insert(state::irList.end(), swIrs.begin(), swIrs.end());
+      for (auto& i : swIrs) { state::irsByFile[i->file] = i; }
       data = http::get("/Component");
       if (data.empty()) {
         return SERVER_ERROR;
       }
       SWComponents swComps = parse::components(data);
       state::componentList.insert(state::componentList.end(), swComps.begin(), swComps.end());
+      for (auto& i : swComps) { state::componentsById[i->id] = i; }
       data = http::get("/Rig");
       if (data.empty()) {
         return SERVER_ERROR;
@@ -152,17 +167,17 @@ namespace soundwoofer {
       SWRigs swRigs = parse::rigs(data);
       for (auto& rig : swRigs) {
         state::rigList.push_back(rig);
-        for (auto& ir : state::irList) {
-          if (rig->id == ir->rig) {
-            rig->impulses.push_back(ir);
-            for (auto& mic : state::componentList) {
-              if (mic->id == ir->micId) {
-                rig->microphones.push_back(mic);
-                mic->type = TypeMicrophone;
-                break;
-              }
-            }
-          }
+        state::rigsById[rig->id] = rig;
+      }
+      for (auto& ir : swIrs) { // Sort the IRs and their mics into the rigs
+        SWRigShared rig = findRig(ir->rig);
+        if (rig == nullptr) { continue; }
+        rig->impulses.push_back(ir);
+        SWComponentShared mic = findComponent(ir->micId);
+        if (mic == nullptr) { continue; }
+        mic->type = TypeMicrophone;
+        if (std::find(rig->microphones.begin(), rig->microphones.end(), mic) == rig->microphones.end()) {
+          rig->microphones.push_back(mic);
         }
       }
 #endif
@@ -202,10 +217,9 @@ namespace soundwoofer {
     }
 
     Status loadUnknown(SWImpulseShared* ir, size_t sampleRate, bool normalize) {
-      for (auto& i : state::irList) {
-        if (i->file == (*ir)->file) {
-          (*ir) = i; // Already known IR
-        }
+      SWImpulseShared known = findIR((*ir)->file);
+      if (known != nullptr) {
+        (*ir) = known; // Already known IR
       }
       if (file::isUUID((*ir)->file)) {
         (*ir)->source = SOUNDWOOFER_SRC; // Soundwoofer ir, not yet known
@@ -233,6 +247,21 @@ namespace soundwoofer {
     SWRigs getRig() {
       return state::rigList;
     }
+
+    SWImpulseShared findIR(const std::string& file) {
+      auto found = state::irsByFile.find(file);
+      return found == state::irsByFile.end() ? nullptr : found->second;
+    }
+
+    SWRigShared findRig(const std::string& id) {
+      auto found = state::rigsById.find(id);
+      return found == state::rigsById.end() ? nullptr : found->second;
+    }
+
+    SWComponentShared findComponent(const std::string& id) {
+      auto found = state::componentsById.find(id);
+      return found == state::componentsById.end() ? nullptr : found->second;
+    }
   }
 
   namespace preset {
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "./soundwooferTypes.h"
+#include <functional>
+
+namespace soundwoofer {
+  /**
+   * Processes whole folders of IRs ahead of time, so they load straight from soundwoofer::cache later on
+   * instead of getting decoded, resampled and processed the first time they are used.
+   */
+  namespace import {
+    struct Report {
+      size_t files = 0; // Waves found in the folder
+      size_t imported = 0; // Decoded and written to the cache
+      size_t cached = 0; // Already in the cache for all samplerates
+      size_t duplicates = 0; // Same content as another file, uses the same cache entries
+      size_t failed = 0;
+      size_t blobs = 0; // Blobs written to the cache
+      size_t bytes = 0; // Size of all the waves read
+      double seconds = 0;
+    };
+
+    /**
+     * Called after each file with the amount done so far, from the worker threads
+     */
+    typedef std::function<void(size_t done, size_t total)> Progress;
+
+    /**
+     * Lists the folder into the IR index of soundwoofer::library and hashes all waves below it, then decodes every
+     * distinct one once, normalizes, resamples it to all the samplerates, processes it with the current settings
+     * and stores it in the cache under its hash.
+     * The hashes don't go to soundwoofer::store since it only lives in memory, the plugin adds them when it loads the files.
+     * The files are spread across the threads, the cache has to be enabled.
+     * Returns GENERIC_ERROR if any of the files failed, the report tells how many
+     * @param threads 0 uses all cores
+     */
+    Status folder(
+      const std::string& path, const std::vector<size_t>& sampleRates, bool normalize, Report& report,
+      size_t threads = 0, Progress progress = nullptr
+    );
+  }
+}
+
+#ifdef SOUNDWOOFER_IMPL
+  #include "./soundwooferImportImpl.h"
+#endif
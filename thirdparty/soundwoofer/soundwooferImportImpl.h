@@ -0,0 +1,159 @@
+#pragma once
+
+#include "./soundwooferImport.h"
+#include "./soundwooferFile.h"
+#include "./soundwooferWave.h"
+#include "./soundwooferCache.h"
+#include "./soundwooferLibrary.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace soundwoofer {
+  namespace import {
+    namespace {
+      void collectWaves(file::FileInfo& folder, std::vector<std::string>& waves) {
+        for (auto& i : library::scanDir(folder)) {
+          if (i.isFolder) {
+            collectWaves(i, waves);
+          }
+          else if (file::isWaveName(i.name)) {
+            waves.push_back(i.absolute);
+          }
+        }
+      }
+
+      SWImpulseShared copyIR(const SWImpulseShared& ir) {
+        SWImpulseShared copy = std::make_shared<SWImpulse>();
+        copy->source = ir->source;
+        copy->channels = ir->channels;
+        copy->length = ir->length;
+        copy->sampleRate = ir->sampleRate;
+        copy->normalized = ir->normalized;
+        copy->samples = new float* [ir->channels];
+        for (size_t c = 0; c < ir->channels; c++) {
+          copy->samples[c] = new float[ir->length];
+          ::memcpy(copy->samples[c], ir->samples[c], ir->length * sizeof(float));
+        }
+        return copy;
+      }
+
+      enum Result { IMPORTED, CACHED, DUPLICATE, FAILED };
+
+      /**
+       * Everything the workers share
+       */
+      struct Batch {
+        std::vector<std::string> waves;
+        std::vector<size_t> sampleRates;
+        bool normalize;
+        std::atomic<size_t> next = { 0 };
+        std::mutex mutex; // For everything below
+        std::set<std::string> hashes;
+        Report report;
+        size_t done = 0;
+        Progress progress;
+      };
+
+      Result importFile(Batch& batch, const std::string& path, size_t& blobs) {
+        file::MappedFile wave(path);
+        if (!wave.valid()) { return FAILED; }
+        {
+          std::lock_guard<std::mutex> lock(batch.mutex);
+          batch.report.bytes += wave.size();
+        }
+        const std::string hash = file::hashData(wave.data(), wave.size());
+        {
+          std::lock_guard<std::mutex> lock(batch.mutex);
+          if (!batch.hashes.insert(hash).second) { return DUPLICATE; } // Someone else takes care of this content
+        }
+
+        // Only decode if any of the rates is missing
+        std::vector<size_t> missing;
+        for (auto rate : batch.sampleRates) {
+          SWImpulseShared blob = std::make_shared<SWImpulse>();
+          if (cache::load(blob, cache::key(hash, rate, batch.normalize)) != SUCCESS) {
+            missing.push_back(rate);
+          }
+        }
+        if (missing.empty()) { return CACHED; }
+
+        SWImpulseShared decoded = std::make_shared<SWImpulse>();
+        decoded->source = USER_SRC_ABSOLUTE;
+        if (wave::decodeWaveMemory(decoded, wave.data(), wave.size()) != SUCCESS) { return FAILED; }
+        if (batch.normalize) {
+          wave::normalizeIR(decoded); // Happens before resampling anyways, so only do it once
+        }
+        for (auto rate : missing) {
+          SWImpulseShared ir = missing.size() > 1 ? copyIR(decoded) : decoded;
+          wave::prepareWave(ir, rate, batch.normalize);
+          if (cache::store(ir, cache::key(hash, rate, batch.normalize)) != SUCCESS) { return FAILED; }
+          blobs++;
+        }
+        return IMPORTED;
+      }
+
+      void work(Batch& batch) {
+        for (size_t i = batch.next++; i < batch.waves.size(); i = batch.next++) {
+          size_t blobs = 0;
+          const Result result = importFile(batch, batch.waves[i], blobs);
+          std::lock_guard<std::mutex> lock(batch.mutex);
+          Report& report = batch.report;
+          report.blobs += blobs;
+          switch (result) {
+          case IMPORTED: report.imported++; break;
+          case CACHED: report.cached++; break;
+          case DUPLICATE: report.duplicates++; break;
+          case FAILED: report.failed++; break;
+          }
+          batch.done++;
+          if (batch.progress) {
+            batch.progress(batch.done, batch.waves.size());
+          }
+        }
+      }
+    }
+
+    Status folder(
+      const std::string& path, const std::vector<size_t>& sampleRates, bool normalize, Report& report,
+      size_t threads, Progress progress
+    ) {
+      if (!cache::enabled() || sampleRates.empty()) { return GENERIC_ERROR; }
+      const auto start = std::chrono::steady_clock::now();
+      Batch batch;
+      batch.sampleRates = sampleRates;
+      batch.normalize = normalize;
+      batch.progress = progress;
+      file::FileInfo root;
+      root.absolute = path;
+      if (!root.absolute.empty() && root.absolute.back() != file::PATH_DELIMITER[0]) {
+        root.absolute += file::PATH_DELIMITER;
+      }
+      collectWaves(root, batch.waves);
+      library::save();
+      batch.report.files = batch.waves.size();
+
+      if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+      }
+      threads = std::min(threads, std::max<size_t>(1, batch.waves.size()));
+      std::vector<std::thread> workers;
+      for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(work, std::ref(batch));
+      }
+      work(batch); // The calling thread helps out too
+      for (auto& i : workers) {
+        i.join();
+      }
+
+      report = batch.report;
+      report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return report.failed == 0 ? SUCCESS : GENERIC_ERROR;
+    }
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "./soundwooferTypes.h"
+
+namespace soundwoofer {
+  /**
+   * Lets IRs with the same content, samplerate and settings share one copy of the samples
+   * Every node or plugin instance loading the same file gets the buffer of the first one
+   * as long as any of them is still alive. Shared samples are read only, see detach.
+   */
+  namespace intern {
+    /**
+     * Points the IR to the samples of an identical one which is still loaded
+     * The key is the one from cache::key, returns NOT_CACHED if there's no such IR
+     */
+    Status acquire(SWImpulseShared& ir, const std::string& key);
+
+    /**
+     * Hands the samples of the IR over so later loads with the same key can use them
+     * If someone else was faster, the IR switches to their samples and frees its own
+     */
+    void share(SWImpulseShared& ir, const std::string& key);
+
+    /**
+     * Gives the IR its own copy of the samples so they can be changed
+     * Does nothing if it already owns them
+     */
+    void detach(SWImpulseShared& ir);
+
+    /**
+     * Number of distinct sample buffers which are still alive
+     */
+    size_t count();
+  }
+}
+
+#ifdef SOUNDWOOFER_IMPL
+  #include "./soundwooferInternImpl.h"
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "./soundwooferIntern.h"
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace soundwoofer {
+  namespace intern {
+    namespace {
+      /**
+       * Owns the channels of a decoded IR once they are shared
+       */
+      struct Buffers {
+        std::vector<float*> channels;
+        ~Buffers() {
+          for (auto c : channels) { delete[] c; }
+        }
+      };
+
+      /**
+       * What the IRs point their storage to, the samples live as long as one of them does
+       */
+      struct Entry {
+        std::shared_ptr<void> storage; // Either Buffers or the mapped blob from soundwoofer::cache
+        std::vector<float*> channels;
+        size_t length = 0;
+        size_t sampleRate = 0;
+        bool normalized = false;
+        bool processed = false;
+        SWProcessingReport report;
+      };
+
+      std::mutex mutex;
+      std::unordered_map<std::string, std::weak_ptr<Entry>> entries;
+
+      void assign(SWImpulseShared& ir, const std::shared_ptr<Entry>& entry) {
+        ir->clearSamples();
+        ir->channels = entry->channels.size();
+        ir->length = entry->length;
+        ir->sampleRate = entry->sampleRate;
+        ir->normalized = entry->normalized;
+        ir->processed = entry->processed;
+        ir->report = entry->report;
+        ir->samples = new float* [ir->channels];
+        for (size_t c = 0; c < ir->channels; c++) {
+          ir->samples[c] = entry->channels[c];
+        }
+        ir->storage = entry;
+      }
+
+      void removeExpired() {
+        for (auto i = entries.begin(); i != entries.end();) {
+          if (i->second.expired()) { i = entries.erase(i); }
+          else { ++i; }
+        }
+      }
+    }
+
+    Status acquire(SWImpulseShared& ir, const std::string& key) {
+      if (key.empty() || ir->source == EMBEDDED_SRC) { return NOT_CACHED; }
+      std::shared_ptr<Entry> entry;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(key);
+        if (found == entries.end()) { return NOT_CACHED; }
+        entry = found->second.lock();
+        if (entry == nullptr) {
+          entries.erase(found);
+          return NOT_CACHED;
+        }
+      }
+      assign(ir, entry); // Might free the old samples, so not while holding the lock
+      return SUCCESS;
+    }
+
+    void share(SWImpulseShared& ir, const std::string& key) {
+      if (key.empty() || ir->source == EMBEDDED_SRC || ir->samples == nullptr) { return; }
+      std::shared_ptr<Entry> entry;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(key);
+        if (found != entries.end()) {
+          entry = found->second.lock();
+        }
+        if (entry == nullptr) {
+          entry = std::make_shared<Entry>();
+          entry->channels.assign(ir->samples, ir->samples + ir->channels);
+          entry->length = ir->length;
+          entry->sampleRate = ir->sampleRate;
+          entry->normalized = ir->normalized;
+          entry->processed = ir->processed;
+          entry->report = ir->report;
+          if (ir->storage != nullptr) {
+            entry->storage = ir->storage;
+          }
+          else {
+            std::shared_ptr<Buffers> buffers = std::make_shared<Buffers>();
+            buffers->channels = entry->channels;
+            entry->storage = buffers;
+          }
+          ir->storage = entry; // The IR doesn't own the channels anymore
+          removeExpired();
+          entries[key] = entry;
+          return;
+        }
+      }
+      assign(ir, entry); // Loaded at the same time as another IR, drop the copy
+    }
+
+    void detach(SWImpulseShared& ir) {
+      if (ir->samples == nullptr || ir->storage == nullptr) { return; }
+      for (size_t c = 0; c < ir->channels; c++) {
+        float* copy = new float[ir->length];
+        ::memcpy(copy, ir->samples[c], ir->length * sizeof(float));
+        ir->samples[c] = copy;
+      }
+      ir->storage = nullptr;
+    }
+
+    size_t count() {
+      std::lock_guard<std::mutex> lock(mutex);
+      removeExpired();
+      return entries.size();
+    }
+  }
+}
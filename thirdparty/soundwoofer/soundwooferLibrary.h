@@ -0,0 +1,35 @@
+#pragma once
+
+#include "./soundwooferFile.h"
+
+namespace soundwoofer {
+  /**
+   * Keeps the listing of the IR folders in a index file in the home directory
+   * A folder only gets read again if its modification time changed, which happens whenever
+   * something inside it gets added, removed or renamed. So opening a big library again
+   * only costs a stat per folder instead of reading all of them.
+   */
+  namespace library {
+    /**
+     * Same as file::scanDir but only returns folders and waves
+     * Uses the listing from the index if the folder didn't change
+     */
+    std::vector<file::FileInfo> scanDir(file::FileInfo& root);
+
+    std::vector<file::FileInfo> scanDir(const std::string path);
+
+    /**
+     * Writes the index file if anything changed since it was loaded
+     */
+    Status save();
+
+    /**
+     * Forgets all listings, the next scan will read every folder again
+     */
+    void clear();
+  }
+}
+
+#ifdef SOUNDWOOFER_IMPL
+  #include "./soundwooferLibraryImpl.h"
+#endif
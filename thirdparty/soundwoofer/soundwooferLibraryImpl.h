@@ -0,0 +1,164 @@
+#pragma once
+
+#include "./soundwooferLibrary.h"
+#include "./soundwooferState.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#ifndef SOUNDWOOFER_CUSTOM_JSON
+  #include "./dependencies/json.hpp"
+#endif
+
+namespace soundwoofer {
+  namespace library {
+    namespace {
+      const int INDEX_VERSION = 1;
+      const std::string INDEX_NAME = "ir_index.json";
+      /**
+       * Folders changed this recently are read again next time since
+       * another change within the same timestamp wouldn't show up
+       */
+      const int64_t SETTLE_TIME = 2000000000ll;
+
+      struct Folder {
+        int64_t modified = 0; // 0 means it has to be read again
+        std::vector<std::pair<std::string, bool>> entries; // Name and whether it's a folder
+      };
+
+      std::mutex mutex;
+      std::unordered_map<std::string, Folder> folders; // Absolute path to listing
+      std::string loadedFrom; // Home directory the index was read from
+      bool dirty = false;
+
+      std::string indexPath() {
+        return state::homeDirectory + INDEX_NAME;
+      }
+
+      int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+      }
+
+      void loadLocked() {
+        if (loadedFrom == state::homeDirectory) { return; }
+        loadedFrom = state::homeDirectory;
+        folders.clear();
+        dirty = false;
+#ifndef SOUNDWOOFER_CUSTOM_JSON
+        if (state::homeDirectory.empty()) { return; }
+        std::ifstream file(indexPath());
+        if (!file.is_open()) { return; }
+        try {
+          nlohmann::json json = nlohmann::json::parse(file);
+          if (json.at("version").get<int>() != INDEX_VERSION) { return; }
+          for (auto& i : json.at("folders")) {
+            Folder& folder = folders[i.at("path").get<std::string>()];
+            folder.modified = i.at("modified").get<int64_t>();
+            for (auto& j : i.at("entries")) {
+              folder.entries.emplace_back(j.at(0).get<std::string>(), j.at(1).get<bool>());
+            }
+          }
+        }
+        catch (...) {
+          folders.clear(); // Broken index, just start over
+        }
+#endif
+      }
+
+      std::vector<file::FileInfo> fromListing(file::FileInfo& root, const Folder& folder) {
+        std::vector<file::FileInfo> ret;
+        ret.reserve(folder.entries.size());
+        for (auto& i : folder.entries) {
+          file::FileInfo info;
+          info.isFolder = i.second;
+          info.name = i.first;
+          info.relative = root.relative + info.name + (info.isFolder ? file::PATH_DELIMITER : "");
+          info.absolute = root.absolute + info.name + (info.isFolder ? file::PATH_DELIMITER : "");
+          root.children.push_back(info);
+          ret.push_back(std::move(info));
+        }
+        return ret;
+      }
+    }
+
+    std::vector<file::FileInfo> scanDir(file::FileInfo& root) {
+      const int64_t modified = file::modifiedTime(root.absolute);
+      if (modified == 0) {
+        root.isFolder = false;
+        return { };
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      loadLocked();
+      Folder& folder = folders[root.absolute];
+      if (folder.modified != 0 && folder.modified == modified) {
+        return fromListing(root, folder);
+      }
+
+      // Read the folder and keep only what's interesting for IRs
+      file::FileInfo scanned = root;
+      scanned.children.clear();
+      folder.entries.clear();
+      for (auto& i : file::scanDir(scanned)) {
+        if (i.isFolder || file::isWaveName(i.name)) {
+          folder.entries.emplace_back(i.name, i.isFolder);
+        }
+      }
+      folder.modified = now() - modified < SETTLE_TIME ? 0 : modified;
+      dirty = true;
+      return fromListing(root, folder);
+    }
+
+    std::vector<file::FileInfo> scanDir(const std::string path) {
+      file::FileInfo root;
+      root.absolute = path;
+      root.relative = "." + file::PATH_DELIMITER;
+      root.name = "";
+      return library::scanDir(root);
+    }
+
+    Status save() {
+#ifndef SOUNDWOOFER_CUSTOM_JSON
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!dirty || state::homeDirectory.empty() || loadedFrom != state::homeDirectory) { return SUCCESS; }
+      nlohmann::json list = nlohmann::json::array();
+      for (auto& i : folders) {
+        if (i.second.modified == 0) { continue; } // Needs to be read again anyways
+        if (file::modifiedTime(i.first) == 0) { continue; } // Folder is gone
+        nlohmann::json entries = nlohmann::json::array();
+        for (auto& j : i.second.entries) {
+          entries.push_back({ j.first, j.second });
+        }
+        list.push_back({ { "path", i.first }, { "modified", i.second.modified }, { "entries", entries } });
+      }
+      const nlohmann::json json = { { "version", INDEX_VERSION }, { "folders", list } };
+      const std::string data = json.dump();
+      // Write to a temporary file first so the index is never half written
+      const std::string path = indexPath();
+      const std::string temp = path + "." + file::generateUUID();
+      if (file::writeFile(temp.c_str(), data.c_str(), data.size()) != SUCCESS) {
+        file::deleteFile(temp.c_str());
+        return GENERIC_ERROR;
+      }
+      file::deleteFile(path.c_str()); // Rename won't replace files on windows
+      if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        file::deleteFile(temp.c_str());
+        return GENERIC_ERROR;
+      }
+      dirty = false;
+#endif
+      return SUCCESS;
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(mutex);
+      folders.clear();
+      dirty = true;
+      if (!state::homeDirectory.empty()) {
+        file::deleteFile(indexPath().c_str());
+      }
+    }
+  }
+}
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cmath>
 #include <algorithm>
+#include <vector>
 #include "./soundwooferTypes.h"
 
 namespace soundwoofer {
@@ -42,6 +43,66 @@ namespace soundwoofer {
       return (sin(PI * i) / (PI * i));
     }
   };
+
+  /**
+   * Rational ratio resampler using a Kaiser windowed sinc split into polyphase branches
+   * The coefficient tables only depend on the ratio and quality, so they are built once
+   * and shared between all instances. All channels are processed in one pass over the
+   * output so each branch is only loaded once per output sample.
+   */
+  class PolyphaseResampler {
+  public:
+    /**
+     * Coefficients for all branches, each branch is stored reversed and padded to a multiple of 4
+     */
+    struct Table {
+      size_t up = 0; // L, the interpolation factor
+      size_t down = 0; // M, the decimation factor
+      size_t taps = 0; // Taps per branch
+      /** Delay of the prototype filter in samples at the interpolated rate */
+      size_t delay = 0;
+      std::vector<float> coefficients;
+      const float* branch(const size_t phase) const { return coefficients.data() + phase * taps; }
+    };
+    typedef std::shared_ptr<const Table> TableShared;
+
+    /**
+     * Ratios needing more branches than this are left to the old Resampler
+     * All the ratios between 44.1, 48, 88.2, 96 and 192k need at most 640
+     */
+    static const size_t MAX_BRANCHES = 1024;
+
+  private:
+    TableShared mTable;
+    std::vector<float> mScratch; // Padded input, reused between calls
+
+    static TableShared buildTable(size_t up, size_t down, double attenuation, double passband);
+
+  public:
+    /**
+     * @param attenuation Stopband attenuation in dB
+     * @param passband Where the transition band starts relative to the lower nyquist frequency
+     */
+    PolyphaseResampler(size_t inRate, size_t outRate, double attenuation = 120, double passband = 0.9);
+
+    /**
+     * Whether the ratio is simple enough to be done with a table
+     */
+    bool valid() const { return mTable != nullptr; }
+
+    TableShared getTable() const { return mTable; }
+
+    /**
+     * Resamples all channels and allocates a new buffer for each of them
+     * Returns the new length
+     */
+    size_t resample(float** in, size_t channels, size_t length, float** out);
+
+    /**
+     * Returns a cached table or builds it, thread safe
+     */
+    static TableShared getTable(size_t up, size_t down, double attenuation, double passband);
+  };
 }
 
 #ifdef SOUNDWOOFER_IMPL
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "./soundwooferResampler.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <cstring>
 
 namespace soundwoofer {
   void Resampler::lowPass(float* buffer, int count, int fSampleRate, float cutoff) {
@@ -214,6 +218,174 @@ namespace soundwoofer {
     return outSamples;
   }
 
+  namespace {
+    /**
+     * Zeroth order modified Bessel function of the first kind for the Kaiser window
+     */
+    double besselI0(const double x) {
+      double sum = 1, term = 1;
+      for (int k = 1; k < 64; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12) { break; }
+      }
+      return sum;
+    }
+
+    size_t gcd(size_t a, size_t b) {
+      while (b != 0) {
+        const size_t t = a % b;
+        a = b;
+        b = t;
+      }
+      return a;
+    }
+
+    inline float dot(const float* a, const float* b, const size_t len) {
+#ifdef SOUNDWOOFER_SSE
+      __m128 sum = _mm_setzero_ps();
+      for (size_t i = 0; i < len; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+      }
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+      return _mm_cvtss_f32(sum);
+#else
+      float sum[4] = { 0, 0, 0, 0 };
+      for (size_t i = 0; i < len; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+      }
+      return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+    }
+
+    /**
+     * Two channels against the same coefficients, so they only need to be loaded once
+     */
+    inline void dot2(const float* a, const float* b0, const float* b1, const size_t len, float& out0, float& out1) {
+#ifdef SOUNDWOOFER_SSE
+      __m128 sum0 = _mm_setzero_ps();
+      __m128 sum1 = _mm_setzero_ps();
+      for (size_t i = 0; i < len; i += 4) {
+        const __m128 coefficients = _mm_loadu_ps(a + i);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(coefficients, _mm_loadu_ps(b0 + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(coefficients, _mm_loadu_ps(b1 + i)));
+      }
+      // Transpose the horizontal sums of both
+      const __m128 low = _mm_unpacklo_ps(sum0, sum1);
+      const __m128 high = _mm_unpackhi_ps(sum0, sum1);
+      __m128 sum = _mm_add_ps(low, high);
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      out0 = _mm_cvtss_f32(sum);
+      out1 = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+#else
+      out0 = dot(a, b0, len);
+      out1 = dot(a, b1, len);
+#endif
+    }
+  }
+
+  PolyphaseResampler::TableShared PolyphaseResampler::buildTable(
+    const size_t up, const size_t down, const double attenuation, const double passband
+  ) {
+    // Normalized to the interpolated rate, the lower of both nyquist frequencies is at 0.5 / max(up, down)
+    const double nyquist = 0.5 / static_cast<double>(std::max(up, down));
+    const double passEdge = nyquist * passband;
+    const double cutoff = (passEdge + nyquist) * 0.5;
+    const double transition = 2 * PI * (nyquist - passEdge);
+    // Kaiser's estimates for the length and shape
+    const double length = (attenuation - 8) / (2.285 * transition);
+    const double beta = attenuation > 50 ? 0.1102 * (attenuation - 8.7)
+      : attenuation > 21 ? 0.5842 * std::pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21) : 0;
 
+    std::shared_ptr<Table> table = std::make_shared<Table>();
+    table->up = up;
+    table->down = down;
+    table->taps = (static_cast<size_t>(std::ceil(length / up)) + 3) & ~size_t(3);
+    const size_t size = table->taps * up - 1; // Odd, so the delay is a whole sample
+    table->delay = (size - 1) / 2;
 
-}
\ No newline at end of file
+    std::vector<double> prototype(size);
+    double sum = 0;
+    const double window = besselI0(beta);
+    for (size_t i = 0; i < size; i++) {
+      const double x = static_cast<double>(i) - table->delay;
+      const double r = x / table->delay;
+      prototype[i] = 2 * cutoff * Resampler::sinc(2 * cutoff * x)
+        * besselI0(beta * std::sqrt(std::max(0.0, 1 - r * r))) / window;
+      sum += prototype[i];
+    }
+
+    // Split into the branches, scaled so every branch has about unity gain
+    table->coefficients.resize(up * table->taps, 0);
+    const double gain = static_cast<double>(up) / sum;
+    for (size_t phase = 0; phase < up; phase++) {
+      float* branch = table->coefficients.data() + phase * table->taps;
+      for (size_t k = 0; k < table->taps; k++) {
+        const size_t index = phase + k * up;
+        if (index < size) {
+          branch[table->taps - 1 - k] = static_cast<float>(prototype[index] * gain);
+        }
+      }
+    }
+    return table;
+  }
+
+  PolyphaseResampler::TableShared PolyphaseResampler::getTable(
+    const size_t up, const size_t down, const double attenuation, const double passband
+  ) {
+    static std::mutex mutex;
+    static std::map<std::tuple<size_t, size_t, double, double>, TableShared> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto key = std::make_tuple(up, down, attenuation, passband);
+    auto found = tables.find(key);
+    if (found != tables.end()) { return found->second; }
+    TableShared table = buildTable(up, down, attenuation, passband);
+    tables[key] = table;
+    return table;
+  }
+
+  PolyphaseResampler::PolyphaseResampler(
+    const size_t inRate, const size_t outRate, const double attenuation, const double passband
+  ) {
+    if (inRate == 0 || outRate == 0) { return; }
+    const size_t divisor = gcd(inRate, outRate);
+    const size_t up = outRate / divisor;
+    const size_t down = inRate / divisor;
+    if (up > MAX_BRANCHES || down > MAX_BRANCHES * 4) { return; }
+    mTable = getTable(up, down, attenuation, passband);
+  }
+
+  size_t PolyphaseResampler::resample(float** in, const size_t channels, const size_t length, float** out) {
+    if (mTable == nullptr || length == 0 || channels == 0) { return 0; }
+    const Table& table = *mTable;
+    const size_t taps = table.taps;
+    const size_t outLength = (length * table.up + table.down - 1) / table.down;
+
+    // Zero padding on both sides so the branches can run past the ends
+    const size_t stride = length + taps * 2;
+    mScratch.assign(stride * channels, 0);
+    for (size_t c = 0; c < channels; c++) {
+      ::memcpy(mScratch.data() + c * stride + taps, in[c], length * sizeof(float));
+      out[c] = new float[outLength];
+    }
+
+    for (size_t n = 0; n < outLength; n++) {
+      // Position at the interpolated rate, shifted by the filter delay so the output lines up with the input
+      const size_t position = n * table.down + table.delay;
+      const float* branch = table.branch(position % table.up);
+      const size_t start = taps + position / table.up + 1 - taps;
+      size_t c = 0;
+      for (; c + 1 < channels; c += 2) {
+        dot2(branch, mScratch.data() + c * stride + start, mScratch.data() + (c + 1) * stride + start, taps, out[c][n], out[c + 1][n]);
+      }
+      if (c < channels) {
+        out[c][n] = dot(branch, mScratch.data() + c * stride + start, taps);
+      }
+    }
+    return outLength;
+  }
+}
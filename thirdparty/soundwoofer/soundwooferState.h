@@ -1,6 +1,8 @@
 #pragma once
 
 #include "./soundwooferTypes.h"
+#include <map>
+#include <unordered_map>
   namespace soundwoofer {
   /**
    * This represents the current state of soundwoofer and config
@@ -25,6 +27,10 @@
 
     bool cacheIRs = false;
     bool cachePresets = false;
+    bool cacheProcessedIRs = false; // Whether decoded and resampled IRs are kept in processedCacheDirectory
+
+    bool processIRs = false; // Whether wave::processIR should run on all loaded IRs
+    SWProcessing irProcessing;
 
     std::string pluginName; // Plugin name used to label and filter presets by
     std::string pluginVersion;
@@ -33,14 +39,27 @@
     std::string irCacheDirectory; // Directory for caching online IRs
     std::string presetCacheDirectory; // Directory for caching online presets
     std::string presetDirectory; // Directory for user IRs
+    std::string processedCacheDirectory; // Directory for the blobs of soundwoofer::cache
+    std::string packDirectory; // Directory for shared libraries with additional nodes
 
     bool componentListCached = false;
     bool irListCached = false;
     bool rigListCached = false;
 
+    /**
+     * Content hash to all the files with that content, see soundwoofer::store
+     */
+    std::map<std::string, std::vector<std::string>> contentIndex;
+
     SWImpulses irList;
     SWRigs rigList;
     SWComponents componentList;
+    /**
+     * Hashed lookups for the lists above, ir::list keeps them in sync
+     */
+    std::unordered_map<std::string, SWImpulseShared> irsByFile;
+    std::unordered_map<std::string, SWRigShared> rigsById;
+    std::unordered_map<std::string, SWComponentShared> componentsById;
     SWPresets presetList;
     std::vector<SWPreset> factoryPresetList;
   };
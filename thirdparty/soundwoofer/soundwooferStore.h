@@ -0,0 +1,36 @@
+#pragma once
+
+#include "./soundwooferTypes.h"
+
+namespace soundwoofer {
+  /**
+   * Content addressed index of the user IRs
+   * Every loaded wave is remembered by its hash, so identical files in different folders
+   * end up under the same key and IRs of presets can be found again after they were moved or renamed.
+   */
+  namespace store {
+    /**
+     * Remembers the file under its content hash
+     */
+    void add(const std::string& hash, const std::string& absolutePath);
+
+    /**
+     * All known files with the same content
+     */
+    std::vector<std::string> duplicates(const std::string& hash);
+
+    /**
+     * Returns the absolute path of an existing file with this content or an empty string
+     * If the hash isn't known yet, the waves in the IR directory which weren't hashed so far get hashed.
+     * That happens without holding the lock of the store, so other calls don't wait for it.
+     * Ids from older versions (see file::hashDataLegacy) work too.
+     */
+    std::string find(const std::string& hash);
+
+    void clear();
+  }
+}
+
+#ifdef SOUNDWOOFER_IMPL
+  #include "./soundwooferStoreImpl.h"
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "./soundwooferStore.h"
+#include "./soundwooferFile.h"
+#include "./soundwooferLibrary.h"
+#include "./soundwooferState.h"
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+namespace soundwoofer {
+  namespace store {
+    namespace {
+      std::mutex mutex;
+      std::set<std::string> hashedPaths; // Files which are in state::contentIndex
+      std::set<std::string> legacyPaths; // Files which also have their legacy hash in there
+
+      void addLocked(const std::string& hash, const std::string& absolutePath) {
+        std::vector<std::string>& paths = state::contentIndex[hash];
+        if (std::find(paths.begin(), paths.end(), absolutePath) == paths.end()) {
+          paths.push_back(absolutePath);
+        }
+      }
+
+      std::string findLocked(const std::string& hash) {
+        auto found = state::contentIndex.find(hash);
+        if (found == state::contentIndex.end()) { return ""; }
+        for (auto& i : found->second) {
+          if (file::fileExists(i)) { return i; }
+        }
+        return "";
+      }
+
+      /**
+       * Collects the absolute paths of all waves below the folder, doesn't need the lock
+       */
+      void collectWaves(file::FileInfo& folder, std::vector<std::string>& waves) {
+        for (auto& i : library::scanDir(folder)) {
+          if (i.isFolder) {
+            collectWaves(i, waves);
+          }
+          else if (file::isWaveName(i.name)) {
+            waves.push_back(i.absolute);
+          }
+        }
+      }
+    }
+
+    void add(const std::string& hash, const std::string& absolutePath) {
+      if (hash.empty()) { return; }
+      std::lock_guard<std::mutex> lock(mutex);
+      addLocked(hash, absolutePath);
+      hashedPaths.insert(absolutePath);
+    }
+
+    std::vector<std::string> duplicates(const std::string& hash) {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = state::contentIndex.find(hash);
+      if (found == state::contentIndex.end()) { return { }; }
+      return found->second;
+    }
+
+    std::string find(const std::string& hash) {
+      const bool legacy = file::isLegacyHash(hash);
+      if (!legacy && !file::isContentHash(hash)) { return ""; }
+      file::FileInfo root;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::string path = findLocked(hash);
+        if (!path.empty() || state::irDirectory.empty()) { return path; }
+        root.absolute = state::irDirectory;
+      }
+      root.relative = "." + file::PATH_DELIMITER;
+
+      // Scanning and hashing the folder takes a while, so it's done without the lock
+      std::vector<std::string> waves;
+      collectWaves(root, waves);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::set<std::string>& done = legacy ? legacyPaths : hashedPaths;
+        waves.erase(std::remove_if(waves.begin(), waves.end(), [&](const std::string& i) {
+          return done.count(i) != 0;
+        }), waves.end());
+      }
+      for (auto& i : waves) { // Stops once the hash turns up
+        file::MappedFile wave(i);
+        if (!wave.valid()) { continue; }
+        const std::string fileHash = legacy ? file::hashDataLegacy(wave.data(), wave.size())
+          : file::hashData(wave.data(), wave.size());
+        std::lock_guard<std::mutex> lock(mutex);
+        addLocked(fileHash, i);
+        (legacy ? legacyPaths : hashedPaths).insert(i);
+        if (fileHash == hash) { break; }
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      return findLocked(hash);
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(mutex);
+      state::contentIndex.clear();
+      hashedPaths.clear();
+      legacyPaths.clear();
+    }
+  }
+}
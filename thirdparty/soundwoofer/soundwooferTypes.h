@@ -4,6 +4,14 @@
 #include <vector>
 #include <functional>
 
+/**
+ * Used for the resampler and wave conversion, anything x64 will have SSE2
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SOUNDWOOFER_SSE
+#endif
+
 namespace soundwoofer {
   static const double PI = 3.1415926535897932384626433832795;
 
@@ -18,6 +26,7 @@ namespace soundwoofer {
     NOT_IMPLEMENTED,
     JSON_ENCODE_ERROR,
     UNKNOWN_IR, // This happens when a SWImpulse is passed as an argument which is not in mIRList
+    CANCELLED, // An async request which got dropped from the full queue before it ran
   };
 
   /**
@@ -30,6 +39,27 @@ namespace soundwoofer {
     EMBEDDED_SRC         // Means there's no actual file only a float buffer
   };
 
+  /**
+   * Settings for wave::processIR
+   */
+  struct SWProcessing {
+    bool minimumPhase = false; // Turns the IR into its minimum phase version which moves the energy to the front
+    float trimThreshold = -60; // The tail will be cut where the remaining energy falls below this in dB, 0 disables trimming
+    float fadeLength = 5; // Fade out in ms applied to the new end of the IR
+    size_t partitionSize = 128; // Block size of the convolution, only used to count the partitions in the report
+  };
+
+  /**
+   * Filled by wave::processIR to tell how much was gained
+   */
+  struct SWProcessingReport {
+    size_t lengthBefore = 0;
+    size_t lengthAfter = 0;
+    size_t partitionsBefore = 0;
+    size_t partitionsAfter = 0;
+    float cpuSaved = 0; // Estimated relative cost saved for the convolution 0-1
+  };
+
   const std::string TypeMicrophone = "Microphone";
   const std::string TypeCabinet = "Cabinet";
 
@@ -73,16 +103,28 @@ namespace soundwoofer {
      */
     bool managed = true;
     bool normalized = false;
+    bool processed = false;
+    SWProcessingReport report; // Only valid if processed
+    /**
+     * Set if the channels point into memory owned by something else like a mapped cache file
+     * or the samples shared with identical IRs, see soundwoofer::intern
+     * Only the array of channel pointers is owned by the IR then
+     */
+    std::shared_ptr<void> storage;
 
     void clearSamples() {
       if (samples == nullptr || source == EMBEDDED_SRC) { return; }
-      for (int i = 0; i < channels; i++) {
-        delete[] samples[i];
+      if (storage == nullptr) {
+        for (int i = 0; i < channels; i++) {
+          delete[] samples[i];
+        }
       }
+      storage = nullptr;
       delete[] samples;
       samples = nullptr;
       channels = length = 0;
       normalized = false;
+      processed = false;
     }
     ~SWImpulse() {
       clearSamples();
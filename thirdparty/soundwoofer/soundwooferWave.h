@@ -6,12 +6,55 @@ namespace soundwoofer {
   namespace wave {
     void normalizeIR(SWImpulseShared& ir);
 
+    /**
+     * Shortens the IR to save convolution time, the results go to SWImpulse::report
+     * Optionally converts it to minimum phase first, then the tail gets cut off
+     * once the remaining energy is below the threshold and faded out.
+     * Won't touch embedded or mapped IRs since they don't own their buffers
+     */
+    Status processIR(SWImpulseShared& ir, const SWProcessing& settings);
+
+    /**
+     * Returns the length after which the energy of all channels combined stays below the threshold
+     * @param threshold in dB relative to the total energy
+     */
+    size_t energyLength(float** samples, size_t length, size_t channels, float threshold);
+
+    /**
+     * Replaces the samples with the minimum phase version using the real cepstrum
+     */
+    void minimumPhase(float* samples, size_t length);
+
+    /**
+     * Resamples the IR with the PolyphaseResampler or the old one for odd ratios
+     * Won't touch embedded or mapped IRs since they don't own their buffers
+     */
+    Status resampleIR(SWImpulseShared& ir, size_t sampleRate);
+
+    /**
+     * Normalizes, resamples and processes a freshly decoded IR
+     */
+    Status prepareWave(SWImpulseShared& ir, size_t sampleRate, bool normalize);
+
 #ifndef SOUNDWOOFER_CUSTOM_WAVE
     /**
      * decodes, deinterleaves and resamples the wave
      */
     Status decodeWave(SWImpulseShared& ir, void* dwav, size_t sampleRate, bool normalize);
 
+    /**
+     * Parses the RIFF header itself and converts 16, 24 and 32 bit PCM or 32 and 64 bit float
+     * right from the (mapped) memory into the channel buffers without an interleaved copy
+     * Returns NOT_IMPLEMENTED for anything else, those go through dr_wav
+     */
+    Status readWave(SWImpulseShared& ir, const char* waveData, size_t length);
+
+    /**
+     * Decodes the wave without normalizing or resampling it
+     * Uses readWave if possible and dr_wav for everything else
+     */
+    Status decodeWaveMemory(SWImpulseShared& ir, const char* waveData, size_t length);
+
     /**
      * Loads a wave file from an absolute path
      */
@@ -19,8 +62,14 @@ namespace soundwoofer {
 
     /**
      * Loads a wave from memory
+     * Shares the samples with identical IRs through soundwoofer::intern
+     * and uses the blobs from soundwoofer::cache if it's enabled
+     * @param hash file::hashData of the wave if it's already known
      */
-    Status loadWaveMemory(SWImpulseShared& ir, const char* waveData, const size_t length, size_t sampleRate, bool normalize);
+    Status loadWaveMemory(
+      SWImpulseShared& ir, const char* waveData, const size_t length, size_t sampleRate, bool normalize,
+      const std::string& hash = ""
+    );
 #endif
   }
 }
@@ -9,13 +9,22 @@
 #include "./soundwooferResampler.h"
 #include <algorithm>
 #include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 #include "./soundwooferFile.h"
+#include "./soundwooferState.h"
+#include "./soundwooferCache.h"
+#include "./soundwooferStore.h"
+#include "./soundwooferIntern.h"
 
 
 namespace soundwoofer {
   namespace wave {
     void normalizeIR(SWImpulseShared& ir) {
       if (ir->normalized || ir->samples == nullptr) { return; }
+      intern::detach(ir); // Others might be using the same samples
       float sum = 0;
       float peak = 0;
       for (size_t s = 0; s < ir->length; s++) {
@@ -44,99 +53,500 @@ namespace soundwoofer {
       ir->normalized = true;
     }
 
-#ifndef SOUNDWOOFER_CUSTOM_WAVE
     /**
-     * decodes, deinterleaves and resamples the wave
+     * Simple in place radix 2 fft, the size needs to be a power of 2
+     * Only used for offline processing so there's no need for anything fancy
      */
-    Status decodeWave(SWImpulseShared& ir, void* dwav, size_t sampleRate, bool normalize) {
-      drwav* wav = reinterpret_cast<drwav*>(dwav);
-      // interleaved buffer from drwav
-      float* pSampleData = static_cast<float*>(malloc(
-        static_cast<size_t>(wav->totalPCMFrameCount)* wav->channels * sizeof(float)
-      ));
+    void fft(std::vector<std::complex<double>>& data, const bool inverse) {
+      const size_t size = data.size();
+      for (size_t i = 1, j = 0; i < size; i++) { // bit reversal
+        size_t bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+          j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+          std::swap(data[i], data[j]);
+        }
+      }
+      for (size_t len = 2; len <= size; len <<= 1) {
+        const double angle = 2 * PI / static_cast<double>(len) * (inverse ? 1 : -1);
+        const std::complex<double> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < size; i += len) {
+          std::complex<double> w(1);
+          for (size_t k = 0; k < len / 2; k++) {
+            const std::complex<double> a = data[i + k];
+            const std::complex<double> b = data[i + k + len / 2] * w;
+            data[i + k] = a + b;
+            data[i + k + len / 2] = a - b;
+            w *= step;
+          }
+        }
+      }
+      if (inverse) {
+        for (auto& i : data) {
+          i /= static_cast<double>(size);
+        }
+      }
+    }
 
-      // Fill the buffer
-      ir->length = drwav_read_pcm_frames_f32(wav, wav->totalPCMFrameCount, pSampleData);
-      if (ir->length == 0) { return WAV_ERROR; }
+    void minimumPhase(float* samples, const size_t length) {
+      // Plenty of padding to keep the cepstrum from aliasing
+      size_t size = 1;
+      while (size < length * 4) { size <<= 1; }
+      std::vector<std::complex<double>> data(size);
+      for (size_t i = 0; i < length; i++) {
+        data[i] = samples[i];
+      }
+      fft(data, false);
 
-      ir->sampleRate = wav->sampleRate;
-      ir->channels = wav->channels;
+      double peak = 0;
+      for (auto& i : data) {
+        peak = std::max(peak, std::abs(i));
+      }
+      if (peak == 0) { return; }
+      const double floor = peak * 0.00001; // -100dB so there's no log(0)
+      for (auto& i : data) {
+        i = std::log(std::max(std::abs(i), floor));
+      }
+      fft(data, true); // Real cepstrum
 
-      // Deinterleaved buffer
-      ir->samples = new float* [ir->channels];
-      for (int c = 0; c < ir->channels; c++) {
-        ir->samples[c] = new float[ir->length];
+      // Fold the anti causal part over to the causal part
+      for (size_t i = 1; i < size / 2; i++) {
+        data[i] *= 2;
+        data[size - i] = 0;
       }
 
-      // slow deinterleaving, but it works
-      for (size_t s = 0; s < ir->length * ir->channels; s++) {
-        const size_t channel = s % ir->channels;
-        const size_t sample = s / ir->channels;
-        ir->samples[channel][sample] = pSampleData[s];
+      fft(data, false);
+      for (auto& i : data) {
+        i = std::exp(i);
       }
+      fft(data, true);
+      for (size_t i = 0; i < length; i++) {
+        samples[i] = static_cast<float>(data[i].real());
+      }
+    }
 
-      free(pSampleData); // Free the interleaved buffer
+    size_t energyLength(float** samples, const size_t length, const size_t channels, const float threshold) {
+      double total = 0;
+      for (size_t c = 0; c < channels; c++) {
+        for (size_t i = 0; i < length; i++) {
+          total += static_cast<double>(samples[c][i]) * samples[c][i];
+        }
+      }
+      if (total == 0) { return 0; }
+      const double limit = total * std::pow(10.0, threshold / 10.0);
+      double tail = 0;
+      size_t end = length;
+      while (end > 0) { // Walk back from the end till there's too much energy
+        double energy = 0;
+        for (size_t c = 0; c < channels; c++) {
+          energy += static_cast<double>(samples[c][end - 1]) * samples[c][end - 1];
+        }
+        if (tail + energy > limit) { break; }
+        tail += energy;
+        end--;
+      }
+      return end;
+    }
 
-      if (normalize) {
-        normalizeIR(ir);
+    Status processIR(SWImpulseShared& ir, const SWProcessing& settings) {
+      if (ir->samples == nullptr || ir->length == 0) { return GENERIC_ERROR; }
+      if (ir->source == EMBEDDED_SRC || ir->storage != nullptr) { return NOT_IMPLEMENTED; }
+      if (ir->processed) { return SUCCESS; }
+      SWProcessingReport& report = ir->report;
+      report.lengthBefore = ir->length;
+
+      if (settings.minimumPhase) {
+        for (size_t c = 0; c < ir->channels; c++) {
+          minimumPhase(ir->samples[c], ir->length);
+        }
       }
 
-      // Do resampling if desired
+      size_t length = ir->length;
+      if (settings.trimThreshold < 0) {
+        length = std::max(size_t(1), energyLength(ir->samples, ir->length, ir->channels, settings.trimThreshold));
+        const size_t fade = std::min(length, static_cast<size_t>(settings.fadeLength * 0.001 * ir->sampleRate));
+        if (length < ir->length) {
+          for (size_t i = 0; i < fade; i++) { // Raised cosine so the cut doesn't click
+            const float gain = 0.5f * (1.f + static_cast<float>(std::cos(PI * (i + 1) / fade)));
+            for (size_t c = 0; c < ir->channels; c++) {
+              ir->samples[c][length - fade + i] *= gain;
+            }
+          }
+        }
+      }
+
+      // No padding to the partition size, the convolver strips trailing zeros anyways
+      ir->length = length;
+
+      /**
+       * A uniformly partitioned convolution does a forward and inverse fft and
+       * a complex multiply for each partition for each block. The ffts cost about
+       * as much as 1.25 * log2(fftsize) of those multiplications
+       */
+      const size_t block = settings.partitionSize > 0 ? settings.partitionSize : 128;
+      const double fftCost = 1.25 * std::log2(2.0 * block);
+      report.lengthAfter = length;
+      report.partitionsBefore = (report.lengthBefore + block - 1) / block;
+      report.partitionsAfter = (report.lengthAfter + block - 1) / block;
+      report.cpuSaved = static_cast<float>(
+        1.0 - (fftCost + report.partitionsAfter) / (fftCost + report.partitionsBefore)
+      );
+      ir->processed = true;
+      return SUCCESS;
+    }
+
+    Status resampleIR(SWImpulseShared& ir, size_t sampleRate) {
+      if (ir->samples == nullptr || ir->source == EMBEDDED_SRC || ir->storage != nullptr) { return NOT_IMPLEMENTED; }
       if (0 < sampleRate && ir->sampleRate != sampleRate) {
-        Resampler resampler(ir->sampleRate, sampleRate);
         float** resampled = new float* [ir->channels];
         size_t sampleCount = 0;
         const size_t channelCount = ir->channels;
-        for (size_t i = 0; i < channelCount; i++) {
-          sampleCount = resampler.resample(
-            ir->samples[i], ir->length, &(resampled[i])
-          );
+        const bool normalized = ir->normalized;
+        PolyphaseResampler polyphase(ir->sampleRate, sampleRate);
+        if (polyphase.valid()) {
+          sampleCount = polyphase.resample(ir->samples, channelCount, ir->length, resampled);
+        }
+        else { // Odd ratio which would need a huge table
+          Resampler resampler(ir->sampleRate, sampleRate);
+          for (size_t i = 0; i < channelCount; i++) {
+            sampleCount = resampler.resample(
+              ir->samples[i], ir->length, &(resampled[i])
+            );
+          }
         }
         ir->clearSamples(); // get rid of the original buffer
         ir->length = sampleCount; // size changed
         ir->channels = channelCount; // This was also reset in clearSamples()
         ir->samples = resampled; // new buffers
         ir->sampleRate = sampleRate;
+        ir->normalized = normalized;
+      }
+      return SUCCESS;
+    }
+
+    Status prepareWave(SWImpulseShared& ir, size_t sampleRate, bool normalize) {
+      if (normalize) {
+        normalizeIR(ir);
+      }
+      resampleIR(ir, sampleRate);
+      if (state::processIRs) {
+        processIR(ir, state::irProcessing);
+      }
+      return SUCCESS;
+    }
+
+#ifndef SOUNDWOOFER_CUSTOM_WAVE
+    namespace {
+      /**
+       * decodes and deinterleaves the wave, nothing else
+       */
+      Status readDrWav(SWImpulseShared& ir, drwav* wav) {
+        // interleaved buffer from drwav
+        float* pSampleData = static_cast<float*>(malloc(
+          static_cast<size_t>(wav->totalPCMFrameCount)* wav->channels * sizeof(float)
+        ));
+
+        // Fill the buffer
+        ir->length = drwav_read_pcm_frames_f32(wav, wav->totalPCMFrameCount, pSampleData);
+        if (ir->length == 0) {
+          free(pSampleData);
+          return WAV_ERROR;
+        }
+
+        ir->sampleRate = wav->sampleRate;
+        ir->channels = wav->channels;
+
+        // Deinterleaved buffer
+        ir->samples = new float* [ir->channels];
+        for (int c = 0; c < ir->channels; c++) {
+          ir->samples[c] = new float[ir->length];
+        }
+
+        const float* interleaved = pSampleData;
+        for (size_t s = 0; s < ir->length; s++) {
+          for (size_t c = 0; c < ir->channels; c++) {
+            ir->samples[c][s] = *(interleaved++);
+          }
+        }
+
+        free(pSampleData); // Free the interleaved buffer
+        return SUCCESS;
+      }
+    }
+
+    /**
+     * decodes, deinterleaves and resamples the wave
+     */
+    Status decodeWave(SWImpulseShared& ir, void* dwav, size_t sampleRate, bool normalize) {
+      const Status status = readDrWav(ir, reinterpret_cast<drwav*>(dwav));
+      if (status != SUCCESS) { return status; }
+      return prepareWave(ir, sampleRate, normalize);
+    }
+
+    namespace {
+      enum SampleFormat { INT16, INT24, INT32, FLOAT32, FLOAT64 };
+
+      const float SCALE16 = 1.f / 32768.f;
+      const float SCALE32 = 1.f / 2147483648.f;
+
+      inline uint16_t readU16(const unsigned char* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+      }
+
+      inline uint32_t readU32(const unsigned char* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+      }
+
+      /**
+       * The samples are read with plain memcpy, big endian machines go through dr_wav
+       */
+      inline bool littleEndian() {
+        const uint16_t probe = 1;
+        return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+      }
+
+      inline float convert16(const unsigned char* p) {
+        int16_t v;
+        ::memcpy(&v, p, sizeof(v));
+        return v * SCALE16;
+      }
+
+      inline float convert24(const unsigned char* p) {
+        // Shift into the upper bytes so the sign is right
+        const uint32_t v = (p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24);
+        return static_cast<int32_t>(v) * SCALE32;
+      }
+
+      inline float convert32(const unsigned char* p) {
+        int32_t v;
+        ::memcpy(&v, p, sizeof(v));
+        return v * SCALE32;
+      }
+
+      inline float convertFloat(const unsigned char* p) {
+        float v;
+        ::memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+      inline float convertDouble(const unsigned char* p) {
+        double v;
+        ::memcpy(&v, p, sizeof(v));
+        return static_cast<float>(v);
+      }
+
+      template <class Convert>
+      void deinterleave(const unsigned char* in, float** out, size_t start, size_t frames, size_t channels, size_t bytes, Convert convert) {
+        in += start * channels * bytes;
+        for (size_t s = start; s < frames; s++) {
+          for (size_t c = 0; c < channels; c++) {
+            out[c][s] = convert(in);
+            in += bytes;
+          }
+        }
+      }
+
+      /**
+       * Handles the bulk of mono and stereo IRs four frames at a time
+       * Returns the number of frames done, the rest is left to deinterleave()
+       */
+      size_t deinterleaveSSE(const unsigned char* in, float** out, size_t frames, size_t channels, SampleFormat format) {
+        size_t s = 0;
+#ifdef SOUNDWOOFER_SSE
+        const __m128 scale16 = _mm_set1_ps(SCALE16);
+        const __m128 scale32 = _mm_set1_ps(SCALE32);
+        if (channels == 1) {
+          if (format == INT16) {
+            for (; s + 8 <= frames; s += 8) {
+              const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + s * 2));
+              // Put each sample in the upper half and shift back down to sign extend
+              const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+              const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+              _mm_storeu_ps(out[0] + s, _mm_mul_ps(_mm_cvtepi32_ps(low), scale16));
+              _mm_storeu_ps(out[0] + s + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale16));
+            }
+          }
+          else if (format == INT32) {
+            for (; s + 4 <= frames; s += 4) {
+              const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + s * 4));
+              _mm_storeu_ps(out[0] + s, _mm_mul_ps(_mm_cvtepi32_ps(x), scale32));
+            }
+          }
+          else if (format == FLOAT32) {
+            ::memcpy(out[0], in, frames * sizeof(float));
+            s = frames;
+          }
+        }
+        else if (channels == 2) {
+          for (; s + 4 <= frames; s += 4) {
+            __m128 a, b; // L0 R0 L1 R1 and L2 R2 L3 R3
+            if (format == INT16) {
+              const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + s * 4));
+              a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), scale16);
+              b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), scale16);
+            }
+            else if (format == INT32) {
+              a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + s * 8))), scale32);
+              b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + s * 8 + 16))), scale32);
+            }
+            else if (format == FLOAT32) {
+              a = _mm_loadu_ps(reinterpret_cast<const float*>(in + s * 8));
+              b = _mm_loadu_ps(reinterpret_cast<const float*>(in + s * 8 + 16));
+            }
+            else {
+              break;
+            }
+            _mm_storeu_ps(out[0] + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(out[1] + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+          }
+        }
+#endif
+        return s;
+      }
+    }
+
+    Status readWave(SWImpulseShared& ir, const char* waveData, const size_t length) {
+      const unsigned char* data = reinterpret_cast<const unsigned char*>(waveData);
+      if (data == nullptr || length < 12 || !littleEndian()) { return NOT_IMPLEMENTED; }
+      if (::memcmp(data, "RIFF", 4) != 0 || ::memcmp(data + 8, "WAVE", 4) != 0) {
+        return NOT_IMPLEMENTED; // RF64 and friends
+      }
+
+      uint16_t format = 0, channels = 0, blockAlign = 0, bits = 0;
+      uint32_t rate = 0;
+      const unsigned char* samples = nullptr;
+      size_t dataSize = 0;
+      size_t pos = 12;
+      while (pos + 8 <= length) {
+        const unsigned char* chunk = data + pos;
+        const size_t size = readU32(chunk + 4);
+        const size_t available = length - pos - 8;
+        if (::memcmp(chunk, "fmt ", 4) == 0) {
+          if (size < 16 || size > available) { return NOT_IMPLEMENTED; }
+          format = readU16(chunk + 8);
+          channels = readU16(chunk + 10);
+          rate = readU32(chunk + 12);
+          blockAlign = readU16(chunk + 20);
+          bits = readU16(chunk + 22);
+          if (format == 0xFFFE && size >= 40) { // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the actual format
+            format = readU16(chunk + 32);
+          }
+        }
+        else if (::memcmp(chunk, "data", 4) == 0) {
+          samples = chunk + 8;
+          dataSize = std::min(size, available); // Files which got cut off still load
+          break;
+        }
+        pos += 8 + size + (size & 1); // Chunks are padded to an even size
+      }
+
+      SampleFormat type;
+      if (format == 1 && bits == 16) { type = INT16; }
+      else if (format == 1 && bits == 24) { type = INT24; }
+      else if (format == 1 && bits == 32) { type = INT32; }
+      else if (format == 3 && bits == 32) { type = FLOAT32; }
+      else if (format == 3 && bits == 64) { type = FLOAT64; }
+      else { return NOT_IMPLEMENTED; }
+      const size_t bytes = bits / 8;
+      if (samples == nullptr || channels == 0 || rate == 0 || blockAlign != channels * bytes) {
+        return NOT_IMPLEMENTED;
+      }
+      const size_t frames = dataSize / blockAlign;
+      if (frames == 0) { return WAV_ERROR; }
+
+      ir->length = frames;
+      ir->sampleRate = rate;
+      ir->channels = channels;
+      ir->samples = new float* [ir->channels];
+      for (size_t c = 0; c < ir->channels; c++) {
+        ir->samples[c] = new float[ir->length];
+      }
+
+      const size_t done = deinterleaveSSE(samples, ir->samples, frames, channels, type);
+      switch (type) {
+      case INT16: deinterleave(samples, ir->samples, done, frames, channels, bytes, convert16); break;
+      case INT24: deinterleave(samples, ir->samples, done, frames, channels, bytes, convert24); break;
+      case INT32: deinterleave(samples, ir->samples, done, frames, channels, bytes, convert32); break;
+      case FLOAT32: deinterleave(samples, ir->samples, done, frames, channels, bytes, convertFloat); break;
+      case FLOAT64: deinterleave(samples, ir->samples, done, frames, channels, bytes, convertDouble); break;
       }
       return SUCCESS;
     }
 
+    Status decodeWaveMemory(SWImpulseShared& ir, const char* waveData, const size_t length) {
+      const Status status = readWave(ir, waveData, length);
+      if (status != NOT_IMPLEMENTED) { return status; }
+      drwav wav; // Compressed or unusual formats
+      if (!drwav_init_memory(&wav, waveData, length, nullptr)) {
+        return WAV_ERROR;
+      }
+      const Status drStatus = readDrWav(ir, &wav);
+      drwav_uninit(&wav);
+      return drStatus;
+    }
+
     /**
      * Loads a wave file from an absolute path
      */
     Status loadWaveFile(SWImpulseShared& ir, std::string absolutePath, size_t sampleRate, bool normalize) {
-      drwav wav;
-
-      // Load the Wave file
-      if (!drwav_init_file(&wav, absolutePath.c_str(), nullptr)) {
+      // Map the Wave file
+      file::MappedFile wave(absolutePath);
+      if (!wave.valid()) {
         if (ir->source == SOUNDWOOFER_SRC) {
           return NOT_CACHED; // This means we'll need to go online and get the IR
         }
+        if (ir->source == USER_SRC) {
+          // The file might have been moved or renamed, so go look for it by its content
+          const std::string found = store::find(ir->id);
+          if (!found.empty()) {
+            if (found.compare(0, state::irDirectory.size(), state::irDirectory) == 0) {
+              ir->file = "." + file::PATH_DELIMITER + found.substr(state::irDirectory.size());
+            }
+            else {
+              ir->source = USER_SRC_ABSOLUTE;
+              ir->file = found;
+            }
+            return loadWaveFile(ir, found, sampleRate, normalize);
+          }
+        }
         return WAV_ERROR; // Means the wave is probably not there and there's not way to get it
-        // TODO try looking for it by using the hash
-
       }
 
+      const std::string hash = file::hashData(wave.data(), wave.size());
       if (ir->source == USER_SRC) {
-        // Hash the file so we can go look for it if the file is missing on load
-        ir->id = file::hashFile(absolutePath);
+        // Remember the hash so we can go look for it if the file is missing on load
+        ir->id = hash;
+        store::add(hash, absolutePath);
       }
 
-      const Status decodeStatus = decodeWave(ir, &wav, sampleRate, normalize);
-      drwav_uninit(&wav);
-      return decodeStatus;
+      return loadWaveMemory(ir, wave.data(), wave.size(), sampleRate, normalize, hash);
     }
 
     /**
      * Loads a wave from memory
+     * Uses the samples of an identical IR if one is loaded, goes to the cache next
+     * and puts the result in both if it had to be decoded
      */
-    Status loadWaveMemory(SWImpulseShared& ir, const char* waveData, const size_t length, size_t sampleRate, bool normalize) {
-      drwav wav;
-      if (!drwav_init_memory(&wav, waveData, length, nullptr)) {
-        return WAV_ERROR;
+    Status loadWaveMemory(
+      SWImpulseShared& ir, const char* waveData, const size_t length, size_t sampleRate, bool normalize,
+      const std::string& hash
+    ) {
+      const std::string key = cache::key(hash.empty() ? file::hashData(waveData, length) : hash, sampleRate, normalize);
+      if (intern::acquire(ir, key) == SUCCESS) { return SUCCESS; } // Someone else has it loaded already
+      if (cache::load(ir, key) == SUCCESS) {
+        intern::share(ir, key);
+        return SUCCESS;
+      }
+      Status decodeStatus = decodeWaveMemory(ir, waveData, length);
+      if (decodeStatus == SUCCESS) {
+        decodeStatus = prepareWave(ir, sampleRate, normalize);
+      }
+      if (decodeStatus == SUCCESS) {
+        cache::store(ir, key);
+        intern::share(ir, key);
       }
-      const Status decodeStatus = decodeWave(ir, &wav, sampleRate, normalize);
-      drwav_uninit(&wav);
       return decodeStatus;
     }
 #endif